@@ -19,10 +19,73 @@
 
 #include <vector>
 
-class Scene {
-    GLuint _shaderProgram;
-    GLuint _vertexBufferObject;
-    GLuint _vertexArrayObject;
+#include "glm.hpp"
+
+#include "gpuresource.h"
+
+// What main.cpp drives. Every chapter's Scene implements it.
+class SceneBase {
+    // A change is drawn for a few frames so results read back a frame late
+    // (occlusion and timer queries) catch up with it
+    static const int redrawSettleFrames = 3;
+    int _pendingRedraws = redrawSettleFrames;
+    double _fixedTime = -1.0;
+    glm::mat4 _clipTile = glm::mat4(1.0f);
+    bool _usesClipTile = false;
+    
+  public:
+    // Runs after the chapter's handles are gone; flags what it left behind
+    virtual ~SceneBase() { sharedGPUMemoryTracker().endScene(); }
+    
+    virtual void init() = 0;
+    virtual void draw() = 0;
+    
+    virtual void reshape(int width, int height) = 0;
+    
+    virtual void keyStateChanged(int key, int action) = 0;
+    
+    // Event-driven redraw: animated scenes are drawn every frame, static
+    // ones only after input or a resize marks them with setNeedsRedraw()
+    virtual bool isAnimated() = 0;
+    void setNeedsRedraw() { _pendingRedraws = redrawSettleFrames; }
+    bool needsRedraw() { return _pendingRedraws > 0 || isAnimated(); }
+    void didRedraw() { if (_pendingRedraws > 0) _pendingRedraws--; }
+    
+    // Seconds that drive the scene's animation: the GLFW clock, unless
+    // offline rendering has pinned it to the time of the frame being drawn
+    double elapsedTime() const { return _fixedTime >= 0.0 ? _fixedTime : glfwGetTime(); }
+    void setFixedTime(double seconds) { _fixedTime = seconds; }
+    
+    // Applied after the camera-to-clip matrix to draw one tile of a larger
+    // image (posterrenderer.h). Identity otherwise. Scenes that multiply it
+    // in when they upload their projection can be rendered as posters.
+    const glm::mat4 &clipTile() { _usesClipTile = true; return _clipTile; }
+    void setClipTile(const glm::mat4 &clipTile) { _clipTile = clipTile; }
+    bool usesClipTile() const { return _usesClipTile; }
+};
+
+#include "sceneregistry.h"
+
+// Each chapter's Scene.cpp defines GLTUT_CHAPTER to a namespace name before
+// including this header and puts its code in that namespace, so several
+// chapters can be linked into one binary without their globals colliding.
+#ifdef GLTUT_CHAPTER
+namespace GLTUT_CHAPTER {
+
+class Scene : public SceneBase {
+    GLProgram _shaderProgram;
+    GLBuffer _vertexBufferObject;
+    GLBuffer _indexBufferObject;
+    GLVertexArray _vertexArrayObject;
+    
+  public:
+    // Chapters that own more than the members above define ChapterState in
+    // their Scene.cpp, create it in init() and delete it in ~Scene(). Every
+    // instance then has its own, as each offline context needs.
+    struct ChapterState;
+    
+  private:
+    ChapterState *_state = nullptr;
     
   public:
     Scene();
@@ -35,10 +98,15 @@ class Scene {
     
     void keyStateChanged(int key, int action);
     
+    bool isAnimated();
+    
     // Only used in Chapter 3
     void computePositionOffsets(float &fXOffset, float &fYOffset);
     void adjustVertexData(float fXOffset, float fYOffset);
 };
 
+}
+#endif
+
 
 #endif /* defined(__circular__Scene__) */
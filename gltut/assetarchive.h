@@ -0,0 +1,483 @@
+//
+//  assetarchive.h
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+
+#ifndef gltut_glfw_assetarchive_h
+#define gltut_glfw_assetarchive_h
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Single-file asset archive: a header, the entry data, a table of contents
+// sorted by name hash and the entry names.
+//
+// The archive is mapped into memory once. Looking an asset up is a binary
+// search over the hashes and returns a pointer into the mapping, so shaders
+// and meshes are neither opened nor copied. Entries can be LZ4 block
+// compressed; those are decompressed on first use and kept for the
+// lifetime of the archive. Entry data starts on the archive's alignment so
+// it can be handed straight to GL.
+//
+// Archives are built with the assetpack tool. FindAsset() resolves a name
+// against the archive and loose files in a fixed order.
+
+const char assetArchiveMagic[4] = { 'G', 'P', 'A', 'K' };
+const uint32_t assetArchiveVersion = 1;
+
+enum AssetEntryFlags
+{
+    AssetEntryCompressed = 1 << 0,     // LZ4 block
+};
+
+struct AssetArchiveHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t alignment;
+    uint64_t tocOffset;
+    uint64_t namesOffset;
+};
+
+struct AssetArchiveEntry
+{
+    uint64_t nameHash;
+    uint64_t offset;
+    uint64_t storedSize;    // bytes in the archive
+    uint64_t size;          // bytes once decompressed
+    uint32_t nameOffset;    // into the names block, not null terminated
+    uint32_t nameLength;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+struct AssetView
+{
+    const char *data;
+    size_t size;
+};
+
+// FNV-1a
+inline uint64_t AssetNameHash(const char *name, size_t length)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t iChar = 0; iChar < length; iChar++)
+    {
+        hash ^= (unsigned char)name[iChar];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+inline uint64_t AssetNameHash(const std::string &name)
+{
+    return AssetNameHash(name.c_str(), name.size());
+}
+
+// Greedy LZ4 block compressor. Fast and simple rather than tight; the
+// output is a standard LZ4 block any decoder accepts.
+inline std::vector<char> LZ4CompressBlock(const char *source, size_t sourceSize)
+{
+    const int hashBits = 16;
+    const size_t minMatch = 4;
+    const size_t lastLiterals = 5;     // the format requires the block to end in literals
+    const size_t matchSearchEnd = 12;
+
+    std::vector<char> output;
+    output.reserve(sourceSize + sourceSize / 255 + 16);
+
+    std::vector<int64_t> table(1 << hashBits, -1);
+    size_t anchor = 0;
+    size_t position = 0;
+
+    struct Emit
+    {
+        static void length(std::vector<char> &out, size_t length)
+        {
+            for (; length >= 255; length -= 255)
+            {
+                out.push_back((char)255);
+            }
+            out.push_back((char)length);
+        }
+    };
+
+    while (sourceSize >= matchSearchEnd && position < sourceSize - matchSearchEnd)
+    {
+        uint32_t sequence;
+        memcpy(&sequence, source + position, sizeof(sequence));
+        uint32_t slot = (sequence * 2654435761U) >> (32 - hashBits);
+        int64_t candidate = table[slot];
+        table[slot] = (int64_t)position;
+
+        uint32_t candidateSequence = 0;
+        if (candidate >= 0)
+        {
+            memcpy(&candidateSequence, source + candidate, sizeof(candidateSequence));
+        }
+
+        if (candidate < 0 || position - candidate > 65535 || candidateSequence != sequence)
+        {
+            position++;
+            continue;
+        }
+
+        size_t matchLength = minMatch;
+        while (position + matchLength < sourceSize - lastLiterals &&
+               source[candidate + matchLength] == source[position + matchLength])
+        {
+            matchLength++;
+        }
+
+        size_t literalLength = position - anchor;
+        size_t extraMatch = matchLength - minMatch;
+        output.push_back((char)((std::min(literalLength, (size_t)15) << 4) | std::min(extraMatch, (size_t)15)));
+        if (literalLength >= 15)
+        {
+            Emit::length(output, literalLength - 15);
+        }
+        output.insert(output.end(), source + anchor, source + position);
+
+        size_t offset = position - candidate;
+        output.push_back((char)(offset & 0xff));
+        output.push_back((char)(offset >> 8));
+        if (extraMatch >= 15)
+        {
+            Emit::length(output, extraMatch - 15);
+        }
+
+        position += matchLength;
+        anchor = position;
+    }
+
+    size_t literalLength = sourceSize - anchor;
+    output.push_back((char)(std::min(literalLength, (size_t)15) << 4));
+    if (literalLength >= 15)
+    {
+        Emit::length(output, literalLength - 15);
+    }
+    output.insert(output.end(), source + anchor, source + sourceSize);
+    return output;
+}
+
+// Returns false if the block is malformed or does not decode to exactly destinationSize bytes.
+inline bool LZ4DecompressBlock(const char *source, size_t sourceSize, char *destination, size_t destinationSize)
+{
+    const unsigned char *input = (const unsigned char *)source;
+    const unsigned char *inputEnd = input + sourceSize;
+    char *output = destination;
+    char *outputEnd = destination + destinationSize;
+
+    while (input < inputEnd)
+    {
+        unsigned token = *input++;
+
+        size_t literalLength = token >> 4;
+        if (literalLength == 15)
+        {
+            unsigned char extra;
+            do
+            {
+                if (input >= inputEnd)
+                    return false;
+                extra = *input++;
+                literalLength += extra;
+            }
+            while (extra == 255);
+        }
+        if (literalLength > (size_t)(inputEnd - input) || literalLength > (size_t)(outputEnd - output))
+        {
+            return false;
+        }
+        memcpy(output, input, literalLength);
+        input += literalLength;
+        output += literalLength;
+
+        // The last sequence has literals only
+        if (input == inputEnd)
+        {
+            break;
+        }
+
+        if (inputEnd - input < 2)
+            return false;
+        size_t offset = input[0] | (input[1] << 8);
+        input += 2;
+        if (offset == 0 || offset > (size_t)(output - destination))
+        {
+            return false;
+        }
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15)
+        {
+            unsigned char extra;
+            do
+            {
+                if (input >= inputEnd)
+                    return false;
+                extra = *input++;
+                matchLength += extra;
+            }
+            while (extra == 255);
+        }
+        matchLength += 4;
+        if (matchLength > (size_t)(outputEnd - output))
+        {
+            return false;
+        }
+
+        // Byte by byte: the match may overlap what it is producing
+        const char *match = output - offset;
+        for (size_t iByte = 0; iByte < matchLength; iByte++)
+        {
+            output[iByte] = match[iByte];
+        }
+        output += matchLength;
+    }
+
+    return output == outputEnd;
+}
+
+class AssetArchive
+{
+  public:
+    AssetArchive()
+    : _mapping(NULL)
+    , _mappingSize(0)
+    , _entries(NULL)
+    , _entryCount(0)
+    , _names(NULL)
+    , _namesSize(0)
+    {
+    }
+
+    ~AssetArchive()
+    {
+        close();
+    }
+
+    // Maps the archive; returns false (and stays closed) if it is missing or invalid
+    bool open(const std::string &filename)
+    {
+        close();
+
+        int file = ::open(filename.c_str(), O_RDONLY);
+        if (file < 0)
+        {
+            return false;
+        }
+
+        struct stat fileInfo;
+        if (fstat(file, &fileInfo) != 0 || (size_t)fileInfo.st_size < sizeof(AssetArchiveHeader))
+        {
+            ::close(file);
+            return false;
+        }
+
+        void *mapping = mmap(NULL, (size_t)fileInfo.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        ::close(file);
+        if (mapping == MAP_FAILED)
+        {
+            return false;
+        }
+
+        _mapping = (const char *)mapping;
+        _mappingSize = (size_t)fileInfo.st_size;
+
+        // Offsets are compared against what is left rather than summed, so
+        // a corrupt header cannot wrap around past the end of the mapping
+        const AssetArchiveHeader *header = (const AssetArchiveHeader *)_mapping;
+        if (memcmp(header->magic, assetArchiveMagic, sizeof(header->magic)) != 0 ||
+            header->version != assetArchiveVersion ||
+            header->tocOffset > _mappingSize ||
+            header->entryCount > (_mappingSize - header->tocOffset) / sizeof(AssetArchiveEntry) ||
+            header->namesOffset > _mappingSize)
+        {
+            fprintf(stderr, "Invalid asset archive: %s\n", filename.c_str());
+            close();
+            return false;
+        }
+
+        _entries = (const AssetArchiveEntry *)(_mapping + header->tocOffset);
+        _entryCount = header->entryCount;
+        _names = _mapping + header->namesOffset;
+        _namesSize = _mappingSize - (size_t)header->namesOffset;
+        _filename = filename;
+        return true;
+    }
+
+    void close()
+    {
+        if (_mapping != NULL)
+        {
+            munmap((void *)_mapping, _mappingSize);
+        }
+        _mapping = NULL;
+        _mappingSize = 0;
+        _entries = NULL;
+        _entryCount = 0;
+        _names = NULL;
+        _namesSize = 0;
+        _filename.clear();
+
+        std::lock_guard<std::mutex> lock(_decompressedMutex);
+        _decompressed.clear();
+    }
+
+    bool isOpen() const { return _mapping != NULL; }
+    const std::string &filename() const { return _filename; }
+    size_t entryCount() const { return _entryCount; }
+
+    // Safe to call from several threads at once
+    bool find(const std::string &name, AssetView &view)
+    {
+        if (_mapping == NULL)
+        {
+            return false;
+        }
+
+        uint64_t hash = AssetNameHash(name);
+        const AssetArchiveEntry *entriesEnd = _entries + _entryCount;
+        const AssetArchiveEntry *entry = std::lower_bound(_entries, entriesEnd, hash, hashLess);
+
+        // Hashes can collide; the names tell them apart
+        for (; entry != entriesEnd && entry->nameHash == hash; entry++)
+        {
+            if (entry->nameLength == name.size() && entry->nameOffset <= _namesSize &&
+                entry->nameLength <= _namesSize - entry->nameOffset &&
+                memcmp(_names + entry->nameOffset, name.c_str(), name.size()) == 0)
+            {
+                return entryData(*entry, view);
+            }
+        }
+        return false;
+    }
+
+  private:
+    AssetArchive(const AssetArchive &);
+    AssetArchive &operator=(const AssetArchive &);
+
+    static bool hashLess(const AssetArchiveEntry &entry, uint64_t hash)
+    {
+        return entry.nameHash < hash;
+    }
+
+    bool entryData(const AssetArchiveEntry &entry, AssetView &view)
+    {
+        if (entry.offset > _mappingSize || entry.storedSize > _mappingSize - entry.offset)
+        {
+            return false;
+        }
+
+        if (!(entry.flags & AssetEntryCompressed))
+        {
+            if (entry.size != entry.storedSize)
+            {
+                return false;
+            }
+            view.data = _mapping + entry.offset;
+            view.size = (size_t)entry.size;
+            return true;
+        }
+
+        // An LZ4 byte expands to at most 255; larger sizes are corrupt, not worth allocating
+        if (entry.size / 255 > entry.storedSize)
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(_decompressedMutex);
+        std::vector<char> &data = _decompressed[entry.offset];
+        if (data.size() != entry.size)
+        {
+            data.resize((size_t)entry.size);
+            if (!LZ4DecompressBlock(_mapping + entry.offset, (size_t)entry.storedSize, data.empty() ? NULL : &data[0], data.size()))
+            {
+                fprintf(stderr, "Corrupt entry in asset archive: %s\n", _filename.c_str());
+                _decompressed.erase(entry.offset);
+                return false;
+            }
+        }
+
+        view.data = data.empty() ? NULL : &data[0];
+        view.size = data.size();
+        return true;
+    }
+
+    const char *_mapping;
+    size_t _mappingSize;
+    const AssetArchiveEntry *_entries;
+    size_t _entryCount;
+    const char *_names;
+    size_t _namesSize;
+    std::string _filename;
+
+    // Keyed by entry offset; std::map keeps the buffers in place as it grows
+    std::mutex _decompressedMutex;
+    std::map<uint64_t, std::vector<char> > _decompressed;
+};
+
+// The archive the helpers look assets up in before falling back to loose files
+inline AssetArchive &sharedAssetArchive()
+{
+    static AssetArchive archive;
+    return archive;
+}
+
+// Where the running scene keeps its assets when several scenes share a binary
+inline std::string &currentAssetDirectory()
+{
+    static std::string directory;
+    return directory;
+}
+
+// Looks for name in the current asset directory, then at the top level,
+// trying the mounted archive before loose files each time. view points into
+// the archive, or into storage when the asset came from a loose file.
+inline bool FindAsset(const std::string &name, AssetView &view, std::string &storage)
+{
+    std::vector<std::string> candidates;
+    if (!currentAssetDirectory().empty())
+    {
+        candidates.push_back(currentAssetDirectory() + "/" + name);
+    }
+    candidates.push_back(name);
+
+    for (size_t iCandidate = 0; iCandidate < candidates.size(); iCandidate++)
+    {
+        if (sharedAssetArchive().find(candidates[iCandidate], view))
+        {
+            return true;
+        }
+
+        std::ifstream file(candidates[iCandidate].c_str(), std::ios::binary);
+        if (file.is_open())
+        {
+            storage.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            view.data = storage.data();
+            view.size = storage.size();
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif
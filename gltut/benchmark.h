@@ -0,0 +1,284 @@
+//
+//  benchmark.h
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+
+#ifndef gltut_glfw_benchmark_h
+#define gltut_glfw_benchmark_h
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#include <mach/thread_policy.h>
+#elif defined(__linux__)
+#include <sched.h>
+#endif
+
+// The job and result format shared by the benchmark worker (main.cpp
+// --worker) and the benchrunner tool that drives several of them.
+//
+// The runner writes one job per line to a worker's stdin, tab separated:
+//
+//  <id>  <scene>  <width>  <height>  <frames>  <keys>
+//
+// keys are pressed in the scene after init() to pick a variant, e.g. "V"
+// for the multi-view path of gltut 06d. The worker answers each job with
+// one line of JSON on its stdout, which carries every frame time so that
+// benchcompare can test two reports for a real difference.
+
+struct BenchmarkJob
+{
+    BenchmarkJob() : id(-1), width(0), height(0), frames(0) {}
+
+    int id;
+    std::string scene;
+    int width;
+    int height;
+    int frames;
+    std::string keys;
+
+    std::string formatLine() const
+    {
+        std::ostringstream line;
+        line << id << '\t' << scene << '\t' << width << '\t' << height << '\t' << frames << '\t' << keys << '\n';
+        return line.str();
+    }
+
+    bool parseLine(const std::string &line)
+    {
+        std::vector<std::string> fields;
+        std::string::size_type start = 0;
+        while (true)
+        {
+            std::string::size_type tab = line.find('\t', start);
+            fields.push_back(line.substr(start, tab == std::string::npos ? std::string::npos : tab - start));
+            if (tab == std::string::npos)
+                break;
+            start = tab + 1;
+        }
+        if (fields.size() < 5)
+        {
+            return false;
+        }
+
+        id = atoi(fields[0].c_str());
+        scene = fields[1];
+        width = atoi(fields[2].c_str());
+        height = atoi(fields[3].c_str());
+        frames = atoi(fields[4].c_str());
+        keys = fields.size() > 5 ? fields[5] : "";
+        return width > 0 && height > 0 && frames > 0;
+    }
+};
+
+// Per-frame times in seconds, summarised in milliseconds
+struct FrameStatistics
+{
+    double average;
+    double minimum;
+    double median;
+    double percentile95;
+    double maximum;
+
+    explicit FrameStatistics(std::vector<double> frameTimes)
+    : average(0.0), minimum(0.0), median(0.0), percentile95(0.0), maximum(0.0)
+    {
+        if (frameTimes.empty())
+            return;
+
+        std::sort(frameTimes.begin(), frameTimes.end());
+        double sum = 0.0;
+        for (size_t iFrame = 0; iFrame < frameTimes.size(); iFrame++)
+        {
+            sum += frameTimes[iFrame];
+        }
+        average = sum / frameTimes.size() * 1000.0;
+        minimum = frameTimes.front() * 1000.0;
+        median = frameTimes[frameTimes.size() / 2] * 1000.0;
+        percentile95 = frameTimes[std::min(frameTimes.size() - 1, frameTimes.size() * 95 / 100)] * 1000.0;
+        maximum = frameTimes.back() * 1000.0;
+    }
+};
+
+inline std::string JSONString(const std::string &text)
+{
+    std::string quoted = "\"";
+    for (size_t iChar = 0; iChar < text.size(); iChar++)
+    {
+        char c = text[iChar];
+        if (c == '"' || c == '\\')
+        {
+            quoted += '\\';
+            quoted += c;
+        }
+        else if ((unsigned char)c < 0x20)
+        {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            quoted += escaped;
+        }
+        else
+        {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+// One line, no trailing newline. error is empty when the job ran.
+inline std::string BenchmarkResultJSON(const BenchmarkJob &job, const std::vector<double> &frameTimes,
+                                       const std::string &error)
+{
+    std::ostringstream json;
+    json << "{\"id\":" << job.id
+         << ",\"scene\":" << JSONString(job.scene)
+         << ",\"width\":" << job.width
+         << ",\"height\":" << job.height
+         << ",\"frames\":" << job.frames
+         << ",\"keys\":" << JSONString(job.keys);
+    if (error.empty())
+    {
+        FrameStatistics statistics(frameTimes);
+        json << ",\"ok\":true"
+             << ",\"averageMs\":" << statistics.average
+             << ",\"minimumMs\":" << statistics.minimum
+             << ",\"medianMs\":" << statistics.median
+             << ",\"p95Ms\":" << statistics.percentile95
+             << ",\"maximumMs\":" << statistics.maximum
+             << ",\"frameTimesMs\":[";
+        for (size_t iFrame = 0; iFrame < frameTimes.size(); iFrame++)
+        {
+            json << (iFrame > 0 ? "," : "") << frameTimes[iFrame] * 1000.0;
+        }
+        json << "]";
+    }
+    else
+    {
+        json << ",\"ok\":false,\"error\":" << JSONString(error);
+    }
+    json << "}";
+    return json.str();
+}
+
+// A result read back from a report. Only reads the flat objects that
+// BenchmarkResultJSON writes, one per line, not JSON in general.
+struct BenchmarkResult
+{
+    BenchmarkResult() : ok(false) {}
+
+    BenchmarkJob job;
+    bool ok;
+    std::string error;
+    std::vector<double> frameTimes;
+
+    // Identifies the same job across two reports, whatever its id
+    std::string key() const
+    {
+        std::ostringstream key;
+        key << job.scene << ' ' << job.width << 'x' << job.height;
+        if (!job.keys.empty())
+        {
+            key << " [" << job.keys << ']';
+        }
+        return key.str();
+    }
+
+    bool parseJSON(const std::string &json)
+    {
+        std::string::size_type value;
+        if (json.compare(0, 6, "{\"id\":") != 0 || (value = findValue(json, "scene")) == std::string::npos)
+        {
+            return false;
+        }
+        job.id = atoi(json.c_str() + 6);
+        job.scene = readString(json, value);
+        job.width = readInt(json, "width");
+        job.height = readInt(json, "height");
+        job.frames = readInt(json, "frames");
+        job.keys = (value = findValue(json, "keys")) != std::string::npos ? readString(json, value) : "";
+        ok = json.find("\"ok\":true") != std::string::npos;
+        error = (value = findValue(json, "error")) != std::string::npos ? readString(json, value) : "";
+
+        frameTimes.clear();
+        if ((value = findValue(json, "frameTimesMs")) != std::string::npos && json[value] == '[')
+        {
+            const char *cursor = json.c_str() + value + 1;
+            char *end;
+            for (double time = strtod(cursor, &end); end != cursor; time = strtod(cursor, &end))
+            {
+                frameTimes.push_back(time / 1000.0);
+                cursor = *end == ',' ? end + 1 : end;
+            }
+        }
+        return true;
+    }
+
+  private:
+    static std::string::size_type findValue(const std::string &json, const char *name)
+    {
+        std::string::size_type position = json.find("\"" + std::string(name) + "\":");
+        return position == std::string::npos ? position : position + strlen(name) + 3;
+    }
+
+    static int readInt(const std::string &json, const char *name)
+    {
+        std::string::size_type value = findValue(json, name);
+        return value == std::string::npos ? 0 : atoi(json.c_str() + value);
+    }
+
+    // Undoes JSONString
+    static std::string readString(const std::string &json, std::string::size_type value)
+    {
+        std::string text;
+        for (std::string::size_type iChar = value + 1; iChar < json.size() && json[iChar] != '"'; iChar++)
+        {
+            if (json[iChar] == '\\' && iChar + 1 < json.size())
+            {
+                iChar++;
+                if (json[iChar] == 'u')
+                {
+                    text += (char)strtol(json.substr(iChar + 1, 4).c_str(), NULL, 16);
+                    iChar += 4;
+                    continue;
+                }
+            }
+            text += json[iChar];
+        }
+        return text;
+    }
+};
+
+// Keeps the calling process on cores [first, first + count). Linux pins
+// hard; OS X only takes an affinity tag, which keeps each worker's threads
+// together and apart from the other workers' without naming cores.
+inline bool PinToCores(int first, int count)
+{
+#if defined(__linux__)
+    cpu_set_t cores;
+    CPU_ZERO(&cores);
+    for (int iCore = first; iCore < first + count; iCore++)
+    {
+        CPU_SET(iCore, &cores);
+    }
+    return sched_setaffinity(0, sizeof(cores), &cores) == 0;
+#elif defined(__APPLE__)
+    thread_affinity_policy_data_t policy = { first / std::max(count, 1) + 1 };
+    return thread_policy_set(mach_thread_self(), THREAD_AFFINITY_POLICY,
+                             (thread_policy_t)&policy, THREAD_AFFINITY_POLICY_COUNT) == KERN_SUCCESS;
+#else
+    return false;
+#endif
+}
+
+#endif
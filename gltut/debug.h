@@ -10,47 +10,420 @@
 #ifndef gltut_glfw_debug_h
 #define gltut_glfw_debug_h
 
+#include <string>
+
+// The severities --gldebug takes, as ranks: -1 all, 0 low, 1 medium,
+// 2 high. Checked the same way in every build, so a bad name is caught
+// even where it is then ignored.
+inline bool parseOpenGLDebugSeverity(const std::string &name, int &rank)
+{
+    const char *names[] = { "all", "low", "medium", "high" };
+    for (int iName = 0; iName < 4; iName++)
+    {
+        if (name == names[iName])
+        {
+            rank = iName - 1;
+            return true;
+        }
+    }
+    return false;
+}
+
 #ifdef DEBUG
 
+#include <stdio.h>
+#include <string.h>
 #include "stdlib.h"
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+
+#include "glcapabilities.h"
+
+// GL errors in debug builds. Where the context has KHR_debug, the driver
+// reports errors and warnings through a callback, asynchronously, and
+// printOpenGLError() only marks where the scene has got to and prints
+// what arrived since; it never waits on the driver, so debug builds can
+// be profiled. Elsewhere printOpenGLError() falls back to glGetError().
+//
+// The callback can run on driver threads, so it only copies the message
+// into a lock-free ring. Messages are printed once, with the last
+// printOpenGLError() before them, and counted; the counts are printed at
+// exit. main.cpp's --gldebug sets the lowest severity kept.
 
 const int ExitFailure = 1;
-static bool printOpenGLError(const char* file,
-                      const int line,
+
+struct OpenGLSourceLocation
+{
+    const char *file;
+    int line;
+};
+
+struct OpenGLDebugMessage
+{
+    GLenum source;
+    GLenum type;
+    GLenum severity;
+    GLuint id;
+    const OpenGLSourceLocation *after;
+    char text[240];
+};
+
+// Bounded multi-producer, multi-consumer queue: each slot's sequence says
+// whether it is free for the producer at that position or filled for the
+// consumer, so pushes and pops only contend on one atomic each
+class OpenGLDebugRing
+{
+  public:
+    static const unsigned capacity = 256;   // a power of two
+
+    OpenGLDebugRing()
+    : _enqueuePosition(0)
+    , _dequeuePosition(0)
+    {
+        for (unsigned iSlot = 0; iSlot < capacity; iSlot++)
+        {
+            _slots[iSlot].sequence.store(iSlot, std::memory_order_relaxed);
+        }
+    }
+
+    // False, dropping the message, when the ring is full
+    bool push(const OpenGLDebugMessage &message)
+    {
+        unsigned position = _enqueuePosition.load(std::memory_order_relaxed);
+        Slot *slot;
+        while (true)
+        {
+            slot = &_slots[position & (capacity - 1)];
+            int difference = (int)(slot->sequence.load(std::memory_order_acquire) - position);
+            if (difference == 0)
+            {
+                if (_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = _enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+        slot->message = message;
+        slot->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(OpenGLDebugMessage &message)
+    {
+        unsigned position = _dequeuePosition.load(std::memory_order_relaxed);
+        Slot *slot;
+        while (true)
+        {
+            slot = &_slots[position & (capacity - 1)];
+            int difference = (int)(slot->sequence.load(std::memory_order_acquire) - (position + 1));
+            if (difference == 0)
+            {
+                if (_dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = _dequeuePosition.load(std::memory_order_relaxed);
+            }
+        }
+        message = slot->message;
+        slot->sequence.store(position + capacity, std::memory_order_release);
+        return true;
+    }
+
+    // Without taking anything; may be stale by the time it returns
+    bool isEmpty() const
+    {
+        return _enqueuePosition.load(std::memory_order_relaxed) == _dequeuePosition.load(std::memory_order_relaxed);
+    }
+
+  private:
+    struct Slot
+    {
+        std::atomic<unsigned> sequence;
+        OpenGLDebugMessage message;
+    };
+
+    Slot _slots[capacity];
+    std::atomic<unsigned> _enqueuePosition;
+    std::atomic<unsigned> _dequeuePosition;
+};
+
+class OpenGLDebugLog
+{
+  public:
+    OpenGLDebugLog()
+    : _active(false)
+    , _minimumSeverityRank(1)
+    , _lastCheckpoint(NULL)
+    , _dropped(0)
+    {
+    }
+
+    // "high", "medium", "low" or "all"; medium unless set before install()
+    bool setMinimumSeverity(const std::string &name)
+    {
+        return parseOpenGLDebugSeverity(name, _minimumSeverityRank);
+    }
+
+    // Routes the current context's messages here, where it has KHR_debug
+    void install()
+    {
+#ifdef GL_DEBUG_OUTPUT
+        if (!sharedGLCapabilities().debugOutput)
+        {
+            return;
+        }
+
+        glEnable(GL_DEBUG_OUTPUT);
+        glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+        glDebugMessageCallback(receive, this);
+        glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, NULL, GL_TRUE);
+        const GLenum severities[] = { GL_DEBUG_SEVERITY_NOTIFICATION, GL_DEBUG_SEVERITY_LOW, GL_DEBUG_SEVERITY_MEDIUM };
+        for (int iSeverity = 0; iSeverity < _minimumSeverityRank + 1 && iSeverity < 3; iSeverity++)
+        {
+            glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, severities[iSeverity], 0, NULL, GL_FALSE);
+        }
+
+        if (!_active.exchange(true))
+        {
+            atexit(printSummaryAtExit);
+        }
+#endif
+    }
+
+    bool isActive() const { return _active.load(std::memory_order_relaxed); }
+
+    // Messages that arrive from now on are reported as after location
+    void checkpoint(const OpenGLSourceLocation *location)
+    {
+        _lastCheckpoint.store(location, std::memory_order_relaxed);
+    }
+
+    // Prints the messages not seen before; true if any of those arriving
+    // was an error
+    bool drain()
+    {
+        if (_ring.isEmpty())
+        {
+            return false;
+        }
+
+        bool errorHappened = false;
+        std::lock_guard<std::mutex> lock(_mutex);
+        OpenGLDebugMessage message;
+        while (_ring.pop(message))
+        {
+            errorHappened = errorHappened || message.type == errorType();
+            Entry &entry = _entries[key(message)];
+            if (entry.count++ == 0)
+            {
+                entry.message = message;
+                print(message, "");
+            }
+        }
+        return errorHappened;
+    }
+
+    void printSummary()
+    {
+        drain();
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_entries.empty() && _dropped == 0)
+        {
+            return;
+        }
+        printf("GL debug messages:\n");
+        for (std::map<std::string, Entry>::const_iterator iEntry = _entries.begin(); iEntry != _entries.end(); iEntry++)
+        {
+            char count[32];
+            snprintf(count, sizeof(count), "%8ld x ", iEntry->second.count);
+            print(iEntry->second.message, count);
+        }
+        if (_dropped > 0)
+        {
+            printf("%8ld dropped with the ring full\n", (long)_dropped.load());
+        }
+    }
+
+  private:
+    OpenGLDebugLog(const OpenGLDebugLog &);
+    OpenGLDebugLog &operator=(const OpenGLDebugLog &);
+
+    struct Entry
+    {
+        Entry() : count(0) {}
+        long count;
+        OpenGLDebugMessage message;
+    };
+
+    static GLenum errorType()
+    {
+#ifdef GL_DEBUG_OUTPUT
+        return GL_DEBUG_TYPE_ERROR;
+#else
+        return 0;
+#endif
+    }
+
+    static std::string key(const OpenGLDebugMessage &message)
+    {
+        char numbers[64];
+        snprintf(numbers, sizeof(numbers), "%x %x %x %u ", message.source, message.type, message.severity, message.id);
+        return numbers + std::string(message.text);
+    }
+
+    static const char *severityName(GLenum severity)
+    {
+#ifdef GL_DEBUG_OUTPUT
+        switch (severity)
+        {
+            case GL_DEBUG_SEVERITY_HIGH: return "high";
+            case GL_DEBUG_SEVERITY_MEDIUM: return "medium";
+            case GL_DEBUG_SEVERITY_LOW: return "low";
+        }
+#endif
+        return "notification";
+    }
+
+    static void print(const OpenGLDebugMessage &message, const char *prefix)
+    {
+        printf("%sGL debug (%s%s)", prefix, severityName(message.severity),
+               message.type == errorType() ? " error" : "");
+        if (message.after != NULL)
+        {
+            printf(" after %s:%d", message.after->file, message.after->line);
+        }
+        printf(": %s\n", message.text);
+    }
+
+#ifdef GL_DEBUG_OUTPUT
+    static void APIENTRY receive(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+                                 const GLchar *text, const void *userParam)
+    {
+        OpenGLDebugLog *log = (OpenGLDebugLog *)userParam;
+        OpenGLDebugMessage message;
+        message.source = source;
+        message.type = type;
+        message.severity = severity;
+        message.id = id;
+        message.after = log->_lastCheckpoint.load(std::memory_order_relaxed);
+        size_t textLength = length >= 0 ? (size_t)length : strlen(text);
+        textLength = std::min(textLength, sizeof(message.text) - 1);
+        memcpy(message.text, text, textLength);
+        message.text[textLength] = '\0';
+        if (!log->_ring.push(message))
+        {
+            log->_dropped++;
+        }
+    }
+#endif
+
+    static void printSummaryAtExit();
+
+    std::atomic<bool> _active;
+    int _minimumSeverityRank;   // -1 all, 0 low, 1 medium, 2 high
+    std::atomic<const OpenGLSourceLocation *> _lastCheckpoint;
+    std::atomic<long> _dropped;
+    OpenGLDebugRing _ring;
+    std::mutex _mutex;
+    std::map<std::string, Entry> _entries;
+};
+
+inline OpenGLDebugLog &sharedOpenGLDebugLog()
+{
+    static OpenGLDebugLog log;
+    return log;
+}
+
+inline void OpenGLDebugLog::printSummaryAtExit()
+{
+    sharedOpenGLDebugLog().printSummary();
+}
+
+inline void installOpenGLDebugOutput()
+{
+    sharedOpenGLDebugLog().install();
+}
+
+inline bool setOpenGLDebugSeverity(const std::string &name)
+{
+    return sharedOpenGLDebugLog().setMinimumSeverity(name);
+}
+
+static bool printOpenGLError(const OpenGLSourceLocation *location,
                       const char* extraInformation,
                       bool exitOnError)
 {
-    
-    GLenum errorCode;
+    OpenGLDebugLog &debugLog = sharedOpenGLDebugLog();
     bool errorHappened = false;
-    
-    errorCode = glGetError();
-    if (errorCode != GL_NO_ERROR)
+
+    if (debugLog.isActive())
+    {
+        errorHappened = debugLog.drain();
+        debugLog.checkpoint(location);
+    }
+    else
+    {
+        GLenum errorCode = glGetError();
+        if (errorCode != GL_NO_ERROR)
+        {
+            printf("glError in file %s:%d: OpenGL Error 0x%x\n",
+                   location->file, location->line, errorCode);
+            errorHappened = true;
+        }
+    }
+
+    if (errorHappened)
     {
-        printf("glError in file %s:%d: OpenGL Error 0x%x\n",
-               file, line, errorCode);
         if (extraInformation != NULL)
         {
             printf("  %s\n", extraInformation);
         }
-        errorHappened = true;
-        
+
         if ( exitOnError )
         {
             exit(ExitFailure);
         }
-        
+
     }
-    
+
     return errorHappened;
 }
 
-#define printOpenGLError() printOpenGLError(__FILE__, __LINE__, NULL, false)
+#define printOpenGLError() \
+    do { \
+        static const OpenGLSourceLocation openGLErrorLocation = { __FILE__, __LINE__ }; \
+        printOpenGLError(&openGLErrorLocation, NULL, false); \
+    } while (0)
 
 #else
 
 #define printOpenGLError() ;
 
+inline void installOpenGLDebugOutput()
+{
+}
+
+// Release builds have no debug log to filter
+inline bool setOpenGLDebugSeverity(const std::string &name)
+{
+    int rank;
+    return parseOpenGLDebugSeverity(name, rank);
+}
+
 #endif
 
 #endif
@@ -0,0 +1,625 @@
+//
+//  drawstrategy.h
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+
+#ifndef gltut_glfw_drawstrategy_h
+#define gltut_glfw_drawstrategy_h
+
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "glcapabilities.h"
+#include "gpuresource.h"
+#include "glm.hpp"
+#include "gtc/type_ptr.hpp"
+
+// Four ways of submitting the same N copies of a mesh, each with its own
+// model-to-camera matrix, behind one interface so they can be timed
+// against each other:
+//
+//  - PerDrawUniformStrategy: glUniformMatrix4fv and glDrawElements per
+//    object, the way the chapters draw.
+//  - UniformRingStrategy: the matrices are written into a ring of uniform
+//    buffer slots, and each object's draw binds its slot with
+//    glBindBufferRange. Slots are written unsynchronized; the ring is
+//    orphaned when it wraps.
+//  - InstancedStrategy: one glDrawElementsInstanced, with the matrix as a
+//    per-instance vertex attribute.
+//  - MultiDrawStrategy: one glMultiDrawElementsIndirect where the context
+//    has it, with each command's base instance picking the object's index
+//    out of a per-instance attribute. Otherwise one
+//    glMultiDrawElementsBaseVertex: GL 3.x has no gl_DrawID, so the mesh
+//    is replicated once per object with the object's index as a vertex
+//    attribute, and the copies cap the object count. Either way the shader
+//    fetches the object's matrix from a texture buffer.
+//
+// Every strategy uploads all the matrices every frame, as for moving
+// objects. The chapters register the mesh they draw their objects with,
+// laid out the way they upload it (all positions, then all colors):
+//
+//  REGISTER_DRAW_BENCHMARK_MESH("gltut 06d", vertexData, numberOfVertices, indexData, ARRAY_COUNT(indexData));
+//
+// main.cpp --drawbench sweeps the object count for every strategy. It runs
+// without a scene, so the strategies' GL objects are recorded with the
+// tracker as the application's.
+
+struct DrawBenchmarkMesh
+{
+    std::string scene;
+    const float *vertexData;    // vertexCount xyz positions, then vertexCount rgba colors
+    int vertexCount;
+    const GLshort *indexData;
+    int indexCount;
+};
+
+inline std::vector<DrawBenchmarkMesh> &sharedDrawBenchmarkMeshes()
+{
+    static std::vector<DrawBenchmarkMesh> meshes;
+    return meshes;
+}
+
+struct DrawBenchmarkMeshRegistrar
+{
+    DrawBenchmarkMeshRegistrar(const char *scene, const float *vertexData, int vertexCount,
+                               const GLshort *indexData, int indexCount)
+    {
+        DrawBenchmarkMesh mesh = { scene, vertexData, vertexCount, indexData, indexCount };
+        sharedDrawBenchmarkMeshes().push_back(mesh);
+    }
+};
+
+// Use at namespace scope, once per mesh
+#define REGISTER_DRAW_BENCHMARK_MESH(scene, vertexData, vertexCount, indexData, indexCount) \
+    DrawBenchmarkMeshRegistrar drawBenchmarkMeshRegistrar(scene, vertexData, vertexCount, indexData, indexCount)
+
+class DrawStrategy
+{
+  public:
+    DrawStrategy()
+    : _indexCount(0)
+    , _cameraToClipMatrixUniform(-1)
+    {
+    }
+
+    virtual ~DrawStrategy()
+    {
+    }
+
+    virtual const char *name() const = 0;
+
+    // False when the context lacks what the strategy draws with
+    virtual bool supported() const { return true; }
+
+    // Most objects one draw() can take, 0 for no limit
+    virtual int maxObjectCount() const { return 0; }
+
+    // Builds the program and the mesh buffers; throws if the program fails
+    virtual void init(const DrawBenchmarkMesh &mesh) = 0;
+
+    // Sizes per-object storage for objectCount objects, outside the timing
+    virtual void prepare(int) {}
+
+    // Uploads the matrices and draws one object per matrix
+    virtual void draw(const std::vector<glm::mat4> &modelToCameraMatrices, const glm::mat4 &cameraToClipMatrix) = 0;
+
+  protected:
+    // The 06x vertex shader inputs, with the per-object matrix supplied by
+    // the declarations and the expression the strategy passes in
+    static std::string vertexShaderSource(const std::string &declarations, const std::string &modelToCameraMatrix)
+    {
+        return "#version 330\n"
+               "layout(location = 0) in vec4 position;\n"
+               "layout(location = 1) in vec4 color;\n"
+               "smooth out vec4 theColor;\n"
+               "uniform mat4 cameraToClipMatrix;\n"
+               + declarations +
+               "void main()\n"
+               "{\n"
+               "    gl_Position = cameraToClipMatrix * (" + modelToCameraMatrix + " * position);\n"
+               "    theColor = color;\n"
+               "}\n";
+    }
+
+    void createProgram(const std::string &declarations, const std::string &modelToCameraMatrix)
+    {
+        const std::string fragmentSource =
+            "#version 330\n"
+            "smooth in vec4 theColor;\n"
+            "out vec4 outputColor;\n"
+            "void main()\n"
+            "{\n"
+            "    outputColor = theColor;\n"
+            "}\n";
+
+        _program.reset(createShaderProgramWithSource(vertexShaderSource(declarations, modelToCameraMatrix), fragmentSource),
+                       GPUPrograms, GPUOwnedByApplication);
+        _cameraToClipMatrixUniform = glGetUniformLocation(_program, "cameraToClipMatrix");
+    }
+
+    // Uploads copies of the mesh one after the other, leaving the vertex
+    // array bound with position and color set up
+    void createMeshBuffers(const DrawBenchmarkMesh &mesh, int copies)
+    {
+        std::vector<float> vertices((size_t)mesh.vertexCount * 7 * copies);
+        float *positions = &vertices[0];
+        float *colors = positions + (size_t)mesh.vertexCount * 3 * copies;
+        for (int iCopy = 0; iCopy < copies; iCopy++)
+        {
+            std::copy(mesh.vertexData, mesh.vertexData + mesh.vertexCount * 3, positions + (size_t)iCopy * mesh.vertexCount * 3);
+            std::copy(mesh.vertexData + mesh.vertexCount * 3, mesh.vertexData + mesh.vertexCount * 7,
+                      colors + (size_t)iCopy * mesh.vertexCount * 4);
+        }
+
+        _indexCount = mesh.indexCount;
+
+        _vertexArray.create(GPUVertexArrays, GPUOwnedByApplication);
+        glBindVertexArray(_vertexArray);
+
+        _vertexBuffer.create(GPUVertexData, GPUOwnedByApplication);
+        _vertexBuffer.bufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, (void *)(sizeof(float) * 3 * mesh.vertexCount * copies));
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        _indexBuffer.create(GPUIndexData, GPUOwnedByApplication);
+        _indexBuffer.bufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indexCount * sizeof(GLshort), mesh.indexData, GL_STATIC_DRAW);
+    }
+
+    void useProgram(const glm::mat4 &cameraToClipMatrix)
+    {
+        glUseProgram(_program);
+        glUniformMatrix4fv(_cameraToClipMatrixUniform, 1, GL_FALSE, glm::value_ptr(cameraToClipMatrix));
+        glBindVertexArray(_vertexArray);
+    }
+
+    GLProgram _program;
+    GLVertexArray _vertexArray;
+    GLBuffer _vertexBuffer;
+    GLBuffer _indexBuffer;
+    int _indexCount;
+    GLint _cameraToClipMatrixUniform;
+
+  private:
+    DrawStrategy(const DrawStrategy &);
+    DrawStrategy &operator=(const DrawStrategy &);
+};
+
+class PerDrawUniformStrategy : public DrawStrategy
+{
+  public:
+    PerDrawUniformStrategy() : _modelToCameraMatrixUniform(-1) {}
+
+    virtual const char *name() const { return "per-draw uniform"; }
+
+    virtual void init(const DrawBenchmarkMesh &mesh)
+    {
+        createProgram("uniform mat4 modelToCameraMatrix;\n", "modelToCameraMatrix");
+        _modelToCameraMatrixUniform = glGetUniformLocation(_program, "modelToCameraMatrix");
+        createMeshBuffers(mesh, 1);
+        glBindVertexArray(0);
+    }
+
+    virtual void draw(const std::vector<glm::mat4> &modelToCameraMatrices, const glm::mat4 &cameraToClipMatrix)
+    {
+        useProgram(cameraToClipMatrix);
+        for (size_t iObject = 0; iObject < modelToCameraMatrices.size(); iObject++)
+        {
+            glUniformMatrix4fv(_modelToCameraMatrixUniform, 1, GL_FALSE, glm::value_ptr(modelToCameraMatrices[iObject]));
+            glDrawElements(GL_TRIANGLES, _indexCount, GL_UNSIGNED_SHORT, 0);
+        }
+        glBindVertexArray(0);
+        glUseProgram(0);
+    }
+
+  private:
+    GLint _modelToCameraMatrixUniform;
+};
+
+class UniformRingStrategy : public DrawStrategy
+{
+  public:
+    static const GLuint bindingPoint = 0;
+
+    UniformRingStrategy()
+    : _ringSize(4 << 20)
+    , _slotSize(0)
+    , _ringOffset(0)
+    {
+    }
+
+    virtual const char *name() const { return "uniform buffer ring"; }
+
+    virtual void init(const DrawBenchmarkMesh &mesh)
+    {
+        createProgram("layout(std140) uniform Object\n"
+                      "{\n"
+                      "    mat4 modelToCameraMatrix;\n"
+                      "};\n",
+                      "modelToCameraMatrix");
+        glUniformBlockBinding(_program, glGetUniformBlockIndex(_program, "Object"), bindingPoint);
+        createMeshBuffers(mesh, 1);
+        glBindVertexArray(0);
+
+        // Each slot starts on the alignment glBindBufferRange requires
+        GLint alignment = std::max(sharedGLCapabilities().uniformBufferOffsetAlignment, 1);
+        _slotSize = ((GLsizeiptr)sizeof(glm::mat4) + alignment - 1) / alignment * alignment;
+
+        _ringBuffer.create(GPUUniformData, GPUOwnedByApplication);
+        _ringBuffer.bufferData(GL_UNIFORM_BUFFER, _ringSize, NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        _ringOffset = 0;
+    }
+
+    virtual void draw(const std::vector<glm::mat4> &modelToCameraMatrices, const glm::mat4 &cameraToClipMatrix)
+    {
+        useProgram(cameraToClipMatrix);
+        glBindBuffer(GL_UNIFORM_BUFFER, _ringBuffer);
+
+        size_t objectCount = modelToCameraMatrices.size();
+        for (size_t firstObject = 0; firstObject < objectCount; )
+        {
+            // Orphan the ring when it is full: the driver hands out fresh
+            // storage and frees the old one once the GPU is done with it
+            if (_ringOffset + _slotSize > _ringSize)
+            {
+                glBufferData(GL_UNIFORM_BUFFER, _ringSize, NULL, GL_STREAM_DRAW);
+                _ringOffset = 0;
+            }
+
+            size_t batchCount = std::min(objectCount - firstObject, (size_t)((_ringSize - _ringOffset) / _slotSize));
+            unsigned char *slots = (unsigned char *)glMapBufferRange(GL_UNIFORM_BUFFER, _ringOffset,
+                                                                     (GLsizeiptr)batchCount * _slotSize,
+                                                                     GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT
+                                                                     | GL_MAP_UNSYNCHRONIZED_BIT);
+            if (slots == NULL)
+            {
+                break;
+            }
+            for (size_t iObject = 0; iObject < batchCount; iObject++)
+            {
+                memcpy(slots + iObject * _slotSize, glm::value_ptr(modelToCameraMatrices[firstObject + iObject]),
+                       sizeof(glm::mat4));
+            }
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+
+            for (size_t iObject = 0; iObject < batchCount; iObject++)
+            {
+                glBindBufferRange(GL_UNIFORM_BUFFER, bindingPoint, _ringBuffer, _ringOffset, sizeof(glm::mat4));
+                glDrawElements(GL_TRIANGLES, _indexCount, GL_UNSIGNED_SHORT, 0);
+                _ringOffset += _slotSize;
+            }
+            firstObject += batchCount;
+        }
+
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindVertexArray(0);
+        glUseProgram(0);
+    }
+
+  private:
+    GLBuffer _ringBuffer;
+    GLsizeiptr _ringSize;
+    GLsizeiptr _slotSize;
+    GLintptr _ringOffset;
+};
+
+class InstancedStrategy : public DrawStrategy
+{
+  public:
+    InstancedStrategy() {}
+
+    virtual const char *name() const { return "instanced"; }
+    virtual bool supported() const { return sharedGLCapabilities().instancedArrays; }
+
+    virtual void init(const DrawBenchmarkMesh &mesh)
+    {
+        createProgram("layout(location = 2) in mat4 modelToCameraMatrix;\n", "modelToCameraMatrix");
+        createMeshBuffers(mesh, 1);
+
+        // A mat4 attribute takes four locations, one column each
+        _instanceBuffer.create(GPUVertexData, GPUOwnedByApplication);
+        glBindBuffer(GL_ARRAY_BUFFER, _instanceBuffer);
+        for (int iColumn = 0; iColumn < 4; iColumn++)
+        {
+            glEnableVertexAttribArray(2 + iColumn);
+            glVertexAttribPointer(2 + iColumn, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                                  (void *)(sizeof(glm::vec4) * iColumn));
+            glVertexAttribDivisor(2 + iColumn, 1);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+    }
+
+    virtual void draw(const std::vector<glm::mat4> &modelToCameraMatrices, const glm::mat4 &cameraToClipMatrix)
+    {
+        if (modelToCameraMatrices.empty())
+        {
+            return;
+        }
+
+        // Orphaned every frame so the upload never waits for the last draw
+        GLsizeiptr size = (GLsizeiptr)(modelToCameraMatrices.size() * sizeof(glm::mat4));
+        _instanceBuffer.bufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, size, &modelToCameraMatrices[0]);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        useProgram(cameraToClipMatrix);
+        glDrawElementsInstanced(GL_TRIANGLES, _indexCount, GL_UNSIGNED_SHORT, 0, (GLsizei)modelToCameraMatrices.size());
+        glBindVertexArray(0);
+        glUseProgram(0);
+    }
+
+  private:
+    GLBuffer _instanceBuffer;
+};
+
+class MultiDrawStrategy : public DrawStrategy
+{
+  public:
+    // Enough copies of a 24-vertex cube to take about 80 MB
+    static const int maxObjects = 100000;
+
+    MultiDrawStrategy()
+    : _matrixSamplerUniform(-1)
+    , _indirect(false)
+    , _vertexCount(0)
+    , _copies(0)
+    , _commandCount(0)
+    {
+    }
+
+    virtual const char *name() const { return _indirect ? "multi-draw indirect" : "multi-draw"; }
+    // The matrices are fetched from a texture buffer, four texels each, so
+    // GL_MAX_TEXTURE_BUFFER_SIZE bounds the count as well as the copies do
+    virtual int maxObjectCount() const
+    {
+        int textureBufferObjects = sharedGLCapabilities().maxTextureBufferSize / 4;
+        if (_indirect)
+        {
+            return textureBufferObjects;
+        }
+        return textureBufferObjects > 0 ? std::min(textureBufferObjects, (int)maxObjects) : maxObjects;
+    }
+
+    virtual void init(const DrawBenchmarkMesh &mesh)
+    {
+        createProgram("layout(location = 2) in float objectIndex;\n"
+                      "uniform samplerBuffer modelToCameraMatrices;\n"
+                      "mat4 fetchModelToCameraMatrix()\n"
+                      "{\n"
+                      "    int first = int(objectIndex) * 4;\n"
+                      "    return mat4(texelFetch(modelToCameraMatrices, first), texelFetch(modelToCameraMatrices, first + 1),\n"
+                      "                texelFetch(modelToCameraMatrices, first + 2), texelFetch(modelToCameraMatrices, first + 3));\n"
+                      "}\n",
+                      "fetchModelToCameraMatrix()");
+        _matrixSamplerUniform = glGetUniformLocation(_program, "modelToCameraMatrices");
+        _mesh = mesh;
+        _vertexCount = mesh.vertexCount;
+
+        _objectIndexBuffer.create(GPUVertexData, GPUOwnedByApplication);
+        _matrixBuffer.create(GPUTextureData, GPUOwnedByApplication);
+        _matrixTexture.create(GPUTextureData, GPUOwnedByApplication);
+
+#if defined(GL_VERSION_4_3) || defined(GL_ARB_multi_draw_indirect)
+        // One copy of the mesh; the object index advances once per instance,
+        // and each command draws one instance starting at its object
+        _indirect = sharedGLCapabilities().multiDrawIndirect;
+        if (_indirect)
+        {
+            createMeshBuffers(mesh, 1);
+            glBindBuffer(GL_ARRAY_BUFFER, _objectIndexBuffer);
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, 0, 0);
+            glVertexAttribDivisor(2, 1);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindVertexArray(0);
+            _commandBuffer.create(GPUVertexData, GPUOwnedByApplication);
+        }
+#endif
+    }
+
+    virtual void prepare(int objectCount)
+    {
+        if (_indirect)
+        {
+            prepareCommands(objectCount);
+        }
+        else
+        {
+            prepareCopies(objectCount);
+        }
+    }
+
+    virtual void draw(const std::vector<glm::mat4> &modelToCameraMatrices, const glm::mat4 &cameraToClipMatrix)
+    {
+        GLsizei objectCount = (GLsizei)std::min(modelToCameraMatrices.size(),
+                                                _indirect ? (size_t)_commandCount : _counts.size());
+        if (objectCount == 0)
+        {
+            return;
+        }
+
+        GLsizeiptr size = (GLsizeiptr)(objectCount * sizeof(glm::mat4));
+        _matrixBuffer.bufferData(GL_TEXTURE_BUFFER, size, NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, size, &modelToCameraMatrices[0]);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        useProgram(cameraToClipMatrix);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_BUFFER, _matrixTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, _matrixBuffer);
+        glUniform1i(_matrixSamplerUniform, 0);
+
+#if defined(GL_VERSION_4_3) || defined(GL_ARB_multi_draw_indirect)
+        if (_indirect)
+        {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, 0, objectCount, 0);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        }
+        else
+#endif
+        {
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES, &_counts[0], GL_UNSIGNED_SHORT, &_indexOffsets[0], objectCount,
+                                          &_baseVertices[0]);
+        }
+
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindVertexArray(0);
+        glUseProgram(0);
+    }
+
+  private:
+    // The layout glMultiDrawElementsIndirect reads its commands in
+    struct DrawElementsIndirectCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    // Replicates the mesh when the count outgrows the copies uploaded so far
+    void prepareCopies(int objectCount)
+    {
+        objectCount = std::min(objectCount, (int)maxObjects);
+        if (objectCount > _copies)
+        {
+            _copies = std::max(objectCount, std::min(_copies * 4, (int)maxObjects));
+            createMeshBuffers(_mesh, _copies);
+
+            std::vector<float> objectIndices((size_t)_vertexCount * _copies);
+            for (size_t iVertex = 0; iVertex < objectIndices.size(); iVertex++)
+            {
+                objectIndices[iVertex] = (float)(iVertex / _vertexCount);
+            }
+            _objectIndexBuffer.bufferData(GL_ARRAY_BUFFER, objectIndices.size() * sizeof(float), &objectIndices[0],
+                                          GL_STATIC_DRAW);
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, 0, 0);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindVertexArray(0);
+        }
+
+        _counts.assign(objectCount, _indexCount);
+        _indexOffsets.assign(objectCount, (const GLvoid *)0);
+        _baseVertices.resize(objectCount);
+        for (int iObject = 0; iObject < objectCount; iObject++)
+        {
+            _baseVertices[iObject] = iObject * _vertexCount;
+        }
+    }
+
+    // The commands and object indices only depend on the count, so they
+    // are uploaded here once rather than every frame
+    void prepareCommands(int objectCount)
+    {
+#if defined(GL_VERSION_4_3) || defined(GL_ARB_multi_draw_indirect)
+        if (objectCount == _commandCount)
+        {
+            return;
+        }
+
+        std::vector<float> objectIndices(objectCount);
+        std::vector<DrawElementsIndirectCommand> commands(objectCount);
+        for (int iObject = 0; iObject < objectCount; iObject++)
+        {
+            objectIndices[iObject] = (float)iObject;
+            DrawElementsIndirectCommand command = { (GLuint)_indexCount, 1, 0, 0, (GLuint)iObject };
+            commands[iObject] = command;
+        }
+        if (objectCount > 0)
+        {
+            _objectIndexBuffer.bufferData(GL_ARRAY_BUFFER, objectIndices.size() * sizeof(float), &objectIndices[0],
+                                          GL_STATIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            _commandBuffer.bufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand),
+                                      &commands[0], GL_STATIC_DRAW);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        }
+        _commandCount = objectCount;
+#endif
+    }
+
+    GLBuffer _objectIndexBuffer;
+    GLBuffer _matrixBuffer;
+    GLTexture _matrixTexture;
+    GLBuffer _commandBuffer;
+    GLint _matrixSamplerUniform;
+    bool _indirect;
+    DrawBenchmarkMesh _mesh;
+    int _vertexCount;
+    int _copies;
+    int _commandCount;
+    std::vector<GLsizei> _counts;
+    std::vector<const GLvoid *> _indexOffsets;
+    std::vector<GLint> _baseVertices;
+};
+
+struct DrawStrategyTiming
+{
+    double cpuMilliseconds;     // submitting the frame, median
+    double gpuMilliseconds;     // executing it, median; 0 without timer queries
+};
+
+// Draws frameCount timed frames after one untimed one, into whatever
+// framebuffer is bound, and finishes each so frames do not overlap
+inline DrawStrategyTiming MeasureDrawStrategy(DrawStrategy &strategy, const std::vector<glm::mat4> &modelToCameraMatrices,
+                                              const glm::mat4 &cameraToClipMatrix, int frameCount)
+{
+    strategy.prepare((int)modelToCameraMatrices.size());
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    strategy.draw(modelToCameraMatrices, cameraToClipMatrix);
+    glFinish();
+
+    std::vector<double> cpuTimes(frameCount);
+    std::vector<double> gpuTimes(frameCount, 0.0);
+    GLQuery query;
+#ifdef GL_TIME_ELAPSED
+    if (sharedGLCapabilities().timerQuery)
+    {
+        query.create(GPUQueries, GPUOwnedByApplication);
+    }
+#endif
+    for (int iFrame = 0; iFrame < frameCount; iFrame++)
+    {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+#ifdef GL_TIME_ELAPSED
+        if (query != 0)
+        {
+            glBeginQuery(GL_TIME_ELAPSED, query);
+        }
+#endif
+        double start = glfwGetTime();
+        strategy.draw(modelToCameraMatrices, cameraToClipMatrix);
+        cpuTimes[iFrame] = (glfwGetTime() - start) * 1000.0;
+#ifdef GL_TIME_ELAPSED
+        if (query != 0)
+        {
+            glEndQuery(GL_TIME_ELAPSED);
+            GLuint64 elapsedNanoseconds = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsedNanoseconds);
+            gpuTimes[iFrame] = elapsedNanoseconds / 1e6;
+            continue;
+        }
+#endif
+        glFinish();
+    }
+
+    std::sort(cpuTimes.begin(), cpuTimes.end());
+    std::sort(gpuTimes.begin(), gpuTimes.end());
+    DrawStrategyTiming timing = { cpuTimes[frameCount / 2], gpuTimes[frameCount / 2] };
+    return timing;
+}
+
+#endif
@@ -0,0 +1,420 @@
+//
+//  dynamicresolution.h
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+
+#ifndef gltut_glfw_dynamicresolution_h
+#define gltut_glfw_dynamicresolution_h
+
+#include <math.h>
+#include <algorithm>
+#include <string>
+
+#include "glcapabilities.h"
+#include "gpuresource.h"
+
+// Renders the scene into an offscreen target whose resolution follows a
+// frame-time budget, then upscales it to the window.
+//
+// The offscreen target is allocated at full framebuffer size and the scene
+// only renders into its lower-left corner, so changing the scale never
+// reallocates anything. GPU time comes from GL_TIME_ELAPSED queries read a
+// few frames late (CPU frame time where timer queries are unavailable) and
+// feeds a PID controller on the rendered pixel count.
+//
+//  dynamicResolution.beginFrame();
+//  scene.draw();
+//  dynamicResolution.endFrame();
+
+enum UpscaleFilter
+{
+    UpscaleFilterBilinear,  // glBlitFramebuffer with GL_LINEAR
+    UpscaleFilterSharpen,   // bilinear plus an unsharp mask in a full-screen pass
+};
+
+class DynamicResolution
+{
+  public:
+    DynamicResolution()
+    : _enabled(false)
+    , _filter(UpscaleFilterBilinear)
+    , _targetFrameTime(1.0 / 60.0)
+    , _minScale(0.35f)
+    , _maxScale(1.0f)
+    , _scale(1.0f)
+    , _proportionalGain(0.6f)
+    , _integralGain(0.05f)
+    , _derivativeGain(0.1f)
+    , _integral(0.0f)
+    , _previousError(0.0f)
+    , _lastFrameTime(0.0)
+    , _framebufferWidth(0)
+    , _framebufferHeight(0)
+    , _sharpenSourceScaleUniform(0)
+    , _sharpenTexelSizeUniform(0)
+    , _queryIndex(0)
+    , _cpuFrameStart(0.0)
+    {
+        for (int iQuery = 0; iQuery < queryCount; iQuery++)
+        {
+            _queryPending[iQuery] = false;
+        }
+        _sceneViewport[0] = _sceneViewport[1] = _sceneViewport[2] = _sceneViewport[3] = 0;
+    }
+
+    ~DynamicResolution()
+    {
+        destroy();
+    }
+
+    // Deletes every GL object, for before the context goes; the next
+    // enabled frame makes them again
+    void destroy()
+    {
+        destroyTarget();
+        for (int iQuery = 0; iQuery < queryCount; iQuery++)
+        {
+            _timerQueries[iQuery].reset();
+            _queryPending[iQuery] = false;
+        }
+        _sharpenProgram.reset();
+        _emptyVertexArray.reset();
+    }
+
+    void setEnabled(bool enabled) { _enabled = enabled; _scale = _maxScale; _integral = 0.0f; _previousError = 0.0f; }
+    bool enabled() const { return _enabled; }
+
+    void setUpscaleFilter(UpscaleFilter filter) { _filter = filter; }
+    UpscaleFilter upscaleFilter() const { return _filter; }
+
+    void setTargetFrameTime(double seconds) { _targetFrameTime = seconds; }
+    void setScaleLimits(float minScale, float maxScale) { _minScale = minScale; _maxScale = maxScale; }
+    void setControllerGains(float proportional, float integral, float derivative)
+    {
+        _proportionalGain = proportional;
+        _integralGain = integral;
+        _derivativeGain = derivative;
+    }
+
+    // Per-axis fraction of the framebuffer currently rendered
+    float scale() const { return _scale; }
+    // Seconds, as measured for the last frame that reached the controller
+    double lastFrameTime() const { return _lastFrameTime; }
+
+    // Call from the framebuffer size callback
+    void resize(int framebufferWidth, int framebufferHeight)
+    {
+        _framebufferWidth = framebufferWidth;
+        _framebufferHeight = framebufferHeight;
+        destroyTarget();
+    }
+
+    void beginFrame()
+    {
+        if (!_enabled || _framebufferWidth <= 0 || _framebufferHeight <= 0)
+        {
+            return;
+        }
+
+        if (_framebuffer == 0)
+        {
+            createTarget();
+        }
+
+        // Scenes set their viewport in reshape(); shrink that one rather than assuming full screen
+        glGetIntegerv(GL_VIEWPORT, _sceneViewport);
+        glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+        glViewport((GLint)(_sceneViewport[0] * _scale), (GLint)(_sceneViewport[1] * _scale),
+                   std::max((GLsizei)(_sceneViewport[2] * _scale), 1), std::max((GLsizei)(_sceneViewport[3] * _scale), 1));
+
+        beginTiming();
+    }
+
+    void endFrame()
+    {
+        if (_framebuffer == 0 || !_enabled)
+        {
+            return;
+        }
+
+        endTiming();
+
+        GLint renderWidth = std::max((GLint)(_framebufferWidth * _scale), 1);
+        GLint renderHeight = std::max((GLint)(_framebufferHeight * _scale), 1);
+
+        if (_filter == UpscaleFilterSharpen)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            sharpenToScreen(renderWidth, renderHeight);
+        }
+        else
+        {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, _framebuffer);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+            glBlitFramebuffer(0, 0, renderWidth, renderHeight,
+                              0, 0, _framebufferWidth, _framebufferHeight,
+                              GL_COLOR_BUFFER_BIT, GL_LINEAR);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        }
+
+        glViewport(_sceneViewport[0], _sceneViewport[1], _sceneViewport[2], _sceneViewport[3]);
+        printOpenGLError();
+
+        updateScale();
+    }
+
+  private:
+    static const int queryCount = 4;
+
+    DynamicResolution(const DynamicResolution &);
+    DynamicResolution &operator=(const DynamicResolution &);
+
+    void createTarget()
+    {
+        size_t bytes = (size_t)_framebufferWidth * _framebufferHeight * 4;
+        _colorTexture.create(GPURenderTargets, GPUOwnedByApplication);
+        _colorTexture.setSize(bytes);
+        glBindTexture(GL_TEXTURE_2D, _colorTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, _framebufferWidth, _framebufferHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        _depthRenderbuffer.create(GPURenderTargets, GPUOwnedByApplication);
+        _depthRenderbuffer.setSize(bytes);
+        glBindRenderbuffer(GL_RENDERBUFFER, _depthRenderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, _framebufferWidth, _framebufferHeight);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        _framebuffer.create(GPUFramebuffers, GPUOwnedByApplication);
+        glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _colorTexture, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depthRenderbuffer);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            fprintf(stderr, "Dynamic resolution framebuffer incomplete, disabling\n");
+            _enabled = false;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        printOpenGLError();
+    }
+
+    void destroyTarget()
+    {
+        _framebuffer.reset();
+        _depthRenderbuffer.reset();
+        _colorTexture.reset();
+    }
+
+    void beginTiming()
+    {
+        if (sharedGLCapabilities().timerQuery)
+        {
+            if (_timerQueries[0] == 0)
+            {
+                for (int iQuery = 0; iQuery < queryCount; iQuery++)
+                {
+                    _timerQueries[iQuery].create(GPUQueries, GPUOwnedByApplication);
+                }
+            }
+
+            _queryIndex = (_queryIndex + 1) % queryCount;
+            if (_queryPending[_queryIndex])
+            {
+                // Ran out of queries in flight: take the result, even if it waits
+                readTimerQuery(_queryIndex, true);
+            }
+            glBeginQuery(GL_TIME_ELAPSED, _timerQueries[_queryIndex]);
+            return;
+        }
+        _cpuFrameStart = glfwGetTime();
+    }
+
+    void endTiming()
+    {
+        if (sharedGLCapabilities().timerQuery)
+        {
+            glEndQuery(GL_TIME_ELAPSED);
+            _queryPending[_queryIndex] = true;
+            return;
+        }
+        glFinish();
+        _lastFrameTime = glfwGetTime() - _cpuFrameStart;
+    }
+
+    bool readTimerQuery(int index, bool wait)
+    {
+        GLuint available = GL_TRUE;
+        if (!wait)
+        {
+            glGetQueryObjectuiv(_timerQueries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+        }
+        if (!available)
+        {
+            return false;
+        }
+
+        GLuint64 elapsedNanoseconds = 0;
+        glGetQueryObjectui64v(_timerQueries[index], GL_QUERY_RESULT, &elapsedNanoseconds);
+        _lastFrameTime = elapsedNanoseconds * 1e-9;
+        _queryPending[index] = false;
+        return true;
+    }
+
+    void updateScale()
+    {
+        if (sharedGLCapabilities().timerQuery)
+        {
+            // Oldest first, so _lastFrameTime ends up as the newest finished frame
+            bool gotResult = false;
+            for (int iQuery = 1; iQuery <= queryCount; iQuery++)
+            {
+                int index = (_queryIndex + iQuery) % queryCount;
+                if (_queryPending[index] && readTimerQuery(index, false))
+                {
+                    gotResult = true;
+                }
+            }
+            if (!gotResult)
+            {
+                return;
+            }
+        }
+
+        // Positive error: headroom left, so render more pixels
+        float error = (float)((_targetFrameTime - _lastFrameTime) / _targetFrameTime);
+        _integral = std::max(-2.0f, std::min(_integral + error, 2.0f));
+        float derivative = error - _previousError;
+        _previousError = error;
+
+        float areaScale = _scale * _scale;
+        areaScale *= 1.0f + _proportionalGain * error + _integralGain * _integral + _derivativeGain * derivative;
+        areaScale = std::max(_minScale * _minScale, std::min(areaScale, _maxScale * _maxScale));
+        _scale = sqrtf(areaScale);
+    }
+
+    void sharpenToScreen(GLint renderWidth, GLint renderHeight)
+    {
+        if (_sharpenProgram == 0)
+        {
+            createSharpenProgram();
+        }
+
+        GLint previousProgram = 0, previousVertexArray = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+        glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVertexArray);
+        GLboolean depthTestEnabled = glIsEnabled(GL_DEPTH_TEST);
+        GLboolean cullFaceEnabled = glIsEnabled(GL_CULL_FACE);
+        GLboolean blendEnabled = glIsEnabled(GL_BLEND);
+
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_CULL_FACE);
+        glDisable(GL_BLEND);
+        glViewport(0, 0, _framebufferWidth, _framebufferHeight);
+
+        glUseProgram(_sharpenProgram);
+        glUniform2f(_sharpenSourceScaleUniform,
+                    renderWidth / (float)_framebufferWidth, renderHeight / (float)_framebufferHeight);
+        glUniform2f(_sharpenTexelSizeUniform, 1.0f / _framebufferWidth, 1.0f / _framebufferHeight);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, _colorTexture);
+        glBindVertexArray(_emptyVertexArray);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindVertexArray(previousVertexArray);
+        glUseProgram(previousProgram);
+        if (depthTestEnabled) glEnable(GL_DEPTH_TEST);
+        if (cullFaceEnabled) glEnable(GL_CULL_FACE);
+        if (blendEnabled) glEnable(GL_BLEND);
+    }
+
+    void createSharpenProgram()
+    {
+        const std::string vertexSource =
+            "#version 330\n"
+            "uniform vec2 sourceScale;\n"
+            "out vec2 texCoord;\n"
+            "void main()\n"
+            "{\n"
+            "    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+            "    texCoord = corner * sourceScale;\n"
+            "    gl_Position = vec4(corner * 2.0f - 1.0f, 0.0f, 1.0f);\n"
+            "}\n";
+
+        // Unsharp mask over the four neighbours of the bilinear sample. Only
+        // the lower-left sourceScale of the texture was rendered this frame,
+        // so samples are clamped to the texel centres inside it.
+        const std::string fragmentSource =
+            "#version 330\n"
+            "uniform sampler2D sourceTexture;\n"
+            "uniform vec2 sourceScale;\n"
+            "uniform vec2 texelSize;\n"
+            "in vec2 texCoord;\n"
+            "out vec4 outputColor;\n"
+            "vec4 source(vec2 coord)\n"
+            "{\n"
+            "    return texture(sourceTexture, clamp(coord, 0.5f * texelSize, sourceScale - 0.5f * texelSize));\n"
+            "}\n"
+            "void main()\n"
+            "{\n"
+            "    const float sharpness = 0.25f;\n"
+            "    vec4 center = source(texCoord);\n"
+            "    vec4 neighbours = source(texCoord + vec2(texelSize.x, 0.0f))\n"
+            "                    + source(texCoord - vec2(texelSize.x, 0.0f))\n"
+            "                    + source(texCoord + vec2(0.0f, texelSize.y))\n"
+            "                    + source(texCoord - vec2(0.0f, texelSize.y));\n"
+            "    outputColor = clamp(center * (1.0f + 4.0f * sharpness) - neighbours * sharpness, 0.0f, 1.0f);\n"
+            "}\n";
+
+        _sharpenProgram.reset(createShaderProgramWithSource(vertexSource, fragmentSource),
+                              GPUPrograms, GPUOwnedByApplication);
+        _sharpenSourceScaleUniform = glGetUniformLocation(_sharpenProgram, "sourceScale");
+        _sharpenTexelSizeUniform = glGetUniformLocation(_sharpenProgram, "texelSize");
+
+        GLint previousProgram = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+        glUseProgram(_sharpenProgram);
+        glUniform1i(glGetUniformLocation(_sharpenProgram, "sourceTexture"), 0);
+        glUseProgram(previousProgram);
+
+        _emptyVertexArray.create(GPUVertexArrays, GPUOwnedByApplication);
+        printOpenGLError();
+    }
+
+    bool _enabled;
+    UpscaleFilter _filter;
+
+    double _targetFrameTime;
+    float _minScale, _maxScale;
+    float _scale;
+
+    float _proportionalGain, _integralGain, _derivativeGain;
+    float _integral;
+    float _previousError;
+    double _lastFrameTime;
+
+    int _framebufferWidth, _framebufferHeight;
+    GLint _sceneViewport[4];
+    GLFramebuffer _framebuffer;
+    GLTexture _colorTexture;
+    GLRenderbuffer _depthRenderbuffer;
+
+    GLProgram _sharpenProgram;
+    GLint _sharpenSourceScaleUniform;
+    GLint _sharpenTexelSizeUniform;
+    GLVertexArray _emptyVertexArray;
+
+    GLQuery _timerQueries[queryCount];
+    bool _queryPending[queryCount];
+    int _queryIndex;
+    double _cpuFrameStart;
+};
+
+#endif
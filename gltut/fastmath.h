@@ -0,0 +1,185 @@
+//
+//  fastmath.h
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+
+#ifndef gltut_glfw_fastmath_h
+#define gltut_glfw_fastmath_h
+
+#include <math.h>
+#include <algorithm>
+
+#include "glm.hpp"
+
+// Sine and cosine for the rotation builders.
+//
+// SinCosArray() evaluates both functions for a whole array of angles in a
+// single branch-free loop the compiler can vectorize, with one range
+// reduction per angle and no calls into libm; SinCos() is the same kernel
+// for one angle. The scenes gather every angle a frame needs and make one
+// call. Angles that are an exact multiple of a quarter degree (every joint
+// angle of the 06d armature, since STANDARD_ANGLE_INCREMENT and
+// SMALL_ANGLE_INCREMENT both are) come straight out of a precomputed table
+// through SinCosDeg() and SinCosDegArray().
+
+// Evaluates sines[i] = sin(anglesRad[i]), cosines[i] = cos(anglesRad[i]).
+// Within 1e-6 of the libm result for angles of a few turns.
+inline void SinCosArray(const float *anglesRad, float *sines, float *cosines, int count)
+{
+    const float twoOverPi = 0.636619772367581f;
+    // pi/2 split in two parts so the reduction keeps its precision
+    const float halfPiHigh = 1.5707963705062866f;
+    const float halfPiLow = -4.3711388286737929e-08f;
+
+    for (int iAngle = 0; iAngle < count; iAngle++)
+    {
+        float x = anglesRad[iAngle];
+        float quadrantFloat = floorf(x * twoOverPi + 0.5f);
+        int quadrant = (int)quadrantFloat;
+
+        // r in [-pi/4, pi/4]
+        float r = (x - quadrantFloat * halfPiHigh) - quadrantFloat * halfPiLow;
+        float r2 = r * r;
+
+        float sinR = r * (1.0f + r2 * (-1.0f / 6.0f + r2 * (1.0f / 120.0f + r2 * (-1.0f / 5040.0f + r2 * (1.0f / 362880.0f)))));
+        float cosR = 1.0f + r2 * (-0.5f + r2 * (1.0f / 24.0f + r2 * (-1.0f / 720.0f + r2 * (1.0f / 40320.0f + r2 * (-1.0f / 3628800.0f)))));
+
+        float fSin = (quadrant & 1) ? cosR : sinR;
+        float fCos = (quadrant & 1) ? sinR : cosR;
+        sines[iAngle] = (quadrant & 2) ? -fSin : fSin;
+        cosines[iAngle] = ((quadrant + 1) & 2) ? -fCos : fCos;
+    }
+}
+
+inline void SinCos(float fAngRad, float &fSin, float &fCos)
+{
+    SinCosArray(&fAngRad, &fSin, &fCos, 1);
+}
+
+// sin/cos of every multiple of 1 / stepsPerDegree degrees in [0, 360).
+class QuantizedSinCosTable
+{
+  public:
+    static const int stepsPerDegree = 4;
+    static const int stepCount = 360 * stepsPerDegree;
+
+    QuantizedSinCosTable()
+    {
+        for (int iStep = 0; iStep < stepCount; iStep++)
+        {
+            double angRad = iStep * (3.14159265358979323846 * 2.0 / stepCount);
+            _sines[iStep] = (float)sin(angRad);
+            _cosines[iStep] = (float)cos(angRad);
+        }
+    }
+
+    // Returns false, leaving fSin/fCos untouched, when fAngDeg is not on the grid.
+    bool lookup(float fAngDeg, float &fSin, float &fCos) const
+    {
+        float scaled = fAngDeg * stepsPerDegree;
+        float wholeSteps = floorf(scaled);
+        if (scaled != wholeSteps || fabsf(scaled) > 16777216.0f)
+        {
+            return false;
+        }
+
+        int iStep = (int)fmodf(wholeSteps, (float)stepCount);
+        if (iStep < 0)
+        {
+            iStep += stepCount;
+        }
+
+        fSin = _sines[iStep];
+        fCos = _cosines[iStep];
+        return true;
+    }
+
+  private:
+    float _sines[stepCount];
+    float _cosines[stepCount];
+};
+
+inline const QuantizedSinCosTable &sharedSinCosTable()
+{
+    static const QuantizedSinCosTable table;
+    return table;
+}
+
+// Degrees in, table lookup when the angle is quantized, polynomial otherwise.
+inline void SinCosDeg(float fAngDeg, float &fSin, float &fCos)
+{
+    if (!sharedSinCosTable().lookup(fAngDeg, fSin, fCos))
+    {
+        const float fDegToRad = 3.14159265f * 2.0f / 360.0f;
+        SinCos(fAngDeg * fDegToRad, fSin, fCos);
+    }
+}
+
+// SinCosDeg() over an array: quantized angles come from the table, and the
+// rest are gathered and evaluated with one SinCosArray() per batch.
+inline void SinCosDegArray(const float *anglesDeg, float *sines, float *cosines, int count)
+{
+    const float fDegToRad = 3.14159265f * 2.0f / 360.0f;
+    const int batchSize = 64;
+    float missRad[batchSize];
+    float missSin[batchSize];
+    float missCos[batchSize];
+    int missIndex[batchSize];
+
+    const QuantizedSinCosTable &table = sharedSinCosTable();
+    for (int first = 0; first < count; first += batchSize)
+    {
+        int last = std::min(first + batchSize, count);
+        int missCount = 0;
+        for (int iAngle = first; iAngle < last; iAngle++)
+        {
+            if (!table.lookup(anglesDeg[iAngle], sines[iAngle], cosines[iAngle]))
+            {
+                missRad[missCount] = anglesDeg[iAngle] * fDegToRad;
+                missIndex[missCount] = iAngle;
+                missCount++;
+            }
+        }
+
+        SinCosArray(missRad, missSin, missCos, missCount);
+        for (int iMiss = 0; iMiss < missCount; iMiss++)
+        {
+            sines[missIndex[iMiss]] = missSin[iMiss];
+            cosines[missIndex[iMiss]] = missCos[iMiss];
+        }
+    }
+}
+
+// Rotation about a unit axis by the angle whose sine and cosine are given:
+// 06c's RotateAxis, and the instances and joints of the stress scenes.
+inline glm::mat3 AxisRotation(const glm::vec3 &axis, float fSin, float fCos)
+{
+    float fInvCos = 1.0f - fCos;
+
+    glm::mat3 theMat(1.0f);
+    theMat[0].x = (axis.x * axis.x) + ((1 - axis.x * axis.x) * fCos);
+    theMat[1].x = axis.x * axis.y * (fInvCos) - (axis.z * fSin);
+    theMat[2].x = axis.x * axis.z * (fInvCos) + (axis.y * fSin);
+
+    theMat[0].y = axis.x * axis.y * (fInvCos) + (axis.z * fSin);
+    theMat[1].y = (axis.y * axis.y) + ((1 - axis.y * axis.y) * fCos);
+    theMat[2].y = axis.y * axis.z * (fInvCos) - (axis.x * fSin);
+
+    theMat[0].z = axis.x * axis.z * (fInvCos) - (axis.y * fSin);
+    theMat[1].z = axis.y * axis.z * (fInvCos) + (axis.x * fSin);
+    theMat[2].z = (axis.z * axis.z) + ((1 - axis.z * axis.z) * fCos);
+    return theMat;
+}
+
+inline glm::mat3 AxisRotation(const glm::vec3 &axis, float fAngRad)
+{
+    float fCos, fSin;
+    SinCos(fAngRad, fSin, fCos);
+    return AxisRotation(axis, fSin, fCos);
+}
+
+#endif
@@ -0,0 +1,249 @@
+//
+//  framepacing.h
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+
+#ifndef gltut_glfw_framepacing_h
+#define gltut_glfw_framepacing_h
+
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <thread>
+
+// Frame pacing for the main loop, and input-to-present latency measurement.
+//
+// FramePacer sets the swap interval and, when a target rate is set, holds
+// each frame until its deadline: it sleeps for most of the wait and spins
+// the last stretch, because sleeps overshoot by up to a scheduler quantum.
+// Polling events right after the wait (late latching) means the input a
+// frame draws is as fresh as possible.
+//
+// InputLatencyTracker timestamps every input event, notes which frame drew
+// it and when that frame's commands finished on the GPU (a fence inserted
+// after the swap, polled without blocking on later frames), and reports the
+// latency of each event.
+//
+//  framePacer.waitForNextFrame();
+//  glfwPollEvents();                  // callbacks call inputLatency.recordInput()
+//  inputLatency.beginFrame();
+//  scene.draw();
+//  glfwSwapBuffers(window);
+//  inputLatency.endFrame();
+
+class FramePacer
+{
+  public:
+    FramePacer()
+    : _swapInterval(1)
+    , _targetRate(0.0)
+    , _spinMargin(0.002)
+    , _nextDeadline(0.0)
+    {
+    }
+
+    // 0 presents immediately, 1 waits for vertical blank, N every Nth blank.
+    void setSwapInterval(int swapInterval)
+    {
+        _swapInterval = swapInterval;
+        glfwSwapInterval(swapInterval);
+    }
+    int swapInterval() const { return _swapInterval; }
+
+    // Frames per second the limiter holds to; 0 disables it.
+    void setTargetRate(double framesPerSecond)
+    {
+        _targetRate = framesPerSecond;
+        _nextDeadline = 0.0;
+    }
+    double targetRate() const { return _targetRate; }
+
+    // Time before the deadline spent spinning instead of sleeping.
+    void setSpinMargin(double seconds) { _spinMargin = seconds; }
+
+    void waitForNextFrame()
+    {
+        if (_targetRate <= 0.0)
+        {
+            return;
+        }
+
+        double framePeriod = 1.0 / _targetRate;
+        double now = glfwGetTime();
+
+        // First frame, or more than a frame late: restart the schedule
+        // rather than rushing to catch up
+        if (_nextDeadline == 0.0 || now - _nextDeadline > framePeriod)
+        {
+            _nextDeadline = now + framePeriod;
+            return;
+        }
+
+        double sleepTime = _nextDeadline - now - _spinMargin;
+        if (sleepTime > 0.0)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds((long long)(sleepTime * 1e6)));
+        }
+
+        while (glfwGetTime() < _nextDeadline)
+        {
+            std::this_thread::yield();
+        }
+
+        _nextDeadline += framePeriod;
+    }
+
+  private:
+    int _swapInterval;
+    double _targetRate;
+    double _spinMargin;
+    double _nextDeadline;
+};
+
+struct InputLatencySummary
+{
+    int eventCount;
+    double averageToPresent;    // seconds
+    double maximumToPresent;
+};
+
+class InputLatencyTracker
+{
+  public:
+    InputLatencyTracker()
+    : _reportEachEvent(true)
+    {
+        resetSummary();
+    }
+
+    // Deletes the fences of frames still in flight, for before the context
+    // goes; their events are dropped unreported
+    void destroy()
+    {
+        for (size_t iFrame = 0; iFrame < _framesInFlight.size(); iFrame++)
+        {
+            glDeleteSync(_framesInFlight[iFrame].fence);
+        }
+        _framesInFlight.clear();
+    }
+
+    void setReportEachEvent(bool reportEachEvent) { _reportEachEvent = reportEachEvent; }
+
+    // Call from input callbacks. code identifies the event in the report (e.g. the key).
+    void recordInput(const char *kind, int code)
+    {
+        InputEvent event = { kind, code, glfwGetTime(), 0.0 };
+        _pendingEvents.push_back(event);
+    }
+
+    // Events recorded so far are drawn by the frame that starts now.
+    void beginFrame()
+    {
+        double now = glfwGetTime();
+        for (size_t iEvent = 0; iEvent < _pendingEvents.size(); iEvent++)
+        {
+            _pendingEvents[iEvent].drawTime = now;
+        }
+        collectPresentedFrames();
+    }
+
+    void endFrame()
+    {
+        if (_pendingEvents.empty())
+        {
+            collectPresentedFrames();
+            return;
+        }
+
+        FrameInFlight frame;
+        frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        frame.events.swap(_pendingEvents);
+        frame.swapTime = glfwGetTime();
+        _framesInFlight.push_back(frame);
+
+        // Push the fence to the GPU so it can signal without another flush
+        glFlush();
+        collectPresentedFrames();
+    }
+
+    const InputLatencySummary &summary() const { return _summary; }
+
+    void resetSummary()
+    {
+        _summary.eventCount = 0;
+        _summary.averageToPresent = 0.0;
+        _summary.maximumToPresent = 0.0;
+    }
+
+  private:
+    struct InputEvent
+    {
+        const char *kind;
+        int code;
+        double inputTime;
+        double drawTime;
+    };
+
+    struct FrameInFlight
+    {
+        GLsync fence;
+        double swapTime;
+        std::deque<InputEvent> events;
+    };
+
+    InputLatencyTracker(const InputLatencyTracker &);
+    InputLatencyTracker &operator=(const InputLatencyTracker &);
+
+    void collectPresentedFrames()
+    {
+        while (!_framesInFlight.empty())
+        {
+            FrameInFlight &frame = _framesInFlight.front();
+            GLenum status = glClientWaitSync(frame.fence, 0, 0);
+            if (status == GL_TIMEOUT_EXPIRED)
+            {
+                return;
+            }
+
+            // The fence is only seen signaled at the next poll, so this is an upper bound
+            double presentTime = std::max(glfwGetTime(), frame.swapTime);
+            for (size_t iEvent = 0; iEvent < frame.events.size(); iEvent++)
+            {
+                report(frame.events[iEvent], frame.swapTime, presentTime);
+            }
+
+            glDeleteSync(frame.fence);
+            _framesInFlight.pop_front();
+        }
+    }
+
+    void report(const InputEvent &event, double swapTime, double presentTime)
+    {
+        double toPresent = presentTime - event.inputTime;
+
+        _summary.averageToPresent = (_summary.averageToPresent * _summary.eventCount + toPresent) / (_summary.eventCount + 1);
+        _summary.maximumToPresent = std::max(_summary.maximumToPresent, toPresent);
+        _summary.eventCount++;
+
+        if (_reportEachEvent)
+        {
+            printf("Latency %s %d: to draw %.2f ms, to swap %.2f ms, to present %.2f ms\n",
+                   event.kind, event.code,
+                   (event.drawTime - event.inputTime) * 1000.0,
+                   (swapTime - event.inputTime) * 1000.0,
+                   toPresent * 1000.0);
+        }
+    }
+
+    bool _reportEachEvent;
+    std::deque<InputEvent> _pendingEvents;
+    std::deque<FrameInFlight> _framesInFlight;
+    InputLatencySummary _summary;
+};
+
+#endif
@@ -0,0 +1,213 @@
+//
+//  glcapabilities.h
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+
+#ifndef gltut_glfw_glcapabilities_h
+#define gltut_glfw_glcapabilities_h
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// What the current context can do: its version, extensions and limits,
+// and the optional features derived from them. main.cpp asks for the
+// newest context the driver will give and queries the table once, on the
+// first context it creates; every later context comes from the same
+// driver and version. Code with a fast path picks it from here:
+//
+//  if (sharedGLCapabilities().bufferStorage)
+//      glBufferStorage(GL_ARRAY_BUFFER, size, NULL, GL_MAP_WRITE_BIT);
+//  else
+//      glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STATIC_DRAW);
+//
+// A feature is only set when the GL headers this was built with declare
+// it as well, so the calls behind it stay inside the same #ifdef guards.
+
+struct GLCapabilities
+{
+    bool queried;
+
+    int majorVersion;
+    int minorVersion;
+    std::string vendor;
+    std::string renderer;
+    std::string version;
+    std::string shadingLanguageVersion;
+    std::vector<std::string> extensions;     // sorted
+
+    GLint maxTextureSize;
+    GLint maxRenderbufferSize;
+    GLint maxViewportWidth;
+    GLint maxViewportHeight;
+    GLint maxSamples;
+    GLint maxVertexAttribs;
+    GLint maxUniformBlockSize;
+    GLint uniformBufferOffsetAlignment;
+    GLint maxTextureBufferSize;
+    GLint programBinaryFormats;
+
+    bool anySamplesPassed;      // GL_ANY_SAMPLES_PASSED occlusion queries: 3.3, ARB_occlusion_query2
+    bool timerQuery;            // GL_TIME_ELAPSED queries: 3.3, ARB_timer_query
+    bool instancedArrays;       // glVertexAttribDivisor: 3.3, ARB_instanced_arrays
+    bool programBinary;         // glGetProgramBinary with a format to keep: 4.1, ARB_get_program_binary
+    bool programUniform;        // glProgramUniform: 4.1, ARB_separate_shader_objects
+    bool multiDrawIndirect;     // glMultiDrawElementsIndirect with base instances: 4.3, ARB_multi_draw_indirect
+    bool debugOutput;           // glDebugMessageCallback: 4.3, KHR_debug
+    bool bufferStorage;         // immutable glBufferStorage: 4.4, ARB_buffer_storage
+
+    GLCapabilities()
+    : queried(false)
+    , majorVersion(0)
+    , minorVersion(0)
+    , maxTextureSize(0)
+    , maxRenderbufferSize(0)
+    , maxViewportWidth(0)
+    , maxViewportHeight(0)
+    , maxSamples(0)
+    , maxVertexAttribs(0)
+    , maxUniformBlockSize(0)
+    , uniformBufferOffsetAlignment(256)
+    , maxTextureBufferSize(0)
+    , programBinaryFormats(0)
+    , anySamplesPassed(false)
+    , timerQuery(false)
+    , instancedArrays(false)
+    , programBinary(false)
+    , programUniform(false)
+    , multiDrawIndirect(false)
+    , debugOutput(false)
+    , bufferStorage(false)
+    {
+    }
+
+    bool atLeast(int major, int minor) const
+    {
+        return majorVersion > major || (majorVersion == major && minorVersion >= minor);
+    }
+
+    bool hasExtension(const char *name) const
+    {
+        return std::binary_search(extensions.begin(), extensions.end(), std::string(name));
+    }
+
+    // Fills the table from the current context
+    void query()
+    {
+        glGetIntegerv(GL_MAJOR_VERSION, &majorVersion);
+        glGetIntegerv(GL_MINOR_VERSION, &minorVersion);
+        vendor = queryString(GL_VENDOR);
+        renderer = queryString(GL_RENDERER);
+        version = queryString(GL_VERSION);
+        shadingLanguageVersion = queryString(GL_SHADING_LANGUAGE_VERSION);
+
+        GLint extensionCount = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+        extensions.clear();
+        for (GLint iExtension = 0; iExtension < extensionCount; iExtension++)
+        {
+            const GLubyte *name = glGetStringi(GL_EXTENSIONS, iExtension);
+            if (name != NULL)
+            {
+                extensions.push_back((const char *)name);
+            }
+        }
+        std::sort(extensions.begin(), extensions.end());
+
+        GLint viewportDimensions[2] = { 0, 0 };
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+        glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxRenderbufferSize);
+        glGetIntegerv(GL_MAX_VIEWPORT_DIMS, viewportDimensions);
+        maxViewportWidth = viewportDimensions[0];
+        maxViewportHeight = viewportDimensions[1];
+        glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+        glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &maxVertexAttribs);
+        glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &maxUniformBlockSize);
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformBufferOffsetAlignment);
+        glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTextureBufferSize);
+
+#ifdef GL_ANY_SAMPLES_PASSED
+        anySamplesPassed = atLeast(3, 3) || hasExtension("GL_ARB_occlusion_query2");
+#endif
+#ifdef GL_TIME_ELAPSED
+        timerQuery = atLeast(3, 3) || hasExtension("GL_ARB_timer_query");
+#endif
+        instancedArrays = atLeast(3, 3) || hasExtension("GL_ARB_instanced_arrays");
+#ifdef GL_NUM_PROGRAM_BINARY_FORMATS
+        if (atLeast(4, 1) || hasExtension("GL_ARB_get_program_binary"))
+        {
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &programBinaryFormats);
+        }
+        // Drivers may support the calls and offer no format to save
+        programBinary = programBinaryFormats > 0;
+#endif
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_separate_shader_objects)
+        programUniform = atLeast(4, 1) || hasExtension("GL_ARB_separate_shader_objects");
+#endif
+        // Not GL_DRAW_INDIRECT_BUFFER: that token is 4.0, and 4.1 headers
+        // define it without declaring glMultiDrawElementsIndirect
+#if defined(GL_VERSION_4_3) || defined(GL_ARB_multi_draw_indirect)
+        multiDrawIndirect = atLeast(4, 3) || (hasExtension("GL_ARB_multi_draw_indirect")
+                                              && hasExtension("GL_ARB_base_instance"));
+#endif
+#ifdef GL_DEBUG_OUTPUT
+        debugOutput = atLeast(4, 3) || hasExtension("GL_KHR_debug");
+#endif
+#ifdef GL_MAP_PERSISTENT_BIT
+        bufferStorage = atLeast(4, 4) || hasExtension("GL_ARB_buffer_storage");
+#endif
+
+        // Drain any error left by a query the context rejected
+        while (glGetError() != GL_NO_ERROR)
+        {
+        }
+        queried = true;
+    }
+
+    void print(FILE *stream = stdout) const
+    {
+        fprintf(stream, "GL %d.%d: %s\n", majorVersion, minorVersion, version.c_str());
+        fprintf(stream, "Renderer: %s (%s)\n", renderer.c_str(), vendor.c_str());
+        fprintf(stream, "GLSL: %s\n", shadingLanguageVersion.c_str());
+        fprintf(stream, "Limits: texture %d, renderbuffer %d, viewport %dx%d, %d samples, %d vertex attributes,\n"
+                        "        uniform block %d bytes at %d byte offsets, texture buffer %d texels\n",
+                maxTextureSize, maxRenderbufferSize, maxViewportWidth, maxViewportHeight, maxSamples, maxVertexAttribs,
+                maxUniformBlockSize, uniformBufferOffsetAlignment, maxTextureBufferSize);
+        fprintf(stream, "Features:\n");
+        printFeature(stream, "any samples passed", anySamplesPassed);
+        printFeature(stream, "timer queries", timerQuery);
+        printFeature(stream, "instanced arrays", instancedArrays);
+        printFeature(stream, "program binaries", programBinary);
+        printFeature(stream, "program uniforms", programUniform);
+        printFeature(stream, "multi-draw indirect", multiDrawIndirect);
+        printFeature(stream, "debug output", debugOutput);
+        printFeature(stream, "buffer storage", bufferStorage);
+        fprintf(stream, "%d extensions\n", (int)extensions.size());
+    }
+
+  private:
+    static std::string queryString(GLenum name)
+    {
+        const GLubyte *value = glGetString(name);
+        return value != NULL ? (const char *)value : "";
+    }
+
+    static void printFeature(FILE *stream, const char *name, bool available)
+    {
+        fprintf(stream, "  %-20s %s\n", name, available ? "yes" : "no");
+    }
+};
+
+inline GLCapabilities &sharedGLCapabilities()
+{
+    static GLCapabilities capabilities;
+    return capabilities;
+}
+
+#endif
@@ -14,8 +14,14 @@
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <map>
+#include <mutex>
 #include <stdexcept>
 
+#include "assetarchive.h"
+#include "glcapabilities.h"
+#include "programreflection.h"
+
 //std::string FindFileOrThrow( const std::string &strBasename )
 //{
 //    std::string strFilename = strBasename;
@@ -33,11 +39,11 @@
 
 #define ARRAY_COUNT( array ) (sizeof( array ) / (sizeof( array[0] ) * (sizeof( array ) != sizeof(void*) || sizeof( array[0] ) <= sizeof(void*))))
 
-GLuint createAndCompilerShaderWithSource(GLenum shaderType, const std::string &shaderSource)
+// shaderSource needs no terminating null; archive entries are passed in place
+inline GLuint createAndCompilerShaderWithSource(GLenum shaderType, const char *shaderSource, GLint shaderSourceLength)
 {
     GLuint shader = glCreateShader(shaderType);
-    const char *strFileData = shaderSource.c_str();
-    glShaderSource(shader, 1, &strFileData, NULL);
+    glShaderSource(shader, 1, &shaderSource, &shaderSourceLength);
     
     glCompileShader(shader);
     
@@ -65,7 +71,12 @@ GLuint createAndCompilerShaderWithSource(GLenum shaderType, const std::string &s
 	return shader;
 }
 
-std::string FindFileOrThrow( const std::string &filename )
+inline GLuint createAndCompilerShaderWithSource(GLenum shaderType, const std::string &shaderSource)
+{
+    return createAndCompilerShaderWithSource(shaderType, shaderSource.c_str(), (GLint)shaderSource.size());
+}
+
+inline std::string FindFileOrThrow( const std::string &filename )
 {
     std::ifstream testFile(filename.c_str());
     if(testFile.is_open())
@@ -74,17 +85,31 @@ std::string FindFileOrThrow( const std::string &filename )
     throw std::runtime_error("Could not find the file: " + filename);
 }
 
-GLuint createAndCompilerShaderWithFilename(GLenum shaderType, const std::string &shaderFilename)
+// Contents of a named asset, resolved by FindAsset()
+inline std::string ReadAssetOrThrow(const std::string &filename)
+{
+    AssetView asset;
+    std::string storage;
+    if (!FindAsset(filename, asset, storage))
+    {
+        throw std::runtime_error("Could not find the file: " + filename);
+    }
+    return storage.data() == asset.data ? storage : std::string(asset.data, asset.size);
+}
+
+// Resolved by FindAsset(): archive entries are compiled in place
+inline GLuint createAndCompilerShaderWithFilename(GLenum shaderType, const std::string &shaderFilename)
 {
-    std::string strFilename = FindFileOrThrow(shaderFilename);
-    std::ifstream shaderFile(shaderFilename.c_str());
-    std::stringstream shaderData;
-    shaderData << shaderFile.rdbuf();
-    shaderFile.close();
+    AssetView asset;
+    std::string storage;
+    if (!FindAsset(shaderFilename, asset, storage))
+    {
+        throw std::runtime_error("Could not find the file: " + shaderFilename);
+    }
     
     try
     {
-        return createAndCompilerShaderWithSource(shaderType, shaderData.str());
+        return createAndCompilerShaderWithSource(shaderType, asset.data, (GLint)asset.size);
     }
     catch(std::exception &e)
     {
@@ -93,7 +118,11 @@ GLuint createAndCompilerShaderWithFilename(GLenum shaderType, const std::string
     }
 }
 
-GLuint createProgramWithShaderList(const std::vector<GLuint> &shaderList)
+// feedbackVaryings are captured by transform feedback, in order, into one
+// buffer per varying (GL_SEPARATE_ATTRIBS) or all into one (GL_INTERLEAVED_ATTRIBS).
+inline GLuint createProgramWithShaderList(const std::vector<GLuint> &shaderList,
+                                   const std::vector<std::string> &feedbackVaryings,
+                                   GLenum feedbackBufferMode = GL_INTERLEAVED_ATTRIBS)
 {
 	GLuint program = glCreateProgram();
     
@@ -102,6 +131,25 @@ GLuint createProgramWithShaderList(const std::vector<GLuint> &shaderList)
 		glAttachShader(program, shaderList[iLoop]);
     }
     
+    // Has to be set before linking
+    if (!feedbackVaryings.empty())
+    {
+        std::vector<const GLchar *> varyingNames;
+        for(size_t iLoop = 0; iLoop < feedbackVaryings.size(); iLoop++)
+        {
+            varyingNames.push_back(feedbackVaryings[iLoop].c_str());
+        }
+        glTransformFeedbackVaryings(program, (GLsizei)varyingNames.size(), &varyingNames[0], feedbackBufferMode);
+    }
+    
+#ifdef GL_NUM_PROGRAM_BINARY_FORMATS
+    // Lets ProgramBinaryCache read the linked binary back
+    if (sharedGLCapabilities().programBinary)
+    {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+#endif
+    
 	glLinkProgram(program);
     
 	GLint status;
@@ -117,15 +165,116 @@ GLuint createProgramWithShaderList(const std::vector<GLuint> &shaderList)
 		delete[] strInfoLog;
 	}
     
+    // Also after a failure, so nothing is left of a deleted program with this name
+    sharedProgramReflections().reflect(program);
+    
 	for(size_t iLoop = 0; iLoop < shaderList.size(); iLoop++)
 		glDetachShader(program, shaderList[iLoop]);
     
 	return program;
 }
 
-GLuint createShaderProgramWithFilenames(const std::string &vertexShaderFilename,
+inline GLuint createProgramWithShaderList(const std::vector<GLuint> &shaderList)
+{
+    return createProgramWithShaderList(shaderList, std::vector<std::string>());
+}
+
+// Linked programs kept as driver binaries, where the context can hand them
+// out. A scene created again (a worker's next job, another offline context,
+// switching back to it) loads its programs from here instead of compiling
+// and linking them. Keyed by the shader sources, since chapters reuse file
+// names with different contents; shared by every context, which all come
+// from the same driver.
+class ProgramBinaryCache
+{
+  public:
+    // A linked program, or 0 if there is no binary or the driver rejects it
+    GLuint load(const std::string &key)
+    {
+#ifdef GL_NUM_PROGRAM_BINARY_FORMATS
+        Binary binary;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            std::map<std::string, Binary>::const_iterator found = _binaries.find(key);
+            if (found == _binaries.end())
+            {
+                return 0;
+            }
+            binary = found->second;
+        }
+        
+        GLuint program = glCreateProgram();
+        glProgramBinary(program, binary.format, &binary.data[0], (GLsizei)binary.data.size());
+        GLint status = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if (status == GL_FALSE)
+        {
+            // Driver updated or configuration changed: link from source again
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
+#else
+        return 0;
+#endif
+    }
+    
+    // Keeps the binary of a successfully linked program
+    void store(const std::string &key, GLuint program)
+    {
+#ifdef GL_NUM_PROGRAM_BINARY_FORMATS
+        GLint status = GL_FALSE;
+        GLint length = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (status == GL_FALSE || length <= 0)
+        {
+            return;
+        }
+        
+        Binary binary;
+        binary.format = 0;
+        binary.data.resize(length);
+        glGetProgramBinary(program, length, &length, &binary.format, &binary.data[0]);
+        binary.data.resize(std::max(length, 0));
+        if (!binary.data.empty())
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _binaries[key] = binary;
+        }
+#endif
+    }
+    
+  private:
+    struct Binary
+    {
+        GLenum format;
+        std::vector<char> data;
+    };
+    
+    std::mutex _mutex;
+    std::map<std::string, Binary> _binaries;
+};
+
+inline ProgramBinaryCache &sharedProgramBinaryCache()
+{
+    static ProgramBinaryCache cache;
+    return cache;
+}
+
+inline GLuint createShaderProgramWithSource(const std::string &vertexShaderSource,
+                                     const std::string &fragmentShaderSource);
+
+inline GLuint createShaderProgramWithFilenames(const std::string &vertexShaderFilename,
                                         const std::string &fragmentShaderFilename)
 {
+    // The sources are the cache key
+    if (sharedGLCapabilities().programBinary)
+    {
+        return createShaderProgramWithSource(ReadAssetOrThrow(vertexShaderFilename),
+                                             ReadAssetOrThrow(fragmentShaderFilename));
+    }
+    
     // Compiler shaders and create program
     std::vector<GLuint> shaderList;
     GLuint vertexShader = createAndCompilerShaderWithFilename(GL_VERTEX_SHADER, vertexShaderFilename);
@@ -145,9 +294,21 @@ GLuint createShaderProgramWithFilenames(const std::string &vertexShaderFilename,
 }
 
 
-GLuint createShaderProgramWithSource(const std::string &vertexShaderSource,
+inline GLuint createShaderProgramWithSource(const std::string &vertexShaderSource,
                                      const std::string &fragmentShaderSource)
 {
+    std::string cacheKey;
+    if (sharedGLCapabilities().programBinary)
+    {
+        cacheKey = vertexShaderSource + '\0' + fragmentShaderSource;
+        GLuint cachedProgram = sharedProgramBinaryCache().load(cacheKey);
+        if (cachedProgram != 0)
+        {
+            sharedProgramReflections().reflect(cachedProgram);
+            return cachedProgram;
+        }
+    }
+    
     // Compiler shaders and create program
     std::vector<GLuint> shaderList;
     GLuint vertexShader = createAndCompilerShaderWithSource(GL_VERTEX_SHADER, vertexShaderSource);
@@ -160,6 +321,10 @@ GLuint createShaderProgramWithSource(const std::string &vertexShaderSource,
     
 	GLuint shaderProgram = createProgramWithShaderList(shaderList);
 	std::for_each(shaderList.begin(), shaderList.end(), glDeleteShader);
+    if (!cacheKey.empty())
+    {
+        sharedProgramBinaryCache().store(cacheKey, shaderProgram);
+    }
     printOpenGLError();
     
     return shaderProgram;
@@ -167,4 +332,20 @@ GLuint createShaderProgramWithSource(const std::string &vertexShaderSource,
 }
 
 
+inline GLuint createFeedbackProgramWithFilename(const std::string &vertexShaderFilename,
+                                        const std::vector<std::string> &feedbackVaryings,
+                                        GLenum feedbackBufferMode = GL_INTERLEAVED_ATTRIBS)
+{
+    // Vertex stage only: the results go to the feedback buffers, not the rasterizer
+    std::vector<GLuint> shaderList;
+    shaderList.push_back( createAndCompilerShaderWithFilename(GL_VERTEX_SHADER, vertexShaderFilename) );
+    
+	GLuint shaderProgram = createProgramWithShaderList(shaderList, feedbackVaryings, feedbackBufferMode);
+	std::for_each(shaderList.begin(), shaderList.end(), glDeleteShader);
+    printOpenGLError();
+    
+    return shaderProgram;
+}
+
+
 #endif
@@ -8,6 +8,7 @@
 // This file is licensed under the MIT License.
 //
 
+#define GLTUT_CHAPTER gltut02a
 #include "Scene.h"
 
 #include <string>
@@ -16,6 +17,8 @@
 #include "debug.h"
 #include "glhelpers.h"
 
+namespace GLTUT_CHAPTER {
+
 const float vertexPositions[] =
 {
 	0.75f, 0.75f, 0.0f, 1.0f,
@@ -29,29 +32,25 @@ Scene::Scene()
 
 void Scene::init()
 {
-    _shaderProgram = createShaderProgramWithFilenames("FragPosition.vert", "FragPosition.frag");
+    _shaderProgram.reset(createShaderProgramWithFilenames("FragPosition.vert", "FragPosition.frag"));
     glUseProgram(_shaderProgram);
     printOpenGLError();
     
     // Initialize Vertex Buffer
-    glGenBuffers(1, &_vertexBufferObject);
+    _vertexBufferObject.create();
     
-	glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertexPositions), vertexPositions, GL_STATIC_DRAW);
+	_vertexBufferObject.bufferData(GL_ARRAY_BUFFER, sizeof(vertexPositions), vertexPositions, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
     printOpenGLError();
     
     // Vertex array object
-    glGenVertexArrays(1, &_vertexArrayObject);
+    _vertexArrayObject.create();
 	glBindVertexArray(_vertexArrayObject);
     printOpenGLError();
 }
 
 Scene::~Scene()
 {
-    glDeleteProgram(_shaderProgram);
-    glDeleteBuffers(1, &_vertexBufferObject);
-    printOpenGLError();
 }
 
 const float aspectRatio = 1.0f;
@@ -76,8 +75,6 @@ void Scene::reshape(int width, int height)
                (height-finalHeight) / 2,
                finalWidth,
                finalHeight);
-    
-    this->draw();
 }
 
 void Scene::draw()
@@ -96,6 +93,15 @@ void Scene::draw()
     printOpenGLError();
 }
 
+bool Scene::isAnimated()
+{
+    return false;
+}
+
 void Scene::keyStateChanged(int key, int action)
 {
-}
\ No newline at end of file
+}
+
+REGISTER_SCENE("gltut 02a");
+
+}
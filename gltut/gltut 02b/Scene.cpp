@@ -8,6 +8,7 @@
 // This file is licensed under the MIT License.
 //
 
+#define GLTUT_CHAPTER gltut02b
 #include "Scene.h"
 
 #include <string>
@@ -16,6 +17,8 @@
 #include "debug.h"
 #include "glhelpers.h"
 
+namespace GLTUT_CHAPTER {
+
 const float vertexData[] = {
     0.0f,    0.5f, 0.0f, 1.0f,
     0.5f, -0.366f, 0.0f, 1.0f,
@@ -31,20 +34,19 @@ Scene::Scene()
 
 void Scene::init()
 {
-    _shaderProgram = createShaderProgramWithFilenames("VertexColors.vert", "VertexColors.frag");
+    _shaderProgram.reset(createShaderProgramWithFilenames("VertexColors.vert", "VertexColors.frag"));
     glUseProgram(_shaderProgram);
     printOpenGLError();
     
     // Initialize Vertex Buffer
-    glGenBuffers(1, &_vertexBufferObject);
+    _vertexBufferObject.create();
     
-	glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
+	_vertexBufferObject.bufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
     printOpenGLError();
     
     // Vertex array object
-    glGenVertexArrays(1, &_vertexArrayObject);
+    _vertexArrayObject.create();
 	glBindVertexArray(_vertexArrayObject);
     printOpenGLError();
 }
@@ -71,15 +73,10 @@ void Scene::reshape(int width, int height)
                (height-finalHeight) / 2,
                finalWidth,
                finalHeight);
-    
-    this->draw();
 }
 
 Scene::~Scene()
 {
-    glDeleteProgram(_shaderProgram);
-    glDeleteBuffers(1, &_vertexBufferObject);
-    printOpenGLError();
 }
 
 void Scene::draw()
@@ -100,6 +97,15 @@ void Scene::draw()
     printOpenGLError();
 }
 
+bool Scene::isAnimated()
+{
+    return false;
+}
+
 void Scene::keyStateChanged(int key, int action)
 {
-}
\ No newline at end of file
+}
+
+REGISTER_SCENE("gltut 02b");
+
+}
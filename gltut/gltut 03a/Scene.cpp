@@ -8,6 +8,7 @@
 // This file is licensed under the MIT License.
 //
 
+#define GLTUT_CHAPTER gltut03a
 #include "Scene.h"
 
 #include <string>
@@ -19,6 +20,8 @@
 
 #include <math.h>
 
+namespace GLTUT_CHAPTER {
+
 const float vertexPositions[] = {
 	0.25f, 0.25f, 0.0f, 1.0f,
 	0.25f, -0.25f, 0.0f, 1.0f,
@@ -31,29 +34,25 @@ Scene::Scene()
 
 void Scene::init()
 {
-    _shaderProgram = createShaderProgramWithFilenames("standard.vert", "standard.frag");
+    _shaderProgram.reset(createShaderProgramWithFilenames("standard.vert", "standard.frag"));
     glUseProgram(_shaderProgram);
     printOpenGLError();
     
     // Initialize Vertex Buffer
-    glGenBuffers(1, &_vertexBufferObject);
+    _vertexBufferObject.create();
     
-	glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertexPositions), vertexPositions, GL_STREAM_DRAW);
+	_vertexBufferObject.bufferData(GL_ARRAY_BUFFER, sizeof(vertexPositions), vertexPositions, GL_STREAM_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
     printOpenGLError();
     
     // Vertex array object
-    glGenVertexArrays(1, &_vertexArrayObject);
+    _vertexArrayObject.create();
 	glBindVertexArray(_vertexArrayObject);
     printOpenGLError();
 }
 
 Scene::~Scene()
 {
-    glDeleteProgram(_shaderProgram);
-    glDeleteBuffers(1, &_vertexBufferObject);
-    printOpenGLError();
 }
 
 const float aspectRatio = 1.0f;
@@ -78,8 +77,6 @@ void Scene::reshape(int width, int height)
                (height-finalHeight) / 2,
                finalWidth,
                finalHeight);
-    
-    this->draw();
 }
 
 void Scene::computePositionOffsets(float &fXOffset, float &fYOffset)
@@ -87,7 +84,7 @@ void Scene::computePositionOffsets(float &fXOffset, float &fYOffset)
 	const float fLoopDuration = 5.0f;
 	const float fScale = 3.14159f * 2.0f / fLoopDuration;
     
-	float fElapsedTime = glfwGetTime();
+	float fElapsedTime = elapsedTime();
     
 	float fCurrTimeThroughLoop = fmodf(fElapsedTime, fLoopDuration);
     
@@ -132,6 +129,15 @@ void Scene::draw()
     printOpenGLError();
 }
 
+bool Scene::isAnimated()
+{
+    return true;
+}
+
 void Scene::keyStateChanged(int key, int action)
 {
-}
\ No newline at end of file
+}
+
+REGISTER_SCENE("gltut 03a");
+
+}
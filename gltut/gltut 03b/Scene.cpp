@@ -8,6 +8,7 @@
 // This file is licensed under the MIT License.
 //
 
+#define GLTUT_CHAPTER gltut03b
 #include "Scene.h"
 
 #include <string>
@@ -19,6 +20,8 @@
 
 #include <math.h>
 
+namespace GLTUT_CHAPTER {
+
 const float vertexPositions[] = {
 	0.25f, 0.25f, 0.0f, 1.0f,
 	0.25f, -0.25f, 0.0f, 1.0f,
@@ -33,20 +36,19 @@ Scene::Scene()
 
 void Scene::init()
 {
-    _shaderProgram = createShaderProgramWithFilenames("positionOffset.vert", "standard.frag");
+    _shaderProgram.reset(createShaderProgramWithFilenames("positionOffset.vert", "standard.frag"));
     glUseProgram(_shaderProgram);
     printOpenGLError();
     
     // Initialize Vertex Buffer
-    glGenBuffers(1, &_vertexBufferObject);
+    _vertexBufferObject.create();
     
-	glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertexPositions), vertexPositions, GL_STATIC_DRAW);
+	_vertexBufferObject.bufferData(GL_ARRAY_BUFFER, sizeof(vertexPositions), vertexPositions, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
     printOpenGLError();
     
     // Vertex array object
-    glGenVertexArrays(1, &_vertexArrayObject);
+    _vertexArrayObject.create();
 	glBindVertexArray(_vertexArrayObject);
     printOpenGLError();
 
@@ -56,9 +58,6 @@ void Scene::init()
 
 Scene::~Scene()
 {
-    glDeleteProgram(_shaderProgram);
-    glDeleteBuffers(1, &_vertexBufferObject);
-    printOpenGLError();
 }
 
 const float aspectRatio = 1.0f;
@@ -83,8 +82,6 @@ void Scene::reshape(int width, int height)
                (height-finalHeight) / 2,
                finalWidth,
                finalHeight);
-    
-    this->draw();
 }
 
 void Scene::computePositionOffsets(float &fXOffset, float &fYOffset)
@@ -92,7 +89,7 @@ void Scene::computePositionOffsets(float &fXOffset, float &fYOffset)
 	const float fLoopDuration = 5.0f;
 	const float fScale = 3.14159f * 2.0f / fLoopDuration;
     
-	float fElapsedTime = glfwGetTime();
+	float fElapsedTime = elapsedTime();
     
 	float fCurrTimeThroughLoop = fmodf(fElapsedTime, fLoopDuration);
     
@@ -121,6 +118,15 @@ void Scene::draw()
     printOpenGLError();
 }
 
+bool Scene::isAnimated()
+{
+    return true;
+}
+
 void Scene::keyStateChanged(int key, int action)
 {
-}
\ No newline at end of file
+}
+
+REGISTER_SCENE("gltut 03b");
+
+}
@@ -8,6 +8,7 @@
 // This file is licensed under the MIT License.
 //
 
+#define GLTUT_CHAPTER gltut03c
 #include "Scene.h"
 
 #include <string>
@@ -15,17 +16,25 @@
 
 #include "debug.h"
 #include "glhelpers.h"
+#include "programreflection.h"
+#include "shaderbenchmark.h"
 #include "GLFW/glfw3.h"
 
 #include <math.h>
 
+namespace GLTUT_CHAPTER {
+
 const float vertexPositions[] = {
 	0.25f, 0.25f, 0.0f, 1.0f,
 	0.25f, -0.25f, 0.0f, 1.0f,
 	-0.25f, -0.25f, 0.0f, 1.0f,
 };
 
-GLuint elapsedTimeUniform;
+struct Scene::ChapterState
+{
+    // Unchanged while the clock is pinned, for offline and poster frames
+    Uniform<float> elapsedTimeUniform;
+};
 
 Scene::Scene()
 {
@@ -33,36 +42,33 @@ Scene::Scene()
 
 void Scene::init()
 {
-    _shaderProgram = createShaderProgramWithFilenames("calcOffset.vert", "standard.frag");
+    _shaderProgram.reset(createShaderProgramWithFilenames("calcOffset.vert", "standard.frag"));
     glUseProgram(_shaderProgram);
     printOpenGLError();
     
     // Initialize Vertex Buffer
-    glGenBuffers(1, &_vertexBufferObject);
+    _vertexBufferObject.create();
     
-	glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertexPositions), vertexPositions, GL_STATIC_DRAW);
+	_vertexBufferObject.bufferData(GL_ARRAY_BUFFER, sizeof(vertexPositions), vertexPositions, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
     printOpenGLError();
     
     // Vertex array object
-    glGenVertexArrays(1, &_vertexArrayObject);
+    _vertexArrayObject.create();
 	glBindVertexArray(_vertexArrayObject);
     printOpenGLError();
 
     // Uniforms
-    elapsedTimeUniform = glGetUniformLocation(_shaderProgram, "time");
+    _state = new ChapterState();
+    _state->elapsedTimeUniform = Uniform<float>(_shaderProgram, "time");
     
-	GLuint loopDurationUniform = glGetUniformLocation(_shaderProgram, "loopDuration");
-	glUniform1f(loopDurationUniform, 5.0f);
+	Uniform<float>(_shaderProgram, "loopDuration").set(5.0f);
     printOpenGLError();
 }
 
 Scene::~Scene()
 {
-    glDeleteProgram(_shaderProgram);
-    glDeleteBuffers(1, &_vertexBufferObject);
-    printOpenGLError();
+    delete _state;
 }
 
 const float aspectRatio = 1.0f;
@@ -87,8 +93,6 @@ void Scene::reshape(int width, int height)
                (height-finalHeight) / 2,
                finalWidth,
                finalHeight);
-
-    this->draw();
 }
 
 void Scene::draw()
@@ -96,7 +100,7 @@ void Scene::draw()
     glClearColor(0.2f, 0.0f, 0.0f, 0.0f);
     glClear(GL_COLOR_BUFFER_BIT);
     
-	glUniform1f(elapsedTimeUniform, (float)glfwGetTime());
+	_state->elapsedTimeUniform.set((float)elapsedTime());
     printOpenGLError();
 
 	glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferObject);
@@ -110,6 +114,20 @@ void Scene::draw()
     printOpenGLError();
 }
 
+bool Scene::isAnimated()
+{
+    return true;
+}
+
 void Scene::keyStateChanged(int key, int action)
 {
-}
\ No newline at end of file
+}
+
+REGISTER_SHADER_BENCHMARK("gltut 03c", "calcOffset.vert", "standard.frag", [](GLuint program) {
+	glUniform1f(glGetUniformLocation(program, "loopDuration"), 5.0f);
+	glUniform1f(glGetUniformLocation(program, "time"), 1.0f);
+});
+
+REGISTER_SCENE("gltut 03c");
+
+}
@@ -8,6 +8,7 @@
 // This file is licensed under the MIT License.
 //
 
+#define GLTUT_CHAPTER gltut03d
 #include "Scene.h"
 
 #include <string>
@@ -15,10 +16,13 @@
 
 #include "debug.h"
 #include "glhelpers.h"
+#include "shaderbenchmark.h"
 #include "GLFW/glfw3.h"
 
 #include <math.h>
 
+namespace GLTUT_CHAPTER {
+
 const float vertexPositions[] = {
 	0.25f, 0.25f, 0.0f, 1.0f,
 	0.25f, -0.25f, 0.0f, 1.0f,
@@ -33,20 +37,19 @@ Scene::Scene()
 
 void Scene::init()
 {
-    _shaderProgram = createShaderProgramWithFilenames("calcOffset.vert", "calcColor.frag");
+    _shaderProgram.reset(createShaderProgramWithFilenames("calcOffset.vert", "calcColor.frag"));
     glUseProgram(_shaderProgram);
     printOpenGLError();
     
     // Initialize Vertex Buffer
-    glGenBuffers(1, &_vertexBufferObject);
+    _vertexBufferObject.create();
     
-	glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertexPositions), vertexPositions, GL_STATIC_DRAW);
+	_vertexBufferObject.bufferData(GL_ARRAY_BUFFER, sizeof(vertexPositions), vertexPositions, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
     printOpenGLError();
     
     // Vertex array object
-    glGenVertexArrays(1, &_vertexArrayObject);
+    _vertexArrayObject.create();
 	glBindVertexArray(_vertexArrayObject);
     printOpenGLError();
 
@@ -65,9 +68,6 @@ void Scene::init()
 
 Scene::~Scene()
 {
-    glDeleteProgram(_shaderProgram);
-    glDeleteBuffers(1, &_vertexBufferObject);
-    printOpenGLError();
 }
 
 const float aspectRatio = 1.0f;
@@ -92,8 +92,6 @@ void Scene::reshape(int width, int height)
                (height-finalHeight) / 2,
                finalWidth,
                finalHeight);
-
-    this->draw();
 }
 
 void Scene::draw()
@@ -105,13 +103,13 @@ void Scene::draw()
     glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
     
-    glUniform1f(elapsedTimeUniform, (float)glfwGetTime());
+    glUniform1f(elapsedTimeUniform, (float)elapsedTime());
     printOpenGLError();
 
 	glDrawArrays(GL_TRIANGLES, 0, 3);
     printOpenGLError();
 
-//    glUniform1f(elapsedTimeUniform, (float)glfwGetTime() + 2.5f);
+//    glUniform1f(elapsedTimeUniform, (float)elapsedTime() + 2.5f);
 //    printOpenGLError();
 //    
 //	glDrawArrays(GL_TRIANGLES, 0, 3);
@@ -121,6 +119,21 @@ void Scene::draw()
     printOpenGLError();
 }
 
+bool Scene::isAnimated()
+{
+    return true;
+}
+
 void Scene::keyStateChanged(int key, int action)
 {
-}
\ No newline at end of file
+}
+
+REGISTER_SHADER_BENCHMARK("gltut 03d", "calcOffset.vert", "calcColor.frag", [](GLuint program) {
+	glUniform1f(glGetUniformLocation(program, "loopDuration"), 5.0f);
+	glUniform1f(glGetUniformLocation(program, "fragLoopDuration"), 2.0f);
+	glUniform1f(glGetUniformLocation(program, "time"), 1.0f);
+});
+
+REGISTER_SCENE("gltut 03d");
+
+}
@@ -0,0 +1,165 @@
+//
+//  Scene.cpp
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+
+#define GLTUT_CHAPTER gltut03e
+#include "Scene.h"
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "debug.h"
+#include "glhelpers.h"
+#include "transformfeedback.h"
+#include "GLFW/glfw3.h"
+
+#include <math.h>
+
+namespace GLTUT_CHAPTER {
+
+// Chapter 3 moves vertices either on the CPU (03a) or in the vertex shader
+// (03c, 03d), but neither keeps any state between frames. Here the vertex
+// shader integrates position and velocity and writes them back through
+// transform feedback, so the particles never touch the CPU after init().
+
+const int particleCount = 1 << 20;
+const float particleLifetime = 2.5f;
+
+struct Particle
+{
+    float position[4];  // w: age
+    float velocity[4];
+};
+
+// draw() advances lastFrameTime, so it lives with the instance rather than
+// in a global that offline workers would share
+struct Scene::ChapterState
+{
+    TransformFeedbackBuffers particles;
+    GLProgram updateProgram;
+    GLint updateDeltaTimeUniform = -1;
+    GLint updateTimeUniform = -1;
+    float lastFrameTime = 0.0f;
+};
+
+Scene::Scene()
+{
+}
+
+void Scene::init()
+{
+    std::vector<std::string> feedbackVaryings;
+    feedbackVaryings.push_back("outPosition");
+    feedbackVaryings.push_back("outVelocity");
+    _state = new ChapterState();
+    GLProgram &updateProgram = _state->updateProgram;
+    updateProgram.reset(createFeedbackProgramWithFilename("particleUpdate.vert", feedbackVaryings));
+
+    glUseProgram(updateProgram);
+    _state->updateDeltaTimeUniform = glGetUniformLocation(updateProgram, "deltaTime");
+    _state->updateTimeUniform = glGetUniformLocation(updateProgram, "time");
+    glUniform1f(glGetUniformLocation(updateProgram, "lifetime"), particleLifetime);
+    printOpenGLError();
+
+    _shaderProgram.reset(createShaderProgramWithFilenames("particleRender.vert", "particle.frag"));
+    glUseProgram(_shaderProgram);
+    glUniform1f(glGetUniformLocation(_shaderProgram, "lifetime"), particleLifetime);
+    printOpenGLError();
+
+    // Start below the screen with staggered ages, so they respawn gradually
+    std::vector<Particle> initialParticles(particleCount);
+    for(int iParticle = 0; iParticle < particleCount; iParticle++)
+    {
+        Particle &particle = initialParticles[iParticle];
+        particle.position[0] = 0.0f;
+        particle.position[1] = -2.0f;
+        particle.position[2] = 0.0f;
+        particle.position[3] = particleLifetime * iParticle / (float)particleCount;
+        particle.velocity[0] = particle.velocity[1] = particle.velocity[2] = particle.velocity[3] = 0.0f;
+    }
+
+    std::vector<FeedbackAttribute> attributes;
+    FeedbackAttribute position = { 0, 4, offsetof(Particle, position) };
+    FeedbackAttribute velocity = { 1, 4, offsetof(Particle, velocity) };
+    attributes.push_back(position);
+    attributes.push_back(velocity);
+    _state->particles.init(&initialParticles[0], particleCount, sizeof(Particle), attributes);
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    printOpenGLError();
+
+    _state->lastFrameTime = (float)elapsedTime();
+}
+
+Scene::~Scene()
+{
+    delete _state;
+    printOpenGLError();
+}
+
+const float aspectRatio = 1.0f;
+void Scene::reshape(int width, int height)
+{
+    int finalWidth = width;
+    int finalHeight = height;
+
+    int derivedHeight = width * (1/aspectRatio);
+    int derivedWidth = height * aspectRatio;
+
+    if (derivedHeight <= height)
+    {
+        finalHeight = derivedHeight;
+    }
+    else if (derivedWidth <= width)
+    {
+        finalWidth = derivedWidth;
+    }
+
+    glViewport( (width-finalWidth)  / 2,
+               (height-finalHeight) / 2,
+               finalWidth,
+               finalHeight);
+}
+
+void Scene::draw()
+{
+    float currentTime = (float)elapsedTime();
+    float deltaTime = fminf(currentTime - _state->lastFrameTime, 0.1f);
+    _state->lastFrameTime = currentTime;
+
+    // Simulate
+    glUseProgram(_state->updateProgram);
+    glUniform1f(_state->updateDeltaTimeUniform, deltaTime);
+    glUniform1f(_state->updateTimeUniform, currentTime);
+    _state->particles.update(_state->updateProgram);
+
+    // Render from the buffer that was just written
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    glUseProgram(_shaderProgram);
+    glBindVertexArray(_state->particles.currentVertexArray());
+    glDrawArrays(GL_POINTS, 0, _state->particles.vertexCount());
+    glBindVertexArray(0);
+    printOpenGLError();
+}
+
+bool Scene::isAnimated()
+{
+    return true;
+}
+
+void Scene::keyStateChanged(int key, int action)
+{
+}
+
+REGISTER_SCENE("gltut 03e");
+
+}
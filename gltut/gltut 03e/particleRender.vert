@@ -0,0 +1,14 @@
+#version 330
+
+layout(location = 0) in vec4 position;
+
+uniform float lifetime;
+
+smooth out vec4 theColor;
+
+void main()
+{
+	float lifeFactor = clamp(position.w / lifetime, 0.0f, 1.0f);
+	theColor = mix(vec4(1.0f, 0.9f, 0.3f, 1.0f), vec4(0.6f, 0.1f, 0.0f, 1.0f), lifeFactor);
+	gl_Position = vec4(position.xyz, 1.0f);
+}
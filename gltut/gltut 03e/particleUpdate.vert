@@ -0,0 +1,38 @@
+#version 330
+
+// xyz: position, w: age in seconds
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec4 velocity;
+
+uniform float deltaTime;
+uniform float time;
+uniform float lifetime;
+
+out vec4 outPosition;
+out vec4 outVelocity;
+
+float hash(float n)
+{
+	return fract(sin(n) * 43758.5453f);
+}
+
+void main()
+{
+	float age = position.w + deltaTime;
+	
+	if(age > lifetime)
+	{
+		// Respawn at the emitter with a fresh direction
+		float seed = float(gl_VertexID) * 0.001f + time;
+		float angle = hash(seed) * 3.14159f * 2.0f;
+		float spread = hash(seed + 17.0f) * 0.3f;
+		
+		outPosition = vec4(0.0f, -0.8f, 0.0f, age - lifetime);
+		outVelocity = vec4(cos(angle) * spread, 1.2f + hash(seed + 31.0f) * 0.4f, sin(angle) * spread, 0.0f);
+		return;
+	}
+	
+	vec3 newVelocity = velocity.xyz + vec3(0.0f, -1.0f, 0.0f) * deltaTime;
+	outPosition = vec4(position.xyz + newVelocity * deltaTime, age);
+	outVelocity = vec4(newVelocity, 0.0f);
+}
@@ -8,6 +8,7 @@
 // This file is licensed under the MIT License.
 //
 
+#define GLTUT_CHAPTER gltut04a
 #include "Scene.h"
 
 #include <string>
@@ -15,10 +16,13 @@
 
 #include "debug.h"
 #include "glhelpers.h"
+#include "programreflection.h"
 #include "GLFW/glfw3.h"
 
 #include <math.h>
 
+namespace GLTUT_CHAPTER {
+
 const float vertexData[] = {
     0.25f,  0.25f, 0.75f, 1.0f,
     0.25f, -0.25f, 0.75f, 1.0f,
@@ -121,7 +125,10 @@ const float vertexData[] = {
     
 };
 
-GLuint offsetUniform;
+struct Scene::ChapterState
+{
+    Uniform<glm::vec2> offsetUniform;
+};
 
 Scene::Scene()
 {
@@ -129,20 +136,19 @@ Scene::Scene()
 
 void Scene::init()
 {
-    _shaderProgram = createShaderProgramWithFilenames("OrthoWithOffset.vert", "StandardColors.frag");
+    _shaderProgram.reset(createShaderProgramWithFilenames("OrthoWithOffset.vert", "StandardColors.frag"));
     glUseProgram(_shaderProgram);
     printOpenGLError();
     
     // Initialize Vertex Buffer
-    glGenBuffers(1, &_vertexBufferObject);
+    _vertexBufferObject.create();
     
-	glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
+	_vertexBufferObject.bufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
     printOpenGLError();
     
     // Vertex array object
-    glGenVertexArrays(1, &_vertexArrayObject);
+    _vertexArrayObject.create();
 	glBindVertexArray(_vertexArrayObject);
     printOpenGLError();
 
@@ -152,15 +158,14 @@ void Scene::init()
     glFrontFace(GL_CW);
 
     // Uniforms
-	offsetUniform = glGetUniformLocation(_shaderProgram, "offset");
+	_state = new ChapterState();
+	_state->offsetUniform = Uniform<glm::vec2>(_shaderProgram, "offset");
     
 }
 
 Scene::~Scene()
 {
-    glDeleteProgram(_shaderProgram);
-    glDeleteBuffers(1, &_vertexBufferObject);
-    printOpenGLError();
+    delete _state;
 }
 
 const float aspectRatio = 1.0f;
@@ -185,8 +190,6 @@ void Scene::reshape(int width, int height)
                (height-finalHeight) / 2,
                finalWidth,
                finalHeight);
-
-    this->draw();
 }
 
 void Scene::draw()
@@ -194,7 +197,7 @@ void Scene::draw()
     glClearColor(0.2f, 0.0f, 0.0f, 0.0f);
     glClear(GL_COLOR_BUFFER_BIT);
     
-    glUniform2f(offsetUniform, 0.5f, 0.25f);
+    _state->offsetUniform.set(glm::vec2(0.5f, 0.25f));
 
 	size_t colorData = sizeof(vertexData) / 2;
 	glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferObject);
@@ -212,6 +215,15 @@ void Scene::draw()
     printOpenGLError();
 }
 
+bool Scene::isAnimated()
+{
+    return false;
+}
+
 void Scene::keyStateChanged(int key, int action)
 {
-}
\ No newline at end of file
+}
+
+REGISTER_SCENE("gltut 04a");
+
+}
@@ -8,6 +8,7 @@
 // This file is licensed under the MIT License.
 //
 
+#define GLTUT_CHAPTER gltut04c
 #include "Scene.h"
 
 #include <string>
@@ -15,10 +16,14 @@
 
 #include "debug.h"
 #include "glhelpers.h"
+#include "programreflection.h"
+#include "shaderbenchmark.h"
 #include "GLFW/glfw3.h"
 
 #include <math.h>
 
+namespace GLTUT_CHAPTER {
+
 const float vertexData[] = {
     0.25f,  0.25f, -1.25f, 1.0f,
     0.25f, -0.25f, -1.25f, 1.0f,
@@ -121,7 +126,10 @@ const float vertexData[] = {
     
 };
 
-GLuint offsetUniform;
+struct Scene::ChapterState
+{
+    Uniform<glm::vec2> offsetUniform;
+};
 
 GLuint perspectiveMatrixUniform;
 
@@ -131,20 +139,19 @@ Scene::Scene()
 
 void Scene::init()
 {
-    _shaderProgram = createShaderProgramWithFilenames("MatrixPerspective.vert", "StandardColors.frag");
+    _shaderProgram.reset(createShaderProgramWithFilenames("MatrixPerspective.vert", "StandardColors.frag"));
     glUseProgram(_shaderProgram);
     printOpenGLError();
     
     // Initialize Vertex Buffer
-    glGenBuffers(1, &_vertexBufferObject);
+    _vertexBufferObject.create();
     
-	glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
+	_vertexBufferObject.bufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
     printOpenGLError();
     
     // Vertex array object
-    glGenVertexArrays(1, &_vertexArrayObject);
+    _vertexArrayObject.create();
 	glBindVertexArray(_vertexArrayObject);
     printOpenGLError();
 
@@ -154,7 +161,8 @@ void Scene::init()
     glFrontFace(GL_CW);
 
     // Uniforms
-	offsetUniform = glGetUniformLocation(_shaderProgram, "offset");
+	_state = new ChapterState();
+	_state->offsetUniform = Uniform<glm::vec2>(_shaderProgram, "offset");
     
 	perspectiveMatrixUniform = glGetUniformLocation(_shaderProgram, "perspectiveMatrix");
     
@@ -175,9 +183,7 @@ void Scene::init()
 
 Scene::~Scene()
 {
-    glDeleteProgram(_shaderProgram);
-    glDeleteBuffers(1, &_vertexBufferObject);
-    printOpenGLError();
+    delete _state;
 }
 
 const float aspectRatio = 1.0f;
@@ -202,8 +208,6 @@ void Scene::reshape(int width, int height)
                (height-finalHeight) / 2,
                finalWidth,
                finalHeight);
-
-    this->draw();
 }
 
 void Scene::draw()
@@ -211,7 +215,7 @@ void Scene::draw()
     glClearColor(0.2f, 0.0f, 0.0f, 0.0f);
     glClear(GL_COLOR_BUFFER_BIT);
     
-	glUniform2f(offsetUniform, 0.5f, 0.5f);
+	_state->offsetUniform.set(glm::vec2(0.5f, 0.5f));
 
 	size_t colorData = sizeof(vertexData) / 2;
 	glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferObject);
@@ -229,6 +233,30 @@ void Scene::draw()
     printOpenGLError();
 }
 
+bool Scene::isAnimated()
+{
+    return false;
+}
+
 void Scene::keyStateChanged(int key, int action)
 {
-}
\ No newline at end of file
+}
+
+// The same projection as 04b computes by hand, for comparing the two
+REGISTER_SHADER_BENCHMARK("gltut 04c", "MatrixPerspective.vert", "StandardColors.frag", [](GLuint program) {
+	float fzNear = 0.5f; float fzFar = 3.0f;
+	float theMatrix[16];
+	memset(theMatrix, 0, sizeof(float) * 16);
+	theMatrix[0] = 1.0f;
+	theMatrix[5] = 1.0f;
+	theMatrix[10] = (fzFar + fzNear) / (fzNear - fzFar);
+	theMatrix[14] = (2 * fzFar * fzNear) / (fzNear - fzFar);
+	theMatrix[11] = -1.0f;
+    
+	glUniform2f(glGetUniformLocation(program, "offset"), 0.0f, 0.0f);
+	glUniformMatrix4fv(glGetUniformLocation(program, "perspectiveMatrix"), 1, GL_FALSE, theMatrix);
+});
+
+REGISTER_SCENE("gltut 04c");
+
+}
@@ -8,6 +8,7 @@
 // This file is licensed under the MIT License.
 //
 
+#define GLTUT_CHAPTER gltut04d
 #include "Scene.h"
 
 #include <string>
@@ -15,10 +16,13 @@
 
 #include "debug.h"
 #include "glhelpers.h"
+#include "programreflection.h"
 #include "GLFW/glfw3.h"
 
 #include <math.h>
 
+namespace GLTUT_CHAPTER {
+
 const float vertexData[] = {
     0.25f,  0.25f, -1.25f, 1.0f,
     0.25f, -0.25f, -1.25f, 1.0f,
@@ -121,7 +125,10 @@ const float vertexData[] = {
     
 };
 
-GLuint offsetUniform;
+struct Scene::ChapterState
+{
+    Uniform<glm::vec2> offsetUniform;
+};
 GLuint perspectiveMatrixUniform;
 
 float perspectiveMatrix[16];
@@ -133,20 +140,19 @@ Scene::Scene()
 
 void Scene::init()
 {
-    _shaderProgram = createShaderProgramWithFilenames("MatrixPerspective.vert", "StandardColors.frag");
+    _shaderProgram.reset(createShaderProgramWithFilenames("MatrixPerspective.vert", "StandardColors.frag"));
     glUseProgram(_shaderProgram);
     printOpenGLError();
     
     // Initialize Vertex Buffer
-    glGenBuffers(1, &_vertexBufferObject);
+    _vertexBufferObject.create();
     
-	glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
+	_vertexBufferObject.bufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
     printOpenGLError();
     
     // Vertex array object
-    glGenVertexArrays(1, &_vertexArrayObject);
+    _vertexArrayObject.create();
 	glBindVertexArray(_vertexArrayObject);
     printOpenGLError();
 
@@ -156,7 +162,8 @@ void Scene::init()
     glFrontFace(GL_CW);
 
     // Uniforms
-	offsetUniform = glGetUniformLocation(_shaderProgram, "offset");
+	_state = new ChapterState();
+	_state->offsetUniform = Uniform<glm::vec2>(_shaderProgram, "offset");
     
 	perspectiveMatrixUniform = glGetUniformLocation(_shaderProgram, "perspectiveMatrix");
     
@@ -176,9 +183,7 @@ void Scene::init()
 
 Scene::~Scene()
 {
-    glDeleteProgram(_shaderProgram);
-    glDeleteBuffers(1, &_vertexBufferObject);
-    printOpenGLError();
+    delete _state;
 }
 
 void Scene::reshape(int width, int height)
@@ -187,8 +192,6 @@ void Scene::reshape(int width, int height)
     perspectiveMatrix[5] = frustumScale;
     
     glUniformMatrix4fv(perspectiveMatrixUniform, 1, GL_FALSE, perspectiveMatrix);
-
-    this->draw();
 }
 
 void Scene::draw()
@@ -196,7 +199,7 @@ void Scene::draw()
     glClearColor(0.2f, 0.0f, 0.0f, 0.0f);
     glClear(GL_COLOR_BUFFER_BIT);
     
-	glUniform2f(offsetUniform, 0.5f, 0.5f);
+	_state->offsetUniform.set(glm::vec2(0.5f, 0.5f));
 
 	size_t colorData = sizeof(vertexData) / 2;
 	glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferObject);
@@ -214,6 +217,15 @@ void Scene::draw()
     printOpenGLError();
 }
 
+bool Scene::isAnimated()
+{
+    return false;
+}
+
 void Scene::keyStateChanged(int key, int action)
 {
-}
\ No newline at end of file
+}
+
+REGISTER_SCENE("gltut 04d");
+
+}
@@ -8,6 +8,7 @@
 // This file is licensed under the MIT License.
 //
 
+#define GLTUT_CHAPTER gltut05a
 #include "Scene.h"
 
 #include <string>
@@ -19,6 +20,8 @@
 
 #include <math.h>
 
+namespace GLTUT_CHAPTER {
+
 const int numberOfVertices = 36;
 
 #define RIGHT_EXTENT 0.8f
@@ -154,10 +157,12 @@ GLuint perspectiveMatrixUniform;
 float perspectiveMatrix[16];
 const float frustumScale = 1.0f;
 
-GLuint indexBufferObject;
-
-GLuint vertexArrayObject1;
-GLuint vertexArrayObject2;
+// One vertex array per half of the vertex data
+struct Scene::ChapterState
+{
+    GLVertexArray vertexArrayObject1;
+    GLVertexArray vertexArrayObject2;
+};
 
 
 Scene::Scene()
@@ -166,27 +171,28 @@ Scene::Scene()
 
 void Scene::init()
 {
-    _shaderProgram = createShaderProgramWithFilenames("Standard5.vert", "Standard5.frag");
+    _shaderProgram.reset(createShaderProgramWithFilenames("Standard5.vert", "Standard5.frag"));
     glUseProgram(_shaderProgram);
     printOpenGLError();
 
     // Vertex buffer objects
-    glGenBuffers(1, &_vertexBufferObject);
+    _vertexBufferObject.create();
     
-	glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
+	_vertexBufferObject.bufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
     
-	glGenBuffers(1, &indexBufferObject);
+	_indexBufferObject.create(GPUIndexData);
     
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferObject);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indexData), indexData, GL_STATIC_DRAW);
+	_indexBufferObject.bufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indexData), indexData, GL_STATIC_DRAW);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     printOpenGLError();
 
     
     // Vertex array objects
-    glGenVertexArrays(1, &vertexArrayObject1);
+    _state = new ChapterState();
+    GLVertexArray &vertexArrayObject1 = _state->vertexArrayObject1;
+    GLVertexArray &vertexArrayObject2 = _state->vertexArrayObject2;
+    vertexArrayObject1.create();
     glBindVertexArray(vertexArrayObject1);
     
     size_t colorDataOffset = sizeof(float) * 3 * numberOfVertices;
@@ -196,12 +202,12 @@ void Scene::init()
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
     glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, (void*)colorDataOffset);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferObject);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBufferObject);
     
     glBindVertexArray(0);
     
     
-    glGenVertexArrays(1, &vertexArrayObject2);
+    vertexArrayObject2.create();
     glBindVertexArray(vertexArrayObject2);
     
     size_t posDataOffset = sizeof(float) * 3 * (numberOfVertices/2);
@@ -212,7 +218,7 @@ void Scene::init()
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)posDataOffset);
     glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, (void*)colorDataOffset);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferObject);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBufferObject);
     
     glBindVertexArray(0);
     printOpenGLError();
@@ -245,9 +251,7 @@ void Scene::init()
 
 Scene::~Scene()
 {
-    glDeleteProgram(_shaderProgram);
-    glDeleteBuffers(1, &_vertexBufferObject);
-    printOpenGLError();
+    delete _state;
 }
 
 void Scene::reshape(int width, int height)
@@ -256,8 +260,6 @@ void Scene::reshape(int width, int height)
     perspectiveMatrix[5] = frustumScale;
     
     glUniformMatrix4fv(perspectiveMatrixUniform, 1, GL_FALSE, perspectiveMatrix);
-
-    this->draw();
 }
 
 void Scene::draw()
@@ -265,14 +267,14 @@ void Scene::draw()
     glClearColor(0.2f, 0.0f, 0.0f, 0.0f);
     glClear(GL_COLOR_BUFFER_BIT);
  
-	glBindVertexArray(vertexArrayObject1);
+	glBindVertexArray(_state->vertexArrayObject1);
     printOpenGLError();
 	glUniform3f(offsetUniform, 0.0f, 0.0f, 0.0f);
     printOpenGLError();
  	glDrawElements(GL_TRIANGLES, ARRAY_COUNT(indexData), GL_UNSIGNED_SHORT, 0);
     printOpenGLError();
 
-	glBindVertexArray(vertexArrayObject2);
+	glBindVertexArray(_state->vertexArrayObject2);
     printOpenGLError();
 	glUniform3f(offsetUniform, 0.0f, 0.0f, -1.0f);
     printOpenGLError();
@@ -280,6 +282,15 @@ void Scene::draw()
     printOpenGLError();
 }
 
+bool Scene::isAnimated()
+{
+    return false;
+}
+
 void Scene::keyStateChanged(int key, int action)
 {
-}
\ No newline at end of file
+}
+
+REGISTER_SCENE("gltut 05a");
+
+}
@@ -8,6 +8,7 @@
 // This file is licensed under the MIT License.
 //
 
+#define GLTUT_CHAPTER gltut05b
 #include "Scene.h"
 
 #include <string>
@@ -15,10 +16,13 @@
 
 #include "debug.h"
 #include "glhelpers.h"
+#include "programreflection.h"
 #include "GLFW/glfw3.h"
 
 #include <math.h>
 
+namespace GLTUT_CHAPTER {
+
 const int numberOfVertices = 36;
 
 #define RIGHT_EXTENT 0.8f
@@ -148,41 +152,40 @@ const GLshort indexData[] =
 	17, 16, 14,
 };
 
-GLuint offsetUniform;
+struct Scene::ChapterState
+{
+    Uniform<glm::vec3> offsetUniform;
+};
 GLuint perspectiveMatrixUniform;
 
 float perspectiveMatrix[16];
 const float frustumScale = 1.0f;
 
-GLuint indexBufferObject;
-
 Scene::Scene()
 {
 }
 
 void Scene::init()
 {
-    _shaderProgram = createShaderProgramWithFilenames("Standard5.vert", "Standard5.frag");
+    _shaderProgram.reset(createShaderProgramWithFilenames("Standard5.vert", "Standard5.frag"));
     glUseProgram(_shaderProgram);
     printOpenGLError();
 
     // Vertex buffer objects
-    glGenBuffers(1, &_vertexBufferObject);
+    _vertexBufferObject.create();
     
-	glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
+	_vertexBufferObject.bufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
     
-	glGenBuffers(1, &indexBufferObject);
+	_indexBufferObject.create(GPUIndexData);
     
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferObject);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indexData), indexData, GL_STATIC_DRAW);
+	_indexBufferObject.bufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indexData), indexData, GL_STATIC_DRAW);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     printOpenGLError();
 
     
     // Vertex array objects
-    glGenVertexArrays(1, &_vertexArrayObject);
+    _vertexArrayObject.create();
     glBindVertexArray(_vertexArrayObject);
     
     size_t colorDataOffset = sizeof(float) * 3 * numberOfVertices;
@@ -192,7 +195,7 @@ void Scene::init()
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
     glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, (void*)colorDataOffset);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferObject);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBufferObject);
     
     glBindVertexArray(0);
     printOpenGLError();
@@ -204,7 +207,8 @@ void Scene::init()
     printOpenGLError();
 
     // Uniforms
-	offsetUniform = glGetUniformLocation(_shaderProgram, "offset");
+	_state = new ChapterState();
+	_state->offsetUniform = Uniform<glm::vec3>(_shaderProgram, "offset");
     
 	perspectiveMatrixUniform = glGetUniformLocation(_shaderProgram, "perspectiveMatrix");
     
@@ -225,9 +229,7 @@ void Scene::init()
 
 Scene::~Scene()
 {
-    glDeleteProgram(_shaderProgram);
-    glDeleteBuffers(1, &_vertexBufferObject);
-    printOpenGLError();
+    delete _state;
 }
 
 void Scene::reshape(int width, int height)
@@ -236,8 +238,6 @@ void Scene::reshape(int width, int height)
     perspectiveMatrix[5] = frustumScale;
     
     glUniformMatrix4fv(perspectiveMatrixUniform, 1, GL_FALSE, perspectiveMatrix);
-
-    this->draw();
 }
 
 void Scene::draw()
@@ -248,16 +248,25 @@ void Scene::draw()
 	glBindVertexArray(_vertexArrayObject);
     printOpenGLError();
 
-	glUniform3f(offsetUniform, 0.0f, 0.0f, 0.0f);
+	_state->offsetUniform.set(glm::vec3(0.0f, 0.0f, 0.0f));
     glDrawElements(GL_TRIANGLES, ARRAY_COUNT(indexData), GL_UNSIGNED_SHORT, 0);
     printOpenGLError();
 
-    glUniform3f(offsetUniform, 0.0f, 0.0f, -1.0f);
+    _state->offsetUniform.set(glm::vec3(0.0f, 0.0f, -1.0f));
     glDrawElementsBaseVertex(GL_TRIANGLES, ARRAY_COUNT(indexData),
                              GL_UNSIGNED_SHORT, 0, numberOfVertices / 2);
     printOpenGLError();
 }
 
+bool Scene::isAnimated()
+{
+    return false;
+}
+
 void Scene::keyStateChanged(int key, int action)
 {
-}
\ No newline at end of file
+}
+
+REGISTER_SCENE("gltut 05b");
+
+}
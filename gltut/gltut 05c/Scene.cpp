@@ -8,6 +8,7 @@
 // This file is licensed under the MIT License.
 //
 
+#define GLTUT_CHAPTER gltut05c
 #include "Scene.h"
 
 #include <string>
@@ -15,10 +16,13 @@
 
 #include "debug.h"
 #include "glhelpers.h"
+#include "renderqueue.h"
 #include "GLFW/glfw3.h"
 
 #include <math.h>
 
+namespace GLTUT_CHAPTER {
+
 const int numberOfVertices = 36;
 
 #define RIGHT_EXTENT 0.8f
@@ -154,7 +158,16 @@ GLuint perspectiveMatrixUniform;
 float perspectiveMatrix[16];
 const float frustumScale = 1.0f;
 
-GLuint indexBufferObject;
+struct Scene::ChapterState
+{
+    OpaqueRenderQueue opaqueQueue;
+};
+
+// Distance from the camera to the center of an object drawn with this z offset
+inline float ViewDepth(float fOffsetZ)
+{
+    return -((FRONT_EXTENT + REAR_EXTENT) / 2.0f + fOffsetZ);
+}
 
 Scene::Scene()
 {
@@ -162,7 +175,7 @@ Scene::Scene()
 
 void Scene::init()
 {
-    _shaderProgram = createShaderProgramWithFilenames("Standard5.vert", "Standard5.frag");
+    _shaderProgram.reset(createShaderProgramWithFilenames("Standard5.vert", "Standard5.frag"));
     glUseProgram(_shaderProgram);
     printOpenGLError();
 
@@ -185,22 +198,20 @@ void Scene::init()
     printOpenGLError();
 
     // Vertex buffer objects
-    glGenBuffers(1, &_vertexBufferObject);
+    _vertexBufferObject.create();
     
-	glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
+	_vertexBufferObject.bufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
     
-	glGenBuffers(1, &indexBufferObject);
+	_indexBufferObject.create(GPUIndexData);
     
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferObject);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indexData), indexData, GL_STATIC_DRAW);
+	_indexBufferObject.bufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indexData), indexData, GL_STATIC_DRAW);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     printOpenGLError();
 
     
     // Vertex array objects
-    glGenVertexArrays(1, &_vertexArrayObject);
+    _vertexArrayObject.create();
     glBindVertexArray(_vertexArrayObject);
     
     size_t colorDataOffset = sizeof(float) * 3 * numberOfVertices;
@@ -210,7 +221,7 @@ void Scene::init()
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
     glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, (void*)colorDataOffset);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferObject);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBufferObject);
     
     glBindVertexArray(0);
     printOpenGLError();
@@ -226,13 +237,14 @@ void Scene::init()
 	glDepthMask(GL_TRUE);
 	glDepthFunc(GL_LEQUAL);
 	glDepthRange(0.0f, 1.0f);
+
+    // Its sample queries are released with the scene
+    _state = new ChapterState();
 }
 
 Scene::~Scene()
 {
-    glDeleteProgram(_shaderProgram);
-    glDeleteBuffers(1, &_vertexBufferObject);
-    printOpenGLError();
+    delete _state;
 }
 
 void Scene::reshape(int width, int height)
@@ -241,12 +253,12 @@ void Scene::reshape(int width, int height)
     perspectiveMatrix[5] = frustumScale;
     
     glUniformMatrix4fv(perspectiveMatrixUniform, 1, GL_FALSE, perspectiveMatrix);
-
-    this->draw();
 }
 
 void Scene::draw()
 {
+    OpaqueRenderQueue &opaqueQueue = _state->opaqueQueue;
+
     glClearColor(0.2f, 0.0f, 0.0f, 0.0f);
 	glClearDepth(1.0f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -255,16 +267,54 @@ void Scene::draw()
 	glBindVertexArray(_vertexArrayObject);
     printOpenGLError();
 
-	glUniform3f(offsetUniform, 0.0f, 0.0f, 0.0f);
-    glDrawElements(GL_TRIANGLES, ARRAY_COUNT(indexData), GL_UNSIGNED_SHORT, 0);
-    printOpenGLError();
+    opaqueQueue.add(ViewDepth(0.0f), []()
+    {
+        glUniform3f(offsetUniform, 0.0f, 0.0f, 0.0f);
+        glDrawElements(GL_TRIANGLES, ARRAY_COUNT(indexData), GL_UNSIGNED_SHORT, 0);
+    });
+
+    opaqueQueue.add(ViewDepth(-0.25f), []()
+    {
+        glUniform3f(offsetUniform, 0.0f, 0.0f, -0.25f);
+        glDrawElementsBaseVertex(GL_TRIANGLES, ARRAY_COUNT(indexData),
+                                 GL_UNSIGNED_SHORT, 0, numberOfVertices / 2);
+    });
 
-    glUniform3f(offsetUniform, 0.0f, 0.0f, -0.25f);
-    glDrawElementsBaseVertex(GL_TRIANGLES, ARRAY_COUNT(indexData),
-                             GL_UNSIGNED_SHORT, 0, numberOfVertices / 2);
+    opaqueQueue.flush();
     printOpenGLError();
 }
 
+bool Scene::isAnimated()
+{
+    return false;
+}
+
 void Scene::keyStateChanged(int key, int action)
 {
-}
\ No newline at end of file
+    OpaqueRenderQueue &opaqueQueue = _state->opaqueQueue;
+    if ( action == GLFW_PRESS ) {
+        switch (key)
+        {
+            case GLFW_KEY_S:
+                opaqueQueue.setSortMode(opaqueQueue.sortMode() == OpaqueSortFrontToBack ?
+                                        OpaqueSortSubmissionOrder : OpaqueSortFrontToBack);
+                break;
+            case GLFW_KEY_P:
+                opaqueQueue.setDepthPrepass(!opaqueQueue.depthPrepass());
+                break;
+            case GLFW_KEY_ENTER:
+                break;
+            default:
+                return;
+        }
+        
+        printf("Sorting: %s, depth pre-pass: %s, fragments shaded last frame: %u\n",
+               opaqueQueue.sortMode() == OpaqueSortFrontToBack ? "front to back" : "submission order",
+               opaqueQueue.depthPrepass() ? "on" : "off",
+               opaqueQueue.shadedSamples());
+    }
+}
+
+REGISTER_SCENE("gltut 05c");
+
+}
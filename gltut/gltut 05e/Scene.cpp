@@ -8,6 +8,7 @@
 // This file is licensed under the MIT License.
 //
 
+#define GLTUT_CHAPTER gltut05e
 #include "Scene.h"
 
 #include <string>
@@ -19,6 +20,8 @@
 
 #include <math.h>
 
+namespace GLTUT_CHAPTER {
+
 const int numberOfVertices = 36;
 
 #define RIGHT_EXTENT 0.8f
@@ -154,15 +157,13 @@ GLuint perspectiveMatrixUniform;
 float perspectiveMatrix[16];
 const float frustumScale = 1.0f;
 
-GLuint indexBufferObject;
-
 Scene::Scene()
 {
 }
 
 void Scene::init()
 {
-    _shaderProgram = createShaderProgramWithFilenames("Standard5.vert", "Standard5.frag");
+    _shaderProgram.reset(createShaderProgramWithFilenames("Standard5.vert", "Standard5.frag"));
     glUseProgram(_shaderProgram);
     printOpenGLError();
 
@@ -185,22 +186,20 @@ void Scene::init()
     printOpenGLError();
 
     // Vertex buffer objects
-    glGenBuffers(1, &_vertexBufferObject);
+    _vertexBufferObject.create();
     
-	glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
+	_vertexBufferObject.bufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
     
-	glGenBuffers(1, &indexBufferObject);
+	_indexBufferObject.create(GPUIndexData);
     
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferObject);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indexData), indexData, GL_STATIC_DRAW);
+	_indexBufferObject.bufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indexData), indexData, GL_STATIC_DRAW);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     printOpenGLError();
 
     
     // Vertex array objects
-    glGenVertexArrays(1, &_vertexArrayObject);
+    _vertexArrayObject.create();
     glBindVertexArray(_vertexArrayObject);
     
     size_t colorDataOffset = sizeof(float) * 3 * numberOfVertices;
@@ -210,7 +209,7 @@ void Scene::init()
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
     glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, (void*)colorDataOffset);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferObject);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBufferObject);
     
     glBindVertexArray(0);
     printOpenGLError();
@@ -230,9 +229,6 @@ void Scene::init()
 
 Scene::~Scene()
 {
-    glDeleteProgram(_shaderProgram);
-    glDeleteBuffers(1, &_vertexBufferObject);
-    printOpenGLError();
 }
 
 void Scene::reshape(int width, int height)
@@ -241,8 +237,6 @@ void Scene::reshape(int width, int height)
     perspectiveMatrix[5] = frustumScale;
     
     glUniformMatrix4fv(perspectiveMatrixUniform, 1, GL_FALSE, perspectiveMatrix);
-
-    this->draw();
 }
 
 void Scene::draw()
@@ -265,6 +259,15 @@ void Scene::draw()
     printOpenGLError();
 }
 
+bool Scene::isAnimated()
+{
+    return false;
+}
+
 void Scene::keyStateChanged(int key, int action)
 {
-}
\ No newline at end of file
+}
+
+REGISTER_SCENE("gltut 05e");
+
+}
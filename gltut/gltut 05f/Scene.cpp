@@ -8,6 +8,7 @@
 // This file is licensed under the MIT License.
 //
 
+#define GLTUT_CHAPTER gltut05f
 #include "Scene.h"
 
 #include <string>
@@ -20,6 +21,8 @@
 
 #include <math.h>
 
+namespace GLTUT_CHAPTER {
+
 const int numberOfVertices = 8;
 
 #define GREEN_COLOR 0.0f, 1.0f, 0.0f, 1.0f
@@ -69,15 +72,13 @@ GLuint perspectiveMatrixUniform;
 float perspectiveMatrix[16];
 const float frustumScale = 1.0f;
 
-GLuint indexBufferObject;
-
 Scene::Scene()
 {
 }
 
 void Scene::init()
 {
-    _shaderProgram = createShaderProgramWithFilenames("Standard5.vert", "Standard5.frag");
+    _shaderProgram.reset(createShaderProgramWithFilenames("Standard5.vert", "Standard5.frag"));
     glUseProgram(_shaderProgram);
     printOpenGLError();
 
@@ -100,22 +101,20 @@ void Scene::init()
     printOpenGLError();
 
     // Vertex buffer objects
-    glGenBuffers(1, &_vertexBufferObject);
+    _vertexBufferObject.create();
     
-	glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
+	_vertexBufferObject.bufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
     
-	glGenBuffers(1, &indexBufferObject);
+	_indexBufferObject.create(GPUIndexData);
     
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferObject);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indexData), indexData, GL_STATIC_DRAW);
+	_indexBufferObject.bufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indexData), indexData, GL_STATIC_DRAW);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     printOpenGLError();
 
     
     // Vertex array objects
-    glGenVertexArrays(1, &_vertexArrayObject);
+    _vertexArrayObject.create();
     glBindVertexArray(_vertexArrayObject);
     
     size_t colorDataOffset = sizeof(float) * 3 * numberOfVertices;
@@ -125,7 +124,7 @@ void Scene::init()
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
     glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, (void*)colorDataOffset);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferObject);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBufferObject);
     
     glBindVertexArray(0);
     printOpenGLError();
@@ -145,9 +144,6 @@ void Scene::init()
 
 Scene::~Scene()
 {
-    glDeleteProgram(_shaderProgram);
-    glDeleteBuffers(1, &_vertexBufferObject);
-    printOpenGLError();
 }
 
 void Scene::reshape(int width, int height)
@@ -156,20 +152,16 @@ void Scene::reshape(int width, int height)
     perspectiveMatrix[5] = frustumScale;
     
     glUniformMatrix4fv(perspectiveMatrixUniform, 1, GL_FALSE, perspectiveMatrix);
-
-    this->draw();
 }
 
 float fStart = 2534.0f;
 float fDelta = 0.0f;
 
-float CalcZOFfset()
+float CalcZOFfset(float fElapsedTime)
 {
 	const float fLoopDuration = 5.0f;
 	const float fScale = 3.14159f * 2.0f / fLoopDuration;
     
-	float fElapsedTime = glfwGetTime();
-    
 	float fCurrTimeThroughLoop = fmodf(fElapsedTime, fLoopDuration);
     
     float fRet = cosf(fCurrTimeThroughLoop * fScale) * 500.0f - fStart;
@@ -192,7 +184,7 @@ void Scene::draw()
 	glUseProgram(_shaderProgram);
 	glBindVertexArray(_vertexArrayObject);
     
-	float fZOffset = CalcZOFfset();
+	float fZOffset = CalcZOFfset(elapsedTime());
 	glUniform3f(offsetUniform, 0.0f, 0.0f, fZOffset);
 	glDrawElements(GL_TRIANGLES, ARRAY_COUNT(indexData), GL_UNSIGNED_SHORT, 0);
     
@@ -267,6 +259,15 @@ void Scene::draw()
 	}
 }
 
+bool Scene::isAnimated()
+{
+    return true;
+}
+
 void Scene::keyStateChanged(int key, int action)
 {
 }
+
+REGISTER_SCENE("gltut 05f");
+
+}
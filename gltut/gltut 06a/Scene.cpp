@@ -8,6 +8,7 @@
 // This file is licensed under the MIT License.
 //
 
+#define GLTUT_CHAPTER gltut06a
 #include "Scene.h"
 
 #include <math.h>
@@ -16,11 +17,14 @@
 
 #include "debug.h"
 #include "glhelpers.h"
+#include "microbenchmark.h"
 #include "GLFW/glfw3.h"
 
 #include "glm.hpp"
 #include "gtc/type_ptr.hpp"
 
+namespace GLTUT_CHAPTER {
+
 const int numberOfVertices = 8;
 
 #define GREEN_COLOR 0.0f, 1.0f, 0.0f, 1.0f
@@ -79,8 +83,6 @@ float CalcFrustumScale(float fFovDeg)
 
 const float frustumScale = CalcFrustumScale(45.0f);
 
-GLuint indexBufferObject;
-
 glm::vec3 StationaryOffset(float fElapsedTime)
 {
 	return glm::vec3(0.0f, 0.0f, -20.0f);
@@ -140,7 +142,7 @@ Scene::Scene()
 
 void Scene::init()
 {
-    _shaderProgram = createShaderProgramWithFilenames("PosColorLocalTransform.vert", "ColorPassthrough.frag");
+    _shaderProgram.reset(createShaderProgramWithFilenames("PosColorLocalTransform.vert", "ColorPassthrough.frag"));
     glUseProgram(_shaderProgram);
     printOpenGLError();
     
@@ -160,22 +162,20 @@ void Scene::init()
 	glUniformMatrix4fv(cameraToClipMatrixUniform, 1, GL_FALSE, glm::value_ptr(cameraToClipMatrix));
     
     // Vertex buffer objects
-    glGenBuffers(1, &_vertexBufferObject);
+    _vertexBufferObject.create();
     
-	glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
+	_vertexBufferObject.bufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
     
-	glGenBuffers(1, &indexBufferObject);
+	_indexBufferObject.create(GPUIndexData);
     
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferObject);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indexData), indexData, GL_STATIC_DRAW);
+	_indexBufferObject.bufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indexData), indexData, GL_STATIC_DRAW);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     printOpenGLError();
     
     
     // Vertex array objects
-    glGenVertexArrays(1, &_vertexArrayObject);
+    _vertexArrayObject.create();
     glBindVertexArray(_vertexArrayObject);
     
     size_t colorDataOffset = sizeof(float) * 3 * numberOfVertices;
@@ -185,7 +185,7 @@ void Scene::init()
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
     glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, (void*)colorDataOffset);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferObject);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBufferObject);
     
     glBindVertexArray(0);
     printOpenGLError();
@@ -205,9 +205,6 @@ void Scene::init()
 
 Scene::~Scene()
 {
-    glDeleteProgram(_shaderProgram);
-    glDeleteBuffers(1, &_vertexBufferObject);
-    printOpenGLError();
 }
 
 void Scene::reshape(int width, int height)
@@ -215,9 +212,7 @@ void Scene::reshape(int width, int height)
     cameraToClipMatrix[0].x = frustumScale / (width / (float)height);
     cameraToClipMatrix[1].y = frustumScale;
     
-    glUniformMatrix4fv(cameraToClipMatrixUniform, 1, GL_FALSE, glm::value_ptr(cameraToClipMatrix));
-    
-    this->draw();
+    glUniformMatrix4fv(cameraToClipMatrixUniform, 1, GL_FALSE, glm::value_ptr(clipTile() * cameraToClipMatrix));
 }
 
 void Scene::draw()
@@ -228,7 +223,7 @@ void Scene::draw()
     
 	glBindVertexArray(_vertexArrayObject);
     
-	float fElapsedTime = glfwGetTime();
+	float fElapsedTime = elapsedTime();
 	for(int iLoop = 0; iLoop < ARRAY_COUNT(g_instanceList); iLoop++)
 	{
 		Instance &currInst = g_instanceList[iLoop];
@@ -241,6 +236,36 @@ void Scene::draw()
 	glBindVertexArray(0);
 }
 
+bool Scene::isAnimated()
+{
+    return true;
+}
+
 void Scene::keyStateChanged(int key, int action)
 {
-}
\ No newline at end of file
+}
+
+REGISTER_MICROBENCHMARK("06a CalcFrustumScale", [](int iterations) {
+	for(int iIteration = 0; iIteration < iterations; iIteration++)
+	{
+		float fFrustumScale = CalcFrustumScale(30.0f + (iIteration & 63));
+		DoNotOptimize(fFrustumScale);
+	}
+});
+
+// All three instances, as draw() builds them every frame
+REGISTER_MICROBENCHMARK("06a Instance::ConstructMatrix", [](int iterations) {
+	for(int iIteration = 0; iIteration < iterations; iIteration++)
+	{
+		float fElapsedTime = iIteration * 0.001f;
+		for(size_t iLoop = 0; iLoop < ARRAY_COUNT(g_instanceList); iLoop++)
+		{
+			const glm::mat4 &transformMatrix = g_instanceList[iLoop].ConstructMatrix(fElapsedTime);
+			DoNotOptimize(transformMatrix);
+		}
+	}
+});
+
+REGISTER_SCENE("gltut 06a");
+
+}
@@ -8,6 +8,7 @@
 // This file is licensed under the MIT License.
 //
 
+#define GLTUT_CHAPTER gltut06b
 #include "Scene.h"
 
 #include <math.h>
@@ -21,6 +22,8 @@
 #include "glm.hpp"
 #include "gtc/type_ptr.hpp"
 
+namespace GLTUT_CHAPTER {
+
 const int numberOfVertices = 8;
 
 #define GREEN_COLOR 0.0f, 1.0f, 0.0f, 1.0f
@@ -79,8 +82,6 @@ float CalcFrustumScale(float fFovDeg)
 
 const float frustumScale = CalcFrustumScale(45.0f);
 
-GLuint indexBufferObject;
-
 float CalcLerpFactor(float fElapsedTime, float fLoopDuration)
 {
 	float fValue = fmodf(fElapsedTime, fLoopDuration) / fLoopDuration;
@@ -157,7 +158,7 @@ Scene::Scene()
 
 void Scene::init()
 {
-    _shaderProgram = createShaderProgramWithFilenames("PosColorLocalTransform.vert", "ColorPassthrough.frag");
+    _shaderProgram.reset(createShaderProgramWithFilenames("PosColorLocalTransform.vert", "ColorPassthrough.frag"));
     glUseProgram(_shaderProgram);
     printOpenGLError();
     
@@ -177,22 +178,20 @@ void Scene::init()
 	glUniformMatrix4fv(cameraToClipMatrixUniform, 1, GL_FALSE, glm::value_ptr(cameraToClipMatrix));
     
     // Vertex buffer objects
-    glGenBuffers(1, &_vertexBufferObject);
+    _vertexBufferObject.create();
     
-	glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
+	_vertexBufferObject.bufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
     
-	glGenBuffers(1, &indexBufferObject);
+	_indexBufferObject.create(GPUIndexData);
     
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferObject);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indexData), indexData, GL_STATIC_DRAW);
+	_indexBufferObject.bufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indexData), indexData, GL_STATIC_DRAW);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     printOpenGLError();
     
     
     // Vertex array objects
-    glGenVertexArrays(1, &_vertexArrayObject);
+    _vertexArrayObject.create();
     glBindVertexArray(_vertexArrayObject);
     
     size_t colorDataOffset = sizeof(float) * 3 * numberOfVertices;
@@ -202,7 +201,7 @@ void Scene::init()
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
     glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, (void*)colorDataOffset);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferObject);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBufferObject);
     
     glBindVertexArray(0);
     printOpenGLError();
@@ -222,9 +221,6 @@ void Scene::init()
 
 Scene::~Scene()
 {
-    glDeleteProgram(_shaderProgram);
-    glDeleteBuffers(1, &_vertexBufferObject);
-    printOpenGLError();
 }
 
 void Scene::reshape(int width, int height)
@@ -232,9 +228,7 @@ void Scene::reshape(int width, int height)
     cameraToClipMatrix[0].x = frustumScale / (width / (float)height);
     cameraToClipMatrix[1].y = frustumScale;
     
-    glUniformMatrix4fv(cameraToClipMatrixUniform, 1, GL_FALSE, glm::value_ptr(cameraToClipMatrix));
-    
-    this->draw();
+    glUniformMatrix4fv(cameraToClipMatrixUniform, 1, GL_FALSE, glm::value_ptr(clipTile() * cameraToClipMatrix));
 }
 
 void Scene::draw()
@@ -245,7 +239,7 @@ void Scene::draw()
     
 	glBindVertexArray(_vertexArrayObject);
     
-	float fElapsedTime = glfwGetTime();
+	float fElapsedTime = elapsedTime();
 	for(int iLoop = 0; iLoop < ARRAY_COUNT(g_instanceList); iLoop++)
 	{
 		Instance &currInst = g_instanceList[iLoop];
@@ -258,6 +252,15 @@ void Scene::draw()
 	glBindVertexArray(0);
 }
 
+bool Scene::isAnimated()
+{
+    return true;
+}
+
 void Scene::keyStateChanged(int key, int action)
 {
-}
\ No newline at end of file
+}
+
+REGISTER_SCENE("gltut 06b");
+
+}
@@ -8,6 +8,7 @@
 // This file is licensed under the MIT License.
 //
 
+#define GLTUT_CHAPTER gltut06c
 #include "Scene.h"
 
 #include <math.h>
@@ -15,12 +16,16 @@
 #include <vector>
 
 #include "debug.h"
+#include "fastmath.h"
 #include "glhelpers.h"
+#include "microbenchmark.h"
 #include "GLFW/glfw3.h"
 
 #include "glm.hpp"
 #include "gtc/type_ptr.hpp"
 
+namespace GLTUT_CHAPTER {
+
 const int numberOfVertices = 8;
 
 #define GREEN_COLOR 0.0f, 1.0f, 0.0f, 1.0f
@@ -79,8 +84,6 @@ float CalcFrustumScale(float fFovDeg)
 
 const float frustumScale = CalcFrustumScale(45.0f);
 
-GLuint indexBufferObject;
-
 float CalcLerpFactor(float fElapsedTime, float fLoopDuration)
 {
 	float fValue = fmodf(fElapsedTime, fLoopDuration) / fLoopDuration;
@@ -90,11 +93,6 @@ float CalcLerpFactor(float fElapsedTime, float fLoopDuration)
 	return fValue * 2.0f;
 }
 
-glm::mat3 NullRotation(float fElapsedTime)
-{
-	return glm::mat3(1.0f);
-}
-
 float ComputeAngleRad(float fElapsedTime, float fLoopDuration)
 {
 	const float fScale = 3.14159f * 2.0f / fLoopDuration;
@@ -102,66 +100,42 @@ float ComputeAngleRad(float fElapsedTime, float fLoopDuration)
 	return fCurrTimeThroughLoop * fScale;
 }
 
-glm::mat3 RotateX(float fElapsedTime)
+// The rotations take the sine and cosine of their angle, which
+// ConstructMatrices() evaluates for every instance in one SinCosArray()
+
+glm::mat3 NullRotation(float fSin, float fCos)
+{
+	return glm::mat3(1.0f);
+}
+
+glm::mat3 RotateX(float fSin, float fCos)
 {
-	float fAngRad = ComputeAngleRad(fElapsedTime, 3.0);
-	float fCos = cosf(fAngRad);
-	float fSin = sinf(fAngRad);
-    
 	glm::mat3 theMat(1.0f);
 	theMat[1].y = fCos; theMat[2].y = -fSin;
 	theMat[1].z = fSin; theMat[2].z = fCos;
 	return theMat;
 }
 
-glm::mat3 RotateY(float fElapsedTime)
+glm::mat3 RotateY(float fSin, float fCos)
 {
-	float fAngRad = ComputeAngleRad(fElapsedTime, 2.0);
-	float fCos = cosf(fAngRad);
-	float fSin = sinf(fAngRad);
-    
 	glm::mat3 theMat(1.0f);
 	theMat[0].x = fCos; theMat[2].x = fSin;
 	theMat[0].z = -fSin; theMat[2].z = fCos;
 	return theMat;
 }
 
-glm::mat3 RotateZ(float fElapsedTime)
+glm::mat3 RotateZ(float fSin, float fCos)
 {
-	float fAngRad = ComputeAngleRad(fElapsedTime, 2.0);
-	float fCos = cosf(fAngRad);
-	float fSin = sinf(fAngRad);
-    
 	glm::mat3 theMat(1.0f);
 	theMat[0].x = fCos; theMat[1].x = -fSin;
 	theMat[0].y = fSin; theMat[1].y = fCos;
 	return theMat;
 }
 
-glm::mat3 RotateAxis(float fElapsedTime)
+glm::mat3 RotateAxis(float fSin, float fCos)
 {
-	float fAngRad = ComputeAngleRad(fElapsedTime, 2.0);
-	float fCos = cosf(fAngRad);
-	float fInvCos = 1.0f - fCos;
-	float fSin = sinf(fAngRad);
-	// float fInvSin = 1.0f - fSin;
-    
 	glm::vec3 axis(1.0f, 1.0f, 1.0f);
-	axis = glm::normalize(axis);
-    
-	glm::mat3 theMat(1.0f);
-	theMat[0].x = (axis.x * axis.x) + ((1 - axis.x * axis.x) * fCos);
-	theMat[1].x = axis.x * axis.y * (fInvCos) - (axis.z * fSin);
-	theMat[2].x = axis.x * axis.z * (fInvCos) + (axis.y * fSin);
-    
-	theMat[0].y = axis.x * axis.y * (fInvCos) + (axis.z * fSin);
-	theMat[1].y = (axis.y * axis.y) + ((1 - axis.y * axis.y) * fCos);
-	theMat[2].y = axis.y * axis.z * (fInvCos) - (axis.x * fSin);
-    
-	theMat[0].z = axis.x * axis.z * (fInvCos) - (axis.y * fSin);
-	theMat[1].z = axis.y * axis.z * (fInvCos) + (axis.x * fSin);
-	theMat[2].z = (axis.z * axis.z) + ((1 - axis.z * axis.z) * fCos);
-	return theMat;
+	return AxisRotation(glm::normalize(axis), fSin, fCos);
 }
 
 glm::vec3 DynamicNonUniformScale(float fElapsedTime)
@@ -176,14 +150,15 @@ glm::vec3 DynamicNonUniformScale(float fElapsedTime)
 
 struct Instance
 {
-	typedef glm::mat3(*RotationFunc)(float);
+	typedef glm::mat3(*RotationFunc)(float, float);
     
 	RotationFunc CalcRotation;
+	float fLoopDuration;
 	glm::vec3 offset;
     
-	glm::mat4 ConstructMatrix(float fElapsedTime)
+	glm::mat4 ConstructMatrix(float fSin, float fCos) const
 	{
-		const glm::mat3 &rotMatrix = CalcRotation(fElapsedTime);
+		const glm::mat3 &rotMatrix = CalcRotation(fSin, fCos);
 		glm::mat4 theMat(rotMatrix);
 		theMat[3] = glm::vec4(offset, 1.0f);
         
@@ -193,20 +168,38 @@ struct Instance
 
 Instance g_instanceList[] =
 {
-	{NullRotation,				glm::vec3(0.0f, 0.0f, -25.0f)},
-	{RotateX,					glm::vec3(-5.0f, -5.0f, -25.0f)},
-	{RotateY,					glm::vec3(-5.0f, 5.0f, -25.0f)},
-	{RotateZ,					glm::vec3(5.0f, 5.0f, -25.0f)},
-	{RotateAxis,				glm::vec3(5.0f, -5.0f, -25.0f)},
+	{NullRotation,		1.0f,	glm::vec3(0.0f, 0.0f, -25.0f)},
+	{RotateX,			3.0f,	glm::vec3(-5.0f, -5.0f, -25.0f)},
+	{RotateY,			2.0f,	glm::vec3(-5.0f, 5.0f, -25.0f)},
+	{RotateZ,			2.0f,	glm::vec3(5.0f, 5.0f, -25.0f)},
+	{RotateAxis,		2.0f,	glm::vec3(5.0f, -5.0f, -25.0f)},
 };
 
+const int instanceCount = ARRAY_COUNT(g_instanceList);
+
+// Every instance's matrix at fElapsedTime, with the sines and cosines of
+// all their angles evaluated in one pass
+void ConstructMatrices(float fElapsedTime, glm::mat4 *matrices)
+{
+	float angles[instanceCount], sines[instanceCount], cosines[instanceCount];
+	for(int iLoop = 0; iLoop < instanceCount; iLoop++)
+	{
+		angles[iLoop] = ComputeAngleRad(fElapsedTime, g_instanceList[iLoop].fLoopDuration);
+	}
+	SinCosArray(angles, sines, cosines, instanceCount);
+	for(int iLoop = 0; iLoop < instanceCount; iLoop++)
+	{
+		matrices[iLoop] = g_instanceList[iLoop].ConstructMatrix(sines[iLoop], cosines[iLoop]);
+	}
+}
+
 Scene::Scene()
 {
 }
 
 void Scene::init()
 {
-    _shaderProgram = createShaderProgramWithFilenames("PosColorLocalTransform.vert", "ColorPassthrough.frag");
+    _shaderProgram.reset(createShaderProgramWithFilenames("PosColorLocalTransform.vert", "ColorPassthrough.frag"));
     glUseProgram(_shaderProgram);
     printOpenGLError();
     
@@ -226,22 +219,20 @@ void Scene::init()
 	glUniformMatrix4fv(cameraToClipMatrixUniform, 1, GL_FALSE, glm::value_ptr(cameraToClipMatrix));
     
     // Vertex buffer objects
-    glGenBuffers(1, &_vertexBufferObject);
+    _vertexBufferObject.create();
     
-	glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
+	_vertexBufferObject.bufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
     
-	glGenBuffers(1, &indexBufferObject);
+	_indexBufferObject.create(GPUIndexData);
     
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferObject);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indexData), indexData, GL_STATIC_DRAW);
+	_indexBufferObject.bufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indexData), indexData, GL_STATIC_DRAW);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     printOpenGLError();
     
     
     // Vertex array objects
-    glGenVertexArrays(1, &_vertexArrayObject);
+    _vertexArrayObject.create();
     glBindVertexArray(_vertexArrayObject);
     
     size_t colorDataOffset = sizeof(float) * 3 * numberOfVertices;
@@ -251,7 +242,7 @@ void Scene::init()
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
     glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, (void*)colorDataOffset);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferObject);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBufferObject);
     
     glBindVertexArray(0);
     printOpenGLError();
@@ -271,9 +262,6 @@ void Scene::init()
 
 Scene::~Scene()
 {
-    glDeleteProgram(_shaderProgram);
-    glDeleteBuffers(1, &_vertexBufferObject);
-    printOpenGLError();
 }
 
 void Scene::reshape(int width, int height)
@@ -281,9 +269,7 @@ void Scene::reshape(int width, int height)
     cameraToClipMatrix[0].x = frustumScale / (width / (float)height);
     cameraToClipMatrix[1].y = frustumScale;
     
-    glUniformMatrix4fv(cameraToClipMatrixUniform, 1, GL_FALSE, glm::value_ptr(cameraToClipMatrix));
-    
-    this->draw();
+    glUniformMatrix4fv(cameraToClipMatrixUniform, 1, GL_FALSE, glm::value_ptr(clipTile() * cameraToClipMatrix));
 }
 
 void Scene::draw()
@@ -294,19 +280,47 @@ void Scene::draw()
     
 	glBindVertexArray(_vertexArrayObject);
     
-	float fElapsedTime = glfwGetTime();
-	for(int iLoop = 0; iLoop < ARRAY_COUNT(g_instanceList); iLoop++)
+	glm::mat4 transformMatrices[instanceCount];
+	ConstructMatrices(elapsedTime(), transformMatrices);
+
+	for(int iLoop = 0; iLoop < instanceCount; iLoop++)
 	{
-		Instance &currInst = g_instanceList[iLoop];
-		const glm::mat4 &transformMatrix = currInst.ConstructMatrix(fElapsedTime);
-        
-		glUniformMatrix4fv(modelToCameraMatrixUniform, 1, GL_FALSE, glm::value_ptr(transformMatrix));
+		glUniformMatrix4fv(modelToCameraMatrixUniform, 1, GL_FALSE, glm::value_ptr(transformMatrices[iLoop]));
 		glDrawElements(GL_TRIANGLES, ARRAY_COUNT(indexData), GL_UNSIGNED_SHORT, 0);
 	}
     
 	glBindVertexArray(0);
 }
 
+bool Scene::isAnimated()
+{
+    return true;
+}
+
 void Scene::keyStateChanged(int key, int action)
 {
-}
\ No newline at end of file
+}
+
+REGISTER_MICROBENCHMARK("06c RotateAxis", [](int iterations) {
+	for(int iIteration = 0; iIteration < iterations; iIteration++)
+	{
+		float fCos, fSin;
+		SinCos(ComputeAngleRad(iIteration * 0.001f, 2.0f), fSin, fCos);
+		const glm::mat3 &rotMatrix = RotateAxis(fSin, fCos);
+		DoNotOptimize(rotMatrix);
+	}
+});
+
+// All five instances, as draw() builds them every frame
+REGISTER_MICROBENCHMARK("06c ConstructMatrices", [](int iterations) {
+	glm::mat4 transformMatrices[instanceCount];
+	for(int iIteration = 0; iIteration < iterations; iIteration++)
+	{
+		ConstructMatrices(iIteration * 0.001f, transformMatrices);
+		DoNotOptimize(transformMatrices);
+	}
+});
+
+REGISTER_SCENE("gltut 06c");
+
+}
@@ -0,0 +1,30 @@
+#version 330
+
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec4 color;
+
+smooth out vec4 theColor;
+
+layout(std140) uniform MultiView
+{
+	mat4 cameraToClipMatrices[16];
+	vec4 viewportTransforms[16];
+};
+
+uniform mat4 modelToCameraMatrix;
+
+void main()
+{
+	vec4 cameraPos = modelToCameraMatrix * position;
+	vec4 clipPos = cameraToClipMatrices[gl_InstanceID] * cameraPos;
+
+	// Clip against this view's frustum before moving it into its tile
+	gl_ClipDistance[0] = clipPos.w + clipPos.x;
+	gl_ClipDistance[1] = clipPos.w - clipPos.x;
+	gl_ClipDistance[2] = clipPos.w + clipPos.y;
+	gl_ClipDistance[3] = clipPos.w - clipPos.y;
+
+	vec4 tile = viewportTransforms[gl_InstanceID];
+	gl_Position = vec4(clipPos.xy * tile.xy + tile.zw * clipPos.w, clipPos.zw);
+	theColor = color;
+}
@@ -8,6 +8,7 @@
 // This file is licensed under the MIT License.
 //
 
+#define GLTUT_CHAPTER gltut06d
 #include "Scene.h"
 
 #include <math.h>
@@ -16,11 +17,29 @@
 #include <stack>
 
 #include "debug.h"
+#include "fastmath.h"
 #include "glhelpers.h"
+#include "drawstrategy.h"
+#include "microbenchmark.h"
+#include "multiview.h"
+#include "occlusion.h"
 #include "GLFW/glfw3.h"
 
 #include "glm.hpp"
 #include "gtc/type_ptr.hpp"
+// gtx/simd_mat4 needs glm's SSE2 path and a compiler glm knows how to align
+// for. With GCC, GLM_ARCH expands to defined(), which #if cannot evaluate
+// portably, so this makes the same choice from the macros glm looks at.
+#if !defined(GLM_FORCE_PURE) && \
+    (defined(GLM_FORCE_SSE2) || defined(GLM_FORCE_SSE3) || defined(GLM_FORCE_SSE4) || \
+     defined(GLM_FORCE_AVX) || defined(GLM_FORCE_AVX2) || \
+     (!defined(__clang__) && !defined(__APPLE__) && defined(__SSE2__))) && \
+    ((GLM_COMPILER & GLM_COMPILER_CLANG) || (GLM_COMPILER >= GLM_COMPILER_GCC31))
+#define GLTUT_SIMD_MAT4
+#include "gtx/simd_mat4.hpp"
+#endif
+
+namespace GLTUT_CHAPTER {
 
 GLuint positionAttribute;
 GLuint colorAttribute;
@@ -140,13 +159,15 @@ const GLshort indexData[] =
 	22, 23, 20,
 };
 
-GLuint indexBufferObject;
+// Multi-view mode draws every part once per camera with a single instanced
+// call, into a grid of tiles
+GLuint multiViewModelToCameraMatrixUniform;
 
-inline float DegToRad(float fAngDeg)
-{
-	const float fDegToRad = 3.14159f * 2.0f / 360.0f;
-	return fAngDeg * fDegToRad;
-}
+// The extra cameras orbit the armature base
+const glm::vec3 multiViewOrbitCenter(3.0f, -5.0f, -40.0f);
+
+// The wrist and fingers are drawn only when their bounding box is visible
+enum OccludableSubtree { WristSubtree };
 
 inline float Clamp(float fValue, float fMinValue, float fMaxValue)
 {
@@ -159,42 +180,51 @@ inline float Clamp(float fValue, float fMinValue, float fMaxValue)
 	return fValue;
 }
 
-glm::mat3 RotateX(float fAngDeg)
+glm::mat3 RotateX(float fSin, float fCos)
 {
-	float fAngRad = DegToRad(fAngDeg);
-	float fCos = cosf(fAngRad);
-	float fSin = sinf(fAngRad);
-    
 	glm::mat3 theMat(1.0f);
 	theMat[1].y = fCos; theMat[2].y = -fSin;
 	theMat[1].z = fSin; theMat[2].z = fCos;
 	return theMat;
 }
 
-glm::mat3 RotateY(float fAngDeg)
+glm::mat3 RotateX(float fAngDeg)
+{
+	float fCos, fSin;
+	SinCosDeg(fAngDeg, fSin, fCos);
+	return RotateX(fSin, fCos);
+}
+
+glm::mat3 RotateY(float fSin, float fCos)
 {
-	float fAngRad = DegToRad(fAngDeg);
-	float fCos = cosf(fAngRad);
-	float fSin = sinf(fAngRad);
-    
 	glm::mat3 theMat(1.0f);
 	theMat[0].x = fCos; theMat[2].x = fSin;
 	theMat[0].z = -fSin; theMat[2].z = fCos;
 	return theMat;
 }
 
-glm::mat3 RotateZ(float fAngDeg)
+glm::mat3 RotateY(float fAngDeg)
+{
+	float fCos, fSin;
+	SinCosDeg(fAngDeg, fSin, fCos);
+	return RotateY(fSin, fCos);
+}
+
+glm::mat3 RotateZ(float fSin, float fCos)
 {
-	float fAngRad = DegToRad(fAngDeg);
-	float fCos = cosf(fAngRad);
-	float fSin = sinf(fAngRad);
-    
 	glm::mat3 theMat(1.0f);
 	theMat[0].x = fCos; theMat[1].x = -fSin;
 	theMat[0].y = fSin; theMat[1].y = fCos;
 	return theMat;
 }
 
+glm::mat3 RotateZ(float fAngDeg)
+{
+	float fCos, fSin;
+	SinCosDeg(fAngDeg, fSin, fCos);
+	return RotateZ(fSin, fCos);
+}
+
 class MatrixStack
 {
 public:
@@ -210,17 +240,32 @@ public:
     
 	void RotateX(float fAngDeg)
 	{
-		m_currMat = m_currMat * glm::mat4(::RotateX(fAngDeg));
+		m_currMat = m_currMat * glm::mat4(GLTUT_CHAPTER::RotateX(fAngDeg));
+	}
+    
+	void RotateX(float fSin, float fCos)
+	{
+		m_currMat = m_currMat * glm::mat4(GLTUT_CHAPTER::RotateX(fSin, fCos));
 	}
     
 	void RotateY(float fAngDeg)
 	{
-		m_currMat = m_currMat * glm::mat4(::RotateY(fAngDeg));
+		m_currMat = m_currMat * glm::mat4(GLTUT_CHAPTER::RotateY(fAngDeg));
+	}
+    
+	void RotateY(float fSin, float fCos)
+	{
+		m_currMat = m_currMat * glm::mat4(GLTUT_CHAPTER::RotateY(fSin, fCos));
 	}
     
 	void RotateZ(float fAngDeg)
 	{
-		m_currMat = m_currMat * glm::mat4(::RotateZ(fAngDeg));
+		m_currMat = m_currMat * glm::mat4(GLTUT_CHAPTER::RotateZ(fAngDeg));
+	}
+    
+	void RotateZ(float fSin, float fCos)
+	{
+		m_currMat = m_currMat * glm::mat4(GLTUT_CHAPTER::RotateZ(fSin, fCos));
 	}
     
 	void Scale(const glm::vec3 &scaleVec)
@@ -283,25 +328,34 @@ public:
     , lenFinger(2.0f)
     , widthFinger(0.5f)
     , angLowerFinger(45.0f)
+    , m_occlusion(NULL)
+    , m_multiView(NULL)
+    , m_modelToCameraUniform(0)
 	{}
     
-	void Draw()
+	// multiView is NULL for a single view; every part is drawn through
+	// the given culler and model to camera uniform
+	void Draw(OcclusionCuller &occlusion, MultiViewRenderer *multiView, GLuint modelToCameraUniform)
 	{
+		m_occlusion = &occlusion;
+		m_multiView = multiView;
+		m_modelToCameraUniform = modelToCameraUniform;
+		EvaluateJointAngles();
 		MatrixStack modelToCameraStack;
         
 		// glUseProgram(theProgram);
 		// glBindVertexArray(vao);
         
 		modelToCameraStack.Translate(posBase);
-		modelToCameraStack.RotateY(angBase);
+		RotateJoint(modelToCameraStack, JointBase);
         
 		//Draw left base.
 		{
 			modelToCameraStack.Push();
 			modelToCameraStack.Translate(posBaseLeft);
 			modelToCameraStack.Scale(glm::vec3(1.0f, 1.0f, scaleBaseZ));
-			glUniformMatrix4fv(modelToCameraMatrixUniform, 1, GL_FALSE, glm::value_ptr(modelToCameraStack.Top()));
-			glDrawElements(GL_TRIANGLES, ARRAY_COUNT(indexData), GL_UNSIGNED_SHORT, 0);
+			glUniformMatrix4fv(m_modelToCameraUniform, 1, GL_FALSE, glm::value_ptr(modelToCameraStack.Top()));
+			DrawCube();
 			modelToCameraStack.Pop();
 		}
         
@@ -310,8 +364,8 @@ public:
 			modelToCameraStack.Push();
 			modelToCameraStack.Translate(posBaseRight);
 			modelToCameraStack.Scale(glm::vec3(1.0f, 1.0f, scaleBaseZ));
-			glUniformMatrix4fv(modelToCameraMatrixUniform, 1, GL_FALSE, glm::value_ptr(modelToCameraStack.Top()));
-			glDrawElements(GL_TRIANGLES, ARRAY_COUNT(indexData), GL_UNSIGNED_SHORT, 0);
+			glUniformMatrix4fv(m_modelToCameraUniform, 1, GL_FALSE, glm::value_ptr(modelToCameraStack.Top()));
+			DrawCube();
 			modelToCameraStack.Pop();
 		}
         
@@ -373,31 +427,78 @@ public:
 	}
     
 private:
+	enum JointAngle
+	{
+		JointBase,
+		JointUpperArm,
+		JointLowerArm,
+		JointWristRoll,
+		JointWristPitch,
+		JointFingerOpen,
+		JointLowerFinger,
+		JointAngleCount
+	};
+    
+	// The sines and cosines of every joint angle for this Draw(), in one
+	// SinCosDegArray() rather than one SinCosDeg() per rotation
+	void EvaluateJointAngles()
+	{
+		const float angles[JointAngleCount] = { angBase, angUpperArm, angLowerArm, angWristRoll, angWristPitch,
+		                                        angFingerOpen, angLowerFinger };
+		SinCosDegArray(angles, m_jointSin, m_jointCos, JointAngleCount);
+	}
+    
+	// sign -1 turns the other way, as the right-hand fingers do
+	void RotateJoint(MatrixStack &modelToCameraStack, JointAngle joint, float sign = 1.0f)
+	{
+		static const int axes[JointAngleCount] = { 1, 0, 0, 2, 0, 1, 1 };
+		float fSin = sign * m_jointSin[joint];
+		float fCos = m_jointCos[joint];
+		switch (axes[joint])
+		{
+			case 0: modelToCameraStack.RotateX(fSin, fCos); break;
+			case 1: modelToCameraStack.RotateY(fSin, fCos); break;
+			default: modelToCameraStack.RotateZ(fSin, fCos); break;
+		}
+	}
+    
+	void DrawCube()
+	{
+		if (m_multiView != NULL)
+		{
+			m_multiView->drawElements(GL_TRIANGLES, ARRAY_COUNT(indexData), GL_UNSIGNED_SHORT, 0);
+		}
+		else
+		{
+			glDrawElements(GL_TRIANGLES, ARRAY_COUNT(indexData), GL_UNSIGNED_SHORT, 0);
+		}
+	}
+    
 	void DrawFingers(MatrixStack &modelToCameraStack)
 	{
 		//Draw left finger
 		modelToCameraStack.Push();
 		modelToCameraStack.Translate(posLeftFinger);
-		modelToCameraStack.RotateY(angFingerOpen);
+		RotateJoint(modelToCameraStack, JointFingerOpen);
         
 		modelToCameraStack.Push();
 		modelToCameraStack.Translate(glm::vec3(0.0f, 0.0f, lenFinger / 2.0f));
 		modelToCameraStack.Scale(glm::vec3(widthFinger / 2.0f, widthFinger/ 2.0f, lenFinger / 2.0f));
-		glUniformMatrix4fv(modelToCameraMatrixUniform, 1, GL_FALSE, glm::value_ptr(modelToCameraStack.Top()));
-		glDrawElements(GL_TRIANGLES, ARRAY_COUNT(indexData), GL_UNSIGNED_SHORT, 0);
+		glUniformMatrix4fv(m_modelToCameraUniform, 1, GL_FALSE, glm::value_ptr(modelToCameraStack.Top()));
+		DrawCube();
 		modelToCameraStack.Pop();
         
 		{
 			//Draw left lower finger
 			modelToCameraStack.Push();
 			modelToCameraStack.Translate(glm::vec3(0.0f, 0.0f, lenFinger));
-			modelToCameraStack.RotateY(-angLowerFinger);
+			RotateJoint(modelToCameraStack, JointLowerFinger, -1.0f);
             
 			modelToCameraStack.Push();
 			modelToCameraStack.Translate(glm::vec3(0.0f, 0.0f, lenFinger / 2.0f));
 			modelToCameraStack.Scale(glm::vec3(widthFinger / 2.0f, widthFinger/ 2.0f, lenFinger / 2.0f));
-			glUniformMatrix4fv(modelToCameraMatrixUniform, 1, GL_FALSE, glm::value_ptr(modelToCameraStack.Top()));
-			glDrawElements(GL_TRIANGLES, ARRAY_COUNT(indexData), GL_UNSIGNED_SHORT, 0);
+			glUniformMatrix4fv(m_modelToCameraUniform, 1, GL_FALSE, glm::value_ptr(modelToCameraStack.Top()));
+			DrawCube();
 			modelToCameraStack.Pop();
             
 			modelToCameraStack.Pop();
@@ -408,26 +509,26 @@ private:
 		//Draw right finger
 		modelToCameraStack.Push();
 		modelToCameraStack.Translate(posRightFinger);
-		modelToCameraStack.RotateY(-angFingerOpen);
+		RotateJoint(modelToCameraStack, JointFingerOpen, -1.0f);
         
 		modelToCameraStack.Push();
 		modelToCameraStack.Translate(glm::vec3(0.0f, 0.0f, lenFinger / 2.0f));
 		modelToCameraStack.Scale(glm::vec3(widthFinger / 2.0f, widthFinger/ 2.0f, lenFinger / 2.0f));
-		glUniformMatrix4fv(modelToCameraMatrixUniform, 1, GL_FALSE, glm::value_ptr(modelToCameraStack.Top()));
-		glDrawElements(GL_TRIANGLES, ARRAY_COUNT(indexData), GL_UNSIGNED_SHORT, 0);
+		glUniformMatrix4fv(m_modelToCameraUniform, 1, GL_FALSE, glm::value_ptr(modelToCameraStack.Top()));
+		DrawCube();
 		modelToCameraStack.Pop();
         
 		{
 			//Draw right lower finger
 			modelToCameraStack.Push();
 			modelToCameraStack.Translate(glm::vec3(0.0f, 0.0f, lenFinger));
-			modelToCameraStack.RotateY(angLowerFinger);
+			RotateJoint(modelToCameraStack, JointLowerFinger);
             
 			modelToCameraStack.Push();
 			modelToCameraStack.Translate(glm::vec3(0.0f, 0.0f, lenFinger / 2.0f));
 			modelToCameraStack.Scale(glm::vec3(widthFinger / 2.0f, widthFinger/ 2.0f, lenFinger / 2.0f));
-			glUniformMatrix4fv(modelToCameraMatrixUniform, 1, GL_FALSE, glm::value_ptr(modelToCameraStack.Top()));
-			glDrawElements(GL_TRIANGLES, ARRAY_COUNT(indexData), GL_UNSIGNED_SHORT, 0);
+			glUniformMatrix4fv(m_modelToCameraUniform, 1, GL_FALSE, glm::value_ptr(modelToCameraStack.Top()));
+			DrawCube();
 			modelToCameraStack.Pop();
             
 			modelToCameraStack.Pop();
@@ -440,13 +541,13 @@ private:
 	{
 		modelToCameraStack.Push();
 		modelToCameraStack.Translate(posWrist);
-		modelToCameraStack.RotateZ(angWristRoll);
-		modelToCameraStack.RotateX(angWristPitch);
+		RotateJoint(modelToCameraStack, JointWristRoll);
+		RotateJoint(modelToCameraStack, JointWristPitch);
         
 		modelToCameraStack.Push();
 		modelToCameraStack.Scale(glm::vec3(widthWrist / 2.0f, widthWrist/ 2.0f, lenWrist / 2.0f));
-		glUniformMatrix4fv(modelToCameraMatrixUniform, 1, GL_FALSE, glm::value_ptr(modelToCameraStack.Top()));
-		glDrawElements(GL_TRIANGLES, ARRAY_COUNT(indexData), GL_UNSIGNED_SHORT, 0);
+		glUniformMatrix4fv(m_modelToCameraUniform, 1, GL_FALSE, glm::value_ptr(modelToCameraStack.Top()));
+		DrawCube();
 		modelToCameraStack.Pop();
         
 		DrawFingers(modelToCameraStack);
@@ -458,31 +559,48 @@ private:
 	{
 		modelToCameraStack.Push();
 		modelToCameraStack.Translate(posLowerArm);
-		modelToCameraStack.RotateX(angLowerArm);
+		RotateJoint(modelToCameraStack, JointLowerArm);
         
 		modelToCameraStack.Push();
 		modelToCameraStack.Translate(glm::vec3(0.0f, 0.0f, lenLowerArm / 2.0f));
 		modelToCameraStack.Scale(glm::vec3(widthLowerArm / 2.0f, widthLowerArm / 2.0f, lenLowerArm / 2.0f));
-		glUniformMatrix4fv(modelToCameraMatrixUniform, 1, GL_FALSE, glm::value_ptr(modelToCameraStack.Top()));
-		glDrawElements(GL_TRIANGLES, ARRAY_COUNT(indexData), GL_UNSIGNED_SHORT, 0);
+		glUniformMatrix4fv(m_modelToCameraUniform, 1, GL_FALSE, glm::value_ptr(modelToCameraStack.Top()));
+		DrawCube();
 		modelToCameraStack.Pop();
         
-		DrawWrist(modelToCameraStack);
+		if (m_occlusion->beginObject(WristSubtree, [&]() { DrawWristBounds(modelToCameraStack); }))
+		{
+			DrawWrist(modelToCameraStack);
+		}
+		m_occlusion->endObject(WristSubtree);
+        
+		modelToCameraStack.Pop();
+	}
+    
+	void DrawWristBounds(MatrixStack &modelToCameraStack)
+	{
+		// Box around the wrist joint that contains the fingers at any pose
+		float fReach = glm::length(posLeftFinger) + 2.0f * lenFinger + widthFinger;
         
+		modelToCameraStack.Push();
+		modelToCameraStack.Translate(posWrist);
+		modelToCameraStack.Scale(glm::vec3(fReach));
+		glUniformMatrix4fv(m_modelToCameraUniform, 1, GL_FALSE, glm::value_ptr(modelToCameraStack.Top()));
+		DrawCube();
 		modelToCameraStack.Pop();
 	}
     
 	void DrawUpperArm(MatrixStack &modelToCameraStack)
 	{
 		modelToCameraStack.Push();
-		modelToCameraStack.RotateX(angUpperArm);
+		RotateJoint(modelToCameraStack, JointUpperArm);
         
 		{
 			modelToCameraStack.Push();
 			modelToCameraStack.Translate(glm::vec3(0.0f, 0.0f, (sizeUpperArm / 2.0f) - 1.0f));
 			modelToCameraStack.Scale(glm::vec3(1.0f, 1.0f, sizeUpperArm / 2.0f));
-			glUniformMatrix4fv(modelToCameraMatrixUniform, 1, GL_FALSE, glm::value_ptr(modelToCameraStack.Top()));
-			glDrawElements(GL_TRIANGLES, ARRAY_COUNT(indexData), GL_UNSIGNED_SHORT, 0);
+			glUniformMatrix4fv(m_modelToCameraUniform, 1, GL_FALSE, glm::value_ptr(modelToCameraStack.Top()));
+			DrawCube();
 			modelToCameraStack.Pop();
 		}
         
@@ -518,10 +636,48 @@ private:
 	float			lenFinger;
 	float			widthFinger;
 	float			angLowerFinger;
+    
+	OcclusionCuller		*m_occlusion;
+	MultiViewRenderer	*m_multiView;
+	GLuint				m_modelToCameraUniform;
+	float				m_jointSin[JointAngleCount];
+	float				m_jointCos[JointAngleCount];
 };
 
 
-Hierarchy g_armature;
+// Everything that holds GL objects or per-instance state, so each offline
+// context gets its own
+struct Scene::ChapterState
+{
+	MultiViewRenderer multiView;
+	bool multiViewEnabled = false;
+	GLProgram multiViewProgram;
+	OcclusionCuller occlusion;
+	Hierarchy armature;
+};
+
+// View 0 is the regular camera, the others are spread evenly around the armature
+void UpdateMultiViewCameras(MultiViewRenderer &multiView)
+{
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	
+	glm::mat4 tileCameraToClipMatrix = cameraToClipMatrix;
+	tileCameraToClipMatrix[0].x = frustumScale / multiView.tileAspectRatio(viewport[2], viewport[3]);
+	
+	int viewCount = multiView.viewCount();
+	std::vector<glm::mat4> cameraToClipMatrices(viewCount);
+	for (int iView = 0; iView < viewCount; iView++)
+	{
+		glm::mat4 orbit(1.0f);
+		orbit[3] = glm::vec4(multiViewOrbitCenter, 1.0f);
+		orbit = orbit * glm::mat4(RotateY(360.0f * iView / viewCount));
+		orbit[3] -= orbit * glm::vec4(multiViewOrbitCenter, 0.0f);
+		
+		cameraToClipMatrices[iView] = tileCameraToClipMatrix * orbit;
+	}
+	multiView.setCameraToClipMatrices(cameraToClipMatrices);
+}
 
 Scene::Scene()
 {
@@ -529,7 +685,7 @@ Scene::Scene()
 
 void Scene::init()
 {
-    _shaderProgram = createShaderProgramWithFilenames("PosColorLocalTransform.vert", "ColorPassthrough.frag");
+    _shaderProgram.reset(createShaderProgramWithFilenames("PosColorLocalTransform.vert", "ColorPassthrough.frag"));
     glUseProgram(_shaderProgram);
     printOpenGLError();
     
@@ -538,6 +694,16 @@ void Scene::init()
 	cameraToClipMatrixUniform = glGetUniformLocation(_shaderProgram, "cameraToClipMatrix");
     printOpenGLError();
 
+    // Multi-view program, sharing attribute locations with the main one
+    _state = new ChapterState();
+    GLProgram &multiViewProgram = _state->multiViewProgram;
+    multiViewProgram.reset(createShaderProgramWithFilenames("PosColorMultiView.vert", "ColorPassthrough.frag"));
+	multiViewModelToCameraMatrixUniform = glGetUniformLocation(multiViewProgram, "modelToCameraMatrix");
+	_state->multiView.init(multiViewProgram);
+	_state->multiView.setViewCount(4);
+	glUseProgram(_shaderProgram);
+    printOpenGLError();
+
     // Attributes
     positionAttribute = glGetAttribLocation(_shaderProgram, "position");
 	colorAttribute = glGetAttribLocation(_shaderProgram, "color");
@@ -555,22 +721,20 @@ void Scene::init()
 	glUniformMatrix4fv(cameraToClipMatrixUniform, 1, GL_FALSE, glm::value_ptr(cameraToClipMatrix));
     
     // Vertex buffer objects
-    glGenBuffers(1, &_vertexBufferObject);
+    _vertexBufferObject.create();
     
-	glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
+	_vertexBufferObject.bufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
     
-	glGenBuffers(1, &indexBufferObject);
+	_indexBufferObject.create(GPUIndexData);
     
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferObject);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indexData), indexData, GL_STATIC_DRAW);
+	_indexBufferObject.bufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indexData), indexData, GL_STATIC_DRAW);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     printOpenGLError();
     
     
     // Vertex array objects
-    glGenVertexArrays(1, &_vertexArrayObject);
+    _vertexArrayObject.create();
     glBindVertexArray(_vertexArrayObject);
     printOpenGLError();
 
@@ -584,7 +748,7 @@ void Scene::init()
 	glVertexAttribPointer(positionAttribute, 3, GL_FLOAT, GL_FALSE, 0, 0);
     printOpenGLError();
 	glVertexAttribPointer(colorAttribute, 4, GL_FLOAT, GL_FALSE, 0, (void*)colorDataOffset);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferObject);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBufferObject);
     // glBindVertexArray(0);
     printOpenGLError();
     
@@ -603,9 +767,7 @@ void Scene::init()
 
 Scene::~Scene()
 {
-    glDeleteProgram(_shaderProgram);
-    glDeleteBuffers(1, &_vertexBufferObject);
-    printOpenGLError();
+    delete _state;
 }
 
 void Scene::reshape(int width, int height)
@@ -613,9 +775,11 @@ void Scene::reshape(int width, int height)
     cameraToClipMatrix[0].x = frustumScale / (width / (float)height);
     cameraToClipMatrix[1].y = frustumScale;
     
-    glUniformMatrix4fv(cameraToClipMatrixUniform, 1, GL_FALSE, glm::value_ptr(cameraToClipMatrix));
-    
-    this->draw();
+    glUniformMatrix4fv(cameraToClipMatrixUniform, 1, GL_FALSE, glm::value_ptr(clipTile() * cameraToClipMatrix));
+
+    // Visibility measured through the old projection says nothing about the
+    // new one; poster tiles in particular each see a different part of the scene
+    _state->occlusion.resetHistory();
 }
 
 void Scene::draw()
@@ -624,27 +788,187 @@ void Scene::draw()
 	glClearDepth(1.0f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	g_armature.Draw();
+	_state->occlusion.beginFrame();
+
+	if (_state->multiViewEnabled)
+	{
+		glUseProgram(_state->multiViewProgram);
+		UpdateMultiViewCameras(_state->multiView);
+		
+		_state->multiView.beginPass();
+		_state->armature.Draw(_state->occlusion, &_state->multiView, multiViewModelToCameraMatrixUniform);
+		_state->multiView.endPass();
+		
+		glUseProgram(_shaderProgram);
+	}
+	else
+	{
+		_state->armature.Draw(_state->occlusion, NULL, modelToCameraMatrixUniform);
+	}
+}
+
+bool Scene::isAnimated()
+{
+    return false;
 }
 
 void Scene::keyStateChanged(int key, int action)
 {
+    Hierarchy &armature = _state->armature;
+    MultiViewRenderer &multiView = _state->multiView;
     if ( action == GLFW_PRESS ) {
         switch (key)
         {
-            case GLFW_KEY_A: g_armature.AdjBase(true); break;
-            case GLFW_KEY_D: g_armature.AdjBase(false); break;
-            case GLFW_KEY_W: g_armature.AdjUpperArm(false); break;
-            case GLFW_KEY_S: g_armature.AdjUpperArm(true); break;
-            case GLFW_KEY_R: g_armature.AdjLowerArm(false); break;
-            case GLFW_KEY_F: g_armature.AdjLowerArm(true); break;
-            case GLFW_KEY_T: g_armature.AdjWristPitch(false); break;
-            case GLFW_KEY_G: g_armature.AdjWristPitch(true); break;
-            case GLFW_KEY_Z: g_armature.AdjWristRoll(true); break;
-            case GLFW_KEY_C: g_armature.AdjWristRoll(false); break;
-            case GLFW_KEY_Q: g_armature.AdjFingerOpen(true); break;
-            case GLFW_KEY_E: g_armature.AdjFingerOpen(false); break;
-            case GLFW_KEY_ENTER: g_armature.WritePose(); break;
+            case GLFW_KEY_A: armature.AdjBase(true); break;
+            case GLFW_KEY_D: armature.AdjBase(false); break;
+            case GLFW_KEY_W: armature.AdjUpperArm(false); break;
+            case GLFW_KEY_S: armature.AdjUpperArm(true); break;
+            case GLFW_KEY_R: armature.AdjLowerArm(false); break;
+            case GLFW_KEY_F: armature.AdjLowerArm(true); break;
+            case GLFW_KEY_T: armature.AdjWristPitch(false); break;
+            case GLFW_KEY_G: armature.AdjWristPitch(true); break;
+            case GLFW_KEY_Z: armature.AdjWristRoll(true); break;
+            case GLFW_KEY_C: armature.AdjWristRoll(false); break;
+            case GLFW_KEY_Q: armature.AdjFingerOpen(true); break;
+            case GLFW_KEY_E: armature.AdjFingerOpen(false); break;
+            case GLFW_KEY_ENTER: armature.WritePose(); break;
+            case GLFW_KEY_O:
+            {
+                const char *policyNames[] = { "disabled", "previous frame", "conditional (no wait)", "conditional (wait)" };
+                OcclusionPolicy policy = (OcclusionPolicy)((_state->occlusion.policy() + 1) % ARRAY_COUNT(policyNames));
+                _state->occlusion.setPolicy(policy);
+                printf("Occlusion culling: %s\n", policyNames[policy]);
+                break;
+            }
+            case GLFW_KEY_V:
+                _state->multiViewEnabled = !_state->multiViewEnabled;
+                printf("Multi-view: %s\n", _state->multiViewEnabled ? "on" : "off");
+                break;
+            case GLFW_KEY_N:
+            {
+                int viewCount = multiView.viewCount() % MultiViewRenderer::maxViews + 1;
+                multiView.setViewCount(viewCount);
+                printf("Multi-view cameras: %d (%dx%d)\n", viewCount, multiView.columns(), multiView.rows());
+                break;
+            }
         }
     }
-}
\ No newline at end of file
+}
+
+// The transforms the armature applies to every part. Translations and
+// scales alternate direction so the stack stays finite however long a
+// benchmark runs; rotations are on the quarter degree grid like the joints'.
+REGISTER_MICROBENCHMARK("06d MatrixStack Push/Pop", [](int iterations) {
+	MatrixStack modelToCameraStack;
+	for(int iIteration = 0; iIteration < iterations; iIteration++)
+	{
+		modelToCameraStack.Push();
+		DoNotOptimize(modelToCameraStack.Top());
+		modelToCameraStack.Pop();
+	}
+	DoNotOptimize(modelToCameraStack.Top());
+});
+
+REGISTER_MICROBENCHMARK("06d MatrixStack Translate", [](int iterations) {
+	MatrixStack modelToCameraStack;
+	for(int iIteration = 0; iIteration < iterations; iIteration++)
+	{
+		modelToCameraStack.Translate(glm::vec3((iIteration & 1) ? 2.0f : -2.0f, 0.0f, 1.0f));
+	}
+	DoNotOptimize(modelToCameraStack.Top());
+});
+
+REGISTER_MICROBENCHMARK("06d MatrixStack Scale", [](int iterations) {
+	MatrixStack modelToCameraStack;
+	for(int iIteration = 0; iIteration < iterations; iIteration++)
+	{
+		float fScale = (iIteration & 1) ? 2.0f : 0.5f;
+		modelToCameraStack.Scale(glm::vec3(1.0f, fScale, fScale));
+	}
+	DoNotOptimize(modelToCameraStack.Top());
+});
+
+REGISTER_MICROBENCHMARK("06d MatrixStack RotateX", [](int iterations) {
+	MatrixStack modelToCameraStack;
+	for(int iIteration = 0; iIteration < iterations; iIteration++)
+	{
+		modelToCameraStack.RotateX((iIteration & 31) * STANDARD_ANGLE_INCREMENT);
+	}
+	DoNotOptimize(modelToCameraStack.Top());
+});
+
+// Off the grid, so the angle goes through SinCos instead of the table
+REGISTER_MICROBENCHMARK("06d RotateX, any angle", [](int iterations) {
+	for(int iIteration = 0; iIteration < iterations; iIteration++)
+	{
+		const glm::mat3 &rotMatrix = RotateX((iIteration & 31) * STANDARD_ANGLE_INCREMENT + 0.1f);
+		DoNotOptimize(rotMatrix);
+	}
+});
+
+REGISTER_MICROBENCHMARK("glm mat4 multiply", [](int iterations) {
+	glm::mat4 currMat(1.0f);
+	glm::mat4 factors[2] = { glm::mat4(RotateX(STANDARD_ANGLE_INCREMENT)), glm::mat4(RotateX(-STANDARD_ANGLE_INCREMENT)) };
+	for(int iIteration = 0; iIteration < iterations; iIteration++)
+	{
+		currMat = currMat * factors[iIteration & 1];
+	}
+	DoNotOptimize(currMat);
+});
+
+// What glUniformMatrix4fv reads from value_ptr
+REGISTER_MICROBENCHMARK("glm mat4 value_ptr copy", [](int iterations) {
+	glm::mat4 currMat(RotateX(STANDARD_ANGLE_INCREMENT));
+	float uniform[16];
+	for(int iIteration = 0; iIteration < iterations; iIteration++)
+	{
+		currMat[3].x = (float)(iIteration & 7);
+		memcpy(uniform, glm::value_ptr(currMat), sizeof(uniform));
+		DoNotOptimize(uniform);
+	}
+});
+
+#ifdef GLTUT_SIMD_MAT4
+// The same work with gtx/simd_mat4, for deciding whether MatrixStack should
+// keep its matrices in SSE registers. The stack would have to convert back
+// to a mat4 for every upload, which the value_ptr variant includes. glm
+// turns SSE2 on by itself only for GCC; the Xcode targets that build this
+// file define GLM_FORCE_SSE2 for clang.
+REGISTER_MICROBENCHMARK("glm mat4 multiply, simd_mat4", [](int iterations) {
+	glm::simdMat4 currMat(glm::mat4(1.0f));
+	glm::simdMat4 factors[2] = { glm::simdMat4(glm::mat4(RotateX(STANDARD_ANGLE_INCREMENT))),
+		glm::simdMat4(glm::mat4(RotateX(-STANDARD_ANGLE_INCREMENT))) };
+	for(int iIteration = 0; iIteration < iterations; iIteration++)
+	{
+		currMat = currMat * factors[iIteration & 1];
+	}
+	DoNotOptimize(currMat);
+});
+
+REGISTER_MICROBENCHMARK("glm mat4 value_ptr copy, simd_mat4", [](int iterations) {
+	glm::simdMat4 currMat(glm::mat4(RotateX(STANDARD_ANGLE_INCREMENT)));
+	float uniform[16];
+	for(int iIteration = 0; iIteration < iterations; iIteration++)
+	{
+		currMat[3] = glm::simdVec4((float)(iIteration & 7), 0.0f, 0.0f, 1.0f);
+		memcpy(uniform, glm::value_ptr(glm::mat4_cast(currMat)), sizeof(uniform));
+		DoNotOptimize(uniform);
+	}
+});
+
+REGISTER_MICROBENCHMARK("06d MatrixStack RotateX, simd_mat4", [](int iterations) {
+	glm::simdMat4 currMat(glm::mat4(1.0f));
+	for(int iIteration = 0; iIteration < iterations; iIteration++)
+	{
+		currMat = currMat * glm::simdMat4(glm::mat4(RotateX((iIteration & 31) * STANDARD_ANGLE_INCREMENT)));
+	}
+	DoNotOptimize(currMat);
+});
+#endif
+
+// The cube every part of the armature is drawn with, for main.cpp --drawbench
+REGISTER_DRAW_BENCHMARK_MESH("gltut 06d", vertexData, numberOfVertices, indexData, ARRAY_COUNT(indexData));
+
+REGISTER_SCENE("gltut 06d");
+
+}
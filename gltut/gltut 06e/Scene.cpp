@@ -0,0 +1,267 @@
+//
+//  Scene.cpp
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+
+#define GLTUT_CHAPTER gltut06e
+#include "Scene.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <sstream>
+
+#include "debug.h"
+#include "glhelpers.h"
+#include "meshgen.h"
+#include "streamingloader.h"
+#include "GLFW/glfw3.h"
+
+#include "glm.hpp"
+#include "gtc/type_ptr.hpp"
+
+namespace GLTUT_CHAPTER {
+
+// The other chapters upload their geometry in init(), before the first
+// frame. Here init() only reads the scene description and queues the
+// meshes. They are generated (or read from .mesh files) on I/O threads
+// and uploaded under a per-frame time budget, so the window is responsive
+// from the first frame and objects pop in as they arrive.
+
+GLuint positionAttribute;
+GLuint colorAttribute;
+
+GLuint modelToCameraMatrixUniform;
+GLuint cameraToClipMatrixUniform;
+
+glm::mat4 cameraToClipMatrix(0.0f);
+
+float CalcFrustumScale(float fFovDeg)
+{
+	const float degToRad = 3.14159f * 2.0f / 360.0f;
+	float fFovRad = fFovDeg * degToRad;
+	return 1.0f / tan(fFovRad / 2.0f);
+}
+
+const float frustumScale = CalcFrustumScale(45.0f);
+
+const char *sceneFilename = "streaming.scene";
+
+struct StreamedObject
+{
+    int meshHandle;
+    glm::vec3 position;
+    float scale;
+};
+
+// The loader starts its I/O threads when constructed, so each scene
+// instance creates its own in init() rather than every binary at startup
+struct Scene::ChapterState
+{
+    StreamingLoader loader;
+    std::vector<StreamedObject> objects;
+    double loadStartTime = 0.0;
+    bool loadReported = false;
+};
+
+bool ParseShapeName(const std::string &name, MeshShape &shape)
+{
+    const char *shapeNames[] = { "box", "prism", "sphere", "cylinder", "torus", "grid" };
+    for (int iShape = 0; iShape < (int)ARRAY_COUNT(shapeNames); iShape++)
+    {
+        if (name == shapeNames[iShape])
+        {
+            shape = (MeshShape)iShape;
+            return true;
+        }
+    }
+    return false;
+}
+
+// One object per line: "<shape> <tessellation> x y z scale" or
+// "file <name.mesh> x y z scale". Lines starting with # are skipped.
+void LoadScene(Scene::ChapterState &state, const std::string &filename)
+{
+    state.loader.clear();
+    state.objects.clear();
+
+    std::istringstream sceneFile(ReadAssetOrThrow(filename));
+    std::string line;
+    while (std::getline(sceneFile, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::istringstream fields(line);
+        std::string kind, source;
+        StreamedObject object;
+        fields >> kind >> source >> object.position.x >> object.position.y >> object.position.z >> object.scale;
+        if (fields.fail())
+        {
+            fprintf(stderr, "Malformed line in %s: %s\n", filename.c_str(), line.c_str());
+            continue;
+        }
+
+        MeshShape shape;
+        if (kind == "file")
+        {
+            object.meshHandle = state.loader.requestFile(source);
+        }
+        else if (ParseShapeName(kind, shape))
+        {
+            int tessellation = atoi(source.c_str());
+            object.meshHandle = state.loader.request([shape, tessellation](Mesh &mesh) {
+                mesh = GenerateShape(shape, tessellation);
+                return true;
+            });
+        }
+        else
+        {
+            fprintf(stderr, "Unknown shape in %s: %s\n", filename.c_str(), kind.c_str());
+            continue;
+        }
+        state.objects.push_back(object);
+    }
+
+    state.loadStartTime = glfwGetTime();
+    state.loadReported = false;
+}
+
+Scene::Scene()
+{
+}
+
+void Scene::init()
+{
+    _shaderProgram.reset(createShaderProgramWithFilenames("PosColorLocalTransform.vert", "ColorPassthrough.frag"));
+    glUseProgram(_shaderProgram);
+    printOpenGLError();
+
+    // Uniforms
+	modelToCameraMatrixUniform = glGetUniformLocation(_shaderProgram, "modelToCameraMatrix");
+	cameraToClipMatrixUniform = glGetUniformLocation(_shaderProgram, "cameraToClipMatrix");
+    printOpenGLError();
+
+    // Attributes
+    positionAttribute = glGetAttribLocation(_shaderProgram, "position");
+	colorAttribute = glGetAttribLocation(_shaderProgram, "color");
+    printOpenGLError();
+
+    // Matrix
+    float fzNear = 1.0f; float fzFar = 200.0f;
+
+	cameraToClipMatrix[0].x = frustumScale;
+	cameraToClipMatrix[1].y = frustumScale;
+	cameraToClipMatrix[2].z = (fzFar + fzNear) / (fzNear - fzFar);
+	cameraToClipMatrix[2].w = -1.0f;
+	cameraToClipMatrix[3].z = (2 * fzFar * fzNear) / (fzNear - fzFar);
+
+	glUniformMatrix4fv(cameraToClipMatrixUniform, 1, GL_FALSE, glm::value_ptr(cameraToClipMatrix));
+
+    // Enable cull facing
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_BACK);
+    glFrontFace(GL_CW);
+    printOpenGLError();
+
+    // Enable depth testing
+    glEnable(GL_DEPTH_TEST);
+	glDepthMask(GL_TRUE);
+	glDepthFunc(GL_LEQUAL);
+	glDepthRange(0.0f, 1.0f);
+
+    // Geometry arrives over the next frames
+    _state = new ChapterState();
+    LoadScene(*_state, sceneFilename);
+}
+
+Scene::~Scene()
+{
+    // Scenes can be switched at runtime; release the streamed meshes with the scene
+    delete _state;
+    printOpenGLError();
+}
+
+void Scene::reshape(int width, int height)
+{
+    cameraToClipMatrix[0].x = frustumScale / (width / (float)height);
+    cameraToClipMatrix[1].y = frustumScale;
+
+    glUniformMatrix4fv(cameraToClipMatrixUniform, 1, GL_FALSE, glm::value_ptr(clipTile() * cameraToClipMatrix));
+}
+
+void Scene::draw()
+{
+    StreamingLoader &loader = _state->loader;
+    loader.update(positionAttribute, colorAttribute);
+    printOpenGLError();
+
+    if (!_state->loadReported && loader.stats().pendingMeshes == 0)
+    {
+        printf("Scene streamed in %.2f s\n", glfwGetTime() - _state->loadStartTime);
+        _state->loadReported = true;
+    }
+
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClearDepth(1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glUseProgram(_shaderProgram);
+    for (size_t iObject = 0; iObject < _state->objects.size(); iObject++)
+    {
+        const StreamedObject &object = _state->objects[iObject];
+        if (!loader.isReady(object.meshHandle))
+            continue;
+
+        glm::mat4 modelToCameraMatrix(object.scale);
+        modelToCameraMatrix[3] = glm::vec4(object.position, 1.0f);
+        glUniformMatrix4fv(modelToCameraMatrixUniform, 1, GL_FALSE, glm::value_ptr(modelToCameraMatrix));
+        loader.buffers(object.meshHandle).draw();
+    }
+    glBindVertexArray(0);
+    printOpenGLError();
+}
+
+bool Scene::isAnimated()
+{
+    // Keep drawing while meshes are still arriving
+    return !_state->loadReported;
+}
+
+void Scene::keyStateChanged(int key, int action)
+{
+    StreamingLoader &loader = _state->loader;
+    if ( action == GLFW_PRESS ) {
+        switch (key)
+        {
+            case GLFW_KEY_R:
+                LoadScene(*_state, sceneFilename);
+                break;
+            case GLFW_KEY_EQUAL:
+                loader.setUploadBudget(loader.uploadBudget() * 2.0);
+                printf("Upload budget: %.2f ms\n", loader.uploadBudget());
+                break;
+            case GLFW_KEY_MINUS:
+                loader.setUploadBudget(loader.uploadBudget() * 0.5);
+                printf("Upload budget: %.2f ms\n", loader.uploadBudget());
+                break;
+            case GLFW_KEY_ENTER:
+            {
+                const StreamingStats &stats = loader.stats();
+                printf("Meshes pending: %d of %d, last frame uploaded %.1f KB in %.2f ms\n",
+                       stats.pendingMeshes, loader.meshCount(),
+                       stats.bytesUploaded / 1024.0, stats.uploadTime * 1000.0);
+                break;
+            }
+        }
+    }
+}
+
+REGISTER_SCENE("gltut 06e");
+
+}
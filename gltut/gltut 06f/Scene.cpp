@@ -0,0 +1,376 @@
+//
+//  Scene.cpp
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+
+#define GLTUT_CHAPTER gltut06f
+#include "Scene.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "debug.h"
+#include "glhelpers.h"
+#include "jobsystem.h"
+#include "meshgen.h"
+#include "stressscene.h"
+#include "GLFW/glfw3.h"
+
+#include "glm.hpp"
+#include "gtc/type_ptr.hpp"
+
+namespace GLTUT_CHAPTER {
+
+// A generated scene for scaling tests (stressscene.h). stress.scene holds
+// the parameters and the keys change them at runtime, so a benchrunner
+// sweep can walk a scaling curve with its key sets (06f ... HH,H,-,=,==,
+// where - is benchrunner's empty set):
+//
+//  N       next seed
+//  = / H   double / halve the object count
+//  ] / [   double / halve the triangles per object
+//  D / S   one more / one less overdraw layer
+//  A       cycle the animated fraction through 0, 25, 50, 75 and 100%
+//  L       level of detail on / off
+//  Enter   print the scene's size
+//
+// Every instance mesh is built as a MeshLodChain. With level of detail on,
+// each instance draws the level SelectLod() picks from its projected size,
+// so halving the object count, which doubles the objects' size on screen,
+// moves them to finer levels.
+
+GLuint positionAttribute;
+GLuint colorAttribute;
+
+GLuint modelToCameraMatrixUniform;
+GLuint cameraToClipMatrixUniform;
+
+glm::mat4 cameraToClipMatrix(0.0f);
+
+float CalcFrustumScale(float fFovDeg)
+{
+	const float degToRad = 3.14159f * 2.0f / 360.0f;
+	float fFovRad = fFovDeg * degToRad;
+	return 1.0f / tan(fFovRad / 2.0f);
+}
+
+const float frustumScale = CalcFrustumScale(45.0f);
+
+// The layout is generated for this aspect ratio and kept on resize
+const float layoutAspect = 1.6f;
+
+const char *parametersFilename = "stress.scene";
+
+// Levels per instance mesh, each with half the tessellation of the previous
+const int lodLevelCount = 4;
+
+struct AnimatedMatrices
+{
+    std::vector<glm::mat4> instances;
+    std::vector<std::vector<glm::mat4> > armatures;
+};
+
+// The scene and its GL objects belong to the instance that generated them,
+// since offline workers each run one in their own context
+struct Scene::ChapterState
+{
+    StressSceneParameters parameters;
+    StressScene scene;
+
+    // One chain per StressScene mesh, its levels uploaded in meshBuffers,
+    // then the joint cube
+    std::vector<MeshLodChain> lodChains;
+    std::vector<std::vector<MeshBuffers> > meshBuffers;
+    MeshBuffers jointCube;
+    bool lodEnabled = false;
+    int viewportHeight = 1;
+
+    // Static instances and armatures are built once. The animated ones are
+    // rebuilt every frame over the job system, into the frame's own arrays;
+    // an animated instance or armature's slot is its index in those arrays,
+    // -1 for the static ones.
+    std::vector<glm::mat4> instanceMatrices;
+    std::vector<int> instanceSlots;
+    std::vector<int> animatedInstances;
+    std::vector<std::vector<glm::mat4> > armatureMatrices;
+    std::vector<int> armatureSlots;
+    std::vector<int> animatedArmatures;
+};
+
+// Instances stay at their offset as they turn, so the level only depends
+// on where they are
+int InstanceLod(const Scene::ChapterState &state, const StressInstance &instance)
+{
+    if (!state.lodEnabled)
+    {
+        return 0;
+    }
+    return SelectLod(state.lodChains[instance.mesh], cameraToClipMatrix, instance.offset, instance.scale,
+                     state.viewportHeight);
+}
+
+long long CountTriangles(const Scene::ChapterState &state)
+{
+    long long triangles = 0;
+    for (size_t iInstance = 0; iInstance < state.scene.instances.size(); iInstance++)
+    {
+        const StressInstance &instance = state.scene.instances[iInstance];
+        triangles += state.meshBuffers[instance.mesh][InstanceLod(state, instance)].indexCount / 3;
+    }
+    return triangles + (long long)state.scene.jointCount() * (state.jointCube.indexCount / 3);
+}
+
+void PrintSceneSize(const Scene::ChapterState &state)
+{
+    state.parameters.print();
+    printf("Level of detail %s\n", state.lodEnabled ? "on" : "off");
+    printf("%d draws (%d instances, %d joints), %lld triangles, %d instances and %d armatures animated\n",
+           (int)state.scene.instances.size() + state.scene.jointCount(), (int)state.scene.instances.size(),
+           state.scene.jointCount(), CountTriangles(state), (int)state.animatedInstances.size(),
+           (int)state.animatedArmatures.size());
+}
+
+void RegenerateScene(Scene::ChapterState &state)
+{
+    double startTime = glfwGetTime();
+    StressScene &scene = state.scene;
+    scene = GenerateStressScene(state.parameters, frustumScale, layoutAspect);
+
+    state.lodChains.clear();
+    state.meshBuffers.clear();
+    state.meshBuffers.resize(scene.meshShapes.size());
+    for (size_t iMesh = 0; iMesh < scene.meshShapes.size(); iMesh++)
+    {
+        MeshLodChain chain = BuildLodChain(scene.meshShapes[iMesh], scene.meshTessellations[iMesh], lodLevelCount);
+        state.meshBuffers[iMesh].resize(chain.levels.size());
+        for (size_t iLevel = 0; iLevel < chain.levels.size(); iLevel++)
+        {
+            state.meshBuffers[iMesh][iLevel].upload(chain.levels[iLevel], positionAttribute, colorAttribute);
+        }
+        // Only the selection data is kept once uploaded
+        chain.levels.clear();
+        state.lodChains.push_back(chain);
+    }
+    state.jointCube.destroy();
+    state.jointCube.upload(GenerateBox(1), positionAttribute, colorAttribute);
+    printOpenGLError();
+
+    state.instanceMatrices.resize(scene.instances.size());
+    state.instanceSlots.assign(scene.instances.size(), -1);
+    state.animatedInstances.clear();
+    for (size_t iInstance = 0; iInstance < scene.instances.size(); iInstance++)
+    {
+        state.instanceMatrices[iInstance] = scene.instances[iInstance].ConstructMatrix(0.0f);
+        if (scene.instances[iInstance].animated())
+        {
+            state.instanceSlots[iInstance] = (int)state.animatedInstances.size();
+            state.animatedInstances.push_back((int)iInstance);
+        }
+    }
+
+    state.armatureMatrices.resize(scene.armatures.size());
+    state.armatureSlots.assign(scene.armatures.size(), -1);
+    state.animatedArmatures.clear();
+    for (size_t iArmature = 0; iArmature < scene.armatures.size(); iArmature++)
+    {
+        scene.armatures[iArmature].ConstructMatrices(0.0f, state.armatureMatrices[iArmature]);
+        if (scene.armatures[iArmature].animated)
+        {
+            state.armatureSlots[iArmature] = (int)state.animatedArmatures.size();
+            state.animatedArmatures.push_back((int)iArmature);
+        }
+    }
+
+    PrintSceneSize(state);
+    printf("Generated in %.2f s\n", glfwGetTime() - startTime);
+}
+
+void ConstructAnimatedMatrices(const Scene::ChapterState &state, float fElapsedTime, AnimatedMatrices &animated)
+{
+    // Each chunk gathers its instances' angles and evaluates them in one
+    // SinCosArray() before building the matrices
+    animated.instances.resize(state.animatedInstances.size());
+    sharedJobSystem().parallelForAndWait(0, (int)state.animatedInstances.size(), 256, [&](int first, int last)
+    {
+        std::vector<float> angles(last - first);
+        std::vector<float> sines(angles.size());
+        std::vector<float> cosines(angles.size());
+        for (int iLoop = first; iLoop < last; iLoop++)
+        {
+            angles[iLoop - first] = state.scene.instances[state.animatedInstances[iLoop]].AngleRad(fElapsedTime);
+        }
+        SinCosArray(angles.data(), sines.data(), cosines.data(), (int)angles.size());
+        for (int iLoop = first; iLoop < last; iLoop++)
+        {
+            animated.instances[iLoop] = state.scene.instances[state.animatedInstances[iLoop]]
+                                            .ConstructMatrix(sines[iLoop - first], cosines[iLoop - first]);
+        }
+    });
+
+    animated.armatures.resize(state.animatedArmatures.size());
+    sharedJobSystem().parallelForAndWait(0, (int)state.animatedArmatures.size(), 4, [&](int first, int last)
+    {
+        for (int iLoop = first; iLoop < last; iLoop++)
+        {
+            state.scene.armatures[state.animatedArmatures[iLoop]].ConstructMatrices(fElapsedTime, animated.armatures[iLoop]);
+        }
+    });
+}
+
+Scene::Scene()
+{
+}
+
+void Scene::init()
+{
+    _shaderProgram.reset(createShaderProgramWithFilenames("PosColorLocalTransform.vert", "ColorPassthrough.frag"));
+    glUseProgram(_shaderProgram);
+    printOpenGLError();
+
+    // Uniforms
+	modelToCameraMatrixUniform = glGetUniformLocation(_shaderProgram, "modelToCameraMatrix");
+	cameraToClipMatrixUniform = glGetUniformLocation(_shaderProgram, "cameraToClipMatrix");
+    printOpenGLError();
+
+    // Attributes
+    positionAttribute = glGetAttribLocation(_shaderProgram, "position");
+	colorAttribute = glGetAttribLocation(_shaderProgram, "color");
+    printOpenGLError();
+
+    // Matrix
+    float fzNear = 1.0f; float fzFar = 200.0f;
+
+	cameraToClipMatrix[0].x = frustumScale;
+	cameraToClipMatrix[1].y = frustumScale;
+	cameraToClipMatrix[2].z = (fzFar + fzNear) / (fzNear - fzFar);
+	cameraToClipMatrix[2].w = -1.0f;
+	cameraToClipMatrix[3].z = (2 * fzFar * fzNear) / (fzNear - fzFar);
+
+	glUniformMatrix4fv(cameraToClipMatrixUniform, 1, GL_FALSE, glm::value_ptr(cameraToClipMatrix));
+
+    // Enable cull facing
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_BACK);
+    glFrontFace(GL_CW);
+    printOpenGLError();
+
+    // Enable depth testing
+    glEnable(GL_DEPTH_TEST);
+	glDepthMask(GL_TRUE);
+	glDepthFunc(GL_LEQUAL);
+	glDepthRange(0.0f, 1.0f);
+
+    _state = new ChapterState();
+    _state->parameters.parse(ReadAssetOrThrow(parametersFilename));
+    RegenerateScene(*_state);
+}
+
+Scene::~Scene()
+{
+    // Scenes can be switched at runtime; release the meshes with the scene
+    delete _state;
+    printOpenGLError();
+}
+
+void Scene::reshape(int width, int height)
+{
+    cameraToClipMatrix[0].x = frustumScale / (width / (float)height);
+    cameraToClipMatrix[1].y = frustumScale;
+    _state->viewportHeight = std::max(height, 1);
+
+    glUniformMatrix4fv(cameraToClipMatrixUniform, 1, GL_FALSE, glm::value_ptr(clipTile() * cameraToClipMatrix));
+}
+
+void Scene::draw()
+{
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClearDepth(1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    const ChapterState &state = *_state;
+    AnimatedMatrices animated;
+    ConstructAnimatedMatrices(state, elapsedTime(), animated);
+
+    glUseProgram(_shaderProgram);
+    for (size_t iInstance = 0; iInstance < state.scene.instances.size(); iInstance++)
+    {
+        int slot = state.instanceSlots[iInstance];
+        const glm::mat4 &matrix = slot < 0 ? state.instanceMatrices[iInstance] : animated.instances[slot];
+        glUniformMatrix4fv(modelToCameraMatrixUniform, 1, GL_FALSE, glm::value_ptr(matrix));
+        const StressInstance &instance = state.scene.instances[iInstance];
+        state.meshBuffers[instance.mesh][InstanceLod(state, instance)].draw();
+    }
+
+    glBindVertexArray(state.jointCube.vertexArrayObject);
+    for (size_t iArmature = 0; iArmature < state.armatureMatrices.size(); iArmature++)
+    {
+        int slot = state.armatureSlots[iArmature];
+        const std::vector<glm::mat4> &matrices = slot < 0 ? state.armatureMatrices[iArmature] : animated.armatures[slot];
+        for (size_t iJoint = 0; iJoint < matrices.size(); iJoint++)
+        {
+            glUniformMatrix4fv(modelToCameraMatrixUniform, 1, GL_FALSE, glm::value_ptr(matrices[iJoint]));
+            glDrawElements(GL_TRIANGLES, state.jointCube.indexCount, GL_UNSIGNED_INT, 0);
+        }
+    }
+    glBindVertexArray(0);
+    printOpenGLError();
+}
+
+bool Scene::isAnimated()
+{
+    return !_state->animatedInstances.empty() || !_state->animatedArmatures.empty();
+}
+
+void Scene::keyStateChanged(int key, int action)
+{
+    if ( action == GLFW_PRESS ) {
+        StressSceneParameters &parameters = _state->parameters;
+        switch (key)
+        {
+            case GLFW_KEY_N:
+                parameters.seed++;
+                break;
+            case GLFW_KEY_EQUAL:
+                parameters.objectCount = std::max(parameters.objectCount * 2, 1);
+                break;
+            case GLFW_KEY_H:
+                parameters.objectCount /= 2;
+                break;
+            case GLFW_KEY_RIGHT_BRACKET:
+                parameters.trianglesPerObject *= 2;
+                break;
+            case GLFW_KEY_LEFT_BRACKET:
+                parameters.trianglesPerObject = std::max(parameters.trianglesPerObject / 2, 1);
+                break;
+            case GLFW_KEY_D:
+                parameters.overdrawDepth++;
+                break;
+            case GLFW_KEY_S:
+                parameters.overdrawDepth = std::max(parameters.overdrawDepth - 1, 1);
+                break;
+            case GLFW_KEY_A:
+                parameters.animatedFraction = fmodf(parameters.animatedFraction + 0.25f, 1.25f);
+                break;
+            case GLFW_KEY_L:
+                _state->lodEnabled = !_state->lodEnabled;
+                PrintSceneSize(*_state);
+                return;
+            case GLFW_KEY_ENTER:
+                PrintSceneSize(*_state);
+                return;
+            default:
+                return;
+        }
+        RegenerateScene(*_state);
+    }
+}
+
+REGISTER_SCENE("gltut 06f");
+
+}
@@ -0,0 +1,448 @@
+//
+//  gpuresource.h
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+
+#ifndef gltut_glfw_gpuresource_h
+#define gltut_glfw_gpuresource_h
+
+#include <stdio.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Owning handles for GL objects, and a tracker of what they hold on the GPU.
+// A handle deletes its object when it is destroyed or reset, moves but does
+// not copy, and records its object with the tracker under a category, the
+// scene it belongs to and, once known, its size:
+//
+//  GLBuffer indexBufferObject;
+//  indexBufferObject.create(GPUIndexData);
+//  indexBufferObject.bufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indexData), indexData, GL_STATIC_DRAW);
+//  ...
+//  _shaderProgram.reset(createShaderProgramWithFilenames("Standard5.vert", "Standard5.frag"));
+//
+// SceneRegistry::create() starts attributing new objects in the current
+// context to the scene it creates, and deleting the scene flags whatever of
+// its objects is still alive. main.cpp shuts the tracker down before
+// glfwTerminate(): anything alive then is reported as a leak, and handles
+// destroyed later, statics among them, forget their objects without
+// calling into a context that is gone. Contexts share no objects, so a
+// handle released while another context is current reports it and leaves
+// the object to go with its own context rather than delete a name there.
+//
+// Objects that outlive scenes, such as offscreen targets, are created with
+// GPUOwnedByApplication.
+
+enum GPUResourceCategory
+{
+    GPUVertexData,
+    GPUIndexData,
+    GPUUniformData,
+    GPUTextureData,
+    GPURenderTargets,
+    GPUPrograms,
+    GPUVertexArrays,
+    GPUFramebuffers,
+    GPUQueries,
+    GPUResourceCategoryCount
+};
+
+enum GPUResourceOwner
+{
+    GPUOwnedByScene,
+    GPUOwnedByApplication
+};
+
+class GPUMemoryTracker
+{
+  public:
+    GPUMemoryTracker() : _shutDown(false) {}
+
+    // Objects created in the current context from now on belong to scene
+    void beginScene(const std::string &scene)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _scenes[glfwGetCurrentContext()] = scene;
+    }
+
+    // Reports the current context's scene's objects that are still alive
+    // and stops attributing; the number of leaked objects
+    int endScene()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::map<GLFWwindow *, std::string>::iterator iScene = _scenes.find(glfwGetCurrentContext());
+        if (iScene == _scenes.end())
+        {
+            return 0;
+        }
+        std::string scene = iScene->second;
+        _scenes.erase(iScene);
+
+        std::vector<int> leaked;
+        for (size_t iRecord = 0; iRecord < _records.size(); iRecord++)
+        {
+            const Record &record = _records[iRecord];
+            if (record.alive && !record.leakReported && record.owner == GPUOwnedByScene
+                && record.context == glfwGetCurrentContext() && record.scene == scene)
+            {
+                leaked.push_back((int)iRecord);
+            }
+        }
+        reportLeaks(leaked, ("deleting " + scene).c_str());
+        return (int)leaked.size();
+    }
+
+    // The record a handle keeps for its object
+    int add(GPUResourceCategory category, GPUResourceOwner owner)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        Record record;
+        record.category = category;
+        record.owner = owner;
+        record.bytes = 0;
+        record.context = glfwGetCurrentContext();
+        record.alive = true;
+        record.leakReported = false;
+        if (owner == GPUOwnedByScene)
+        {
+            std::map<GLFWwindow *, std::string>::const_iterator iScene = _scenes.find(record.context);
+            if (iScene != _scenes.end())
+            {
+                record.scene = iScene->second;
+            }
+        }
+
+        if (_freeRecords.empty())
+        {
+            _records.push_back(record);
+            return (int)_records.size() - 1;
+        }
+        int index = _freeRecords.back();
+        _freeRecords.pop_back();
+        _records[index] = record;
+        return index;
+    }
+
+    void resize(int record, size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _records[record].bytes = bytes;
+    }
+
+    // False when the object must not be deleted: once shut down, when there
+    // is no context left to delete it from, or when the current context is
+    // not the one it was made in
+    bool remove(int record)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        forgetLocked(record);
+        if (_shutDown)
+        {
+            return false;
+        }
+        if (_records[record].context != glfwGetCurrentContext())
+        {
+            fprintf(stderr, "GPU object (%s) released outside its context; not deleted\n",
+                    categoryName(_records[record].category));
+            return false;
+        }
+        return true;
+    }
+
+    // For objects whose ownership passes elsewhere
+    void forget(int record)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        forgetLocked(record);
+    }
+
+    bool isShutDown()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _shutDown;
+    }
+
+    // Call before glfwTerminate(), with every scene deleted; the number of leaked objects
+    int shutDown()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::vector<int> leaked;
+        for (size_t iRecord = 0; iRecord < _records.size(); iRecord++)
+        {
+            if (_records[iRecord].alive && !_records[iRecord].leakReported)
+            {
+                leaked.push_back((int)iRecord);
+            }
+        }
+        reportLeaks(leaked, "shutdown");
+        _shutDown = true;
+        return (int)leaked.size();
+    }
+
+    // Live objects and bytes per category and per scene
+    void print(FILE *stream = stdout)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        Usage categories[GPUResourceCategoryCount];
+        std::map<std::string, Usage> scenes;
+        Usage total;
+        for (size_t iRecord = 0; iRecord < _records.size(); iRecord++)
+        {
+            const Record &record = _records[iRecord];
+            if (record.alive)
+            {
+                categories[record.category].add(record.bytes);
+                scenes[record.owner == GPUOwnedByScene ? record.scene : "(application)"].add(record.bytes);
+                total.add(record.bytes);
+            }
+        }
+
+        fprintf(stream, "GPU memory: %ld objects, %.1f KB\n", total.objects, total.bytes / 1024.0);
+        for (int iCategory = 0; iCategory < GPUResourceCategoryCount; iCategory++)
+        {
+            if (categories[iCategory].objects > 0)
+            {
+                fprintf(stream, "  %-16s %6ld objects %12.1f KB\n", categoryName((GPUResourceCategory)iCategory),
+                        categories[iCategory].objects, categories[iCategory].bytes / 1024.0);
+            }
+        }
+        for (std::map<std::string, Usage>::const_iterator iScene = scenes.begin(); iScene != scenes.end(); iScene++)
+        {
+            fprintf(stream, "  %-16s %6ld objects %12.1f KB\n", iScene->first.c_str(),
+                    iScene->second.objects, iScene->second.bytes / 1024.0);
+        }
+    }
+
+    static const char *categoryName(GPUResourceCategory category)
+    {
+        const char *names[GPUResourceCategoryCount] = {
+            "vertex data", "index data", "uniform data", "texture data",
+            "render targets", "programs", "vertex arrays", "framebuffers", "queries"
+        };
+        return names[category];
+    }
+
+  private:
+    GPUMemoryTracker(const GPUMemoryTracker &);
+    GPUMemoryTracker &operator=(const GPUMemoryTracker &);
+
+    struct Record
+    {
+        GPUResourceCategory category;
+        GPUResourceOwner owner;
+        size_t bytes;
+        std::string scene;
+        GLFWwindow *context;
+        bool alive;
+        bool leakReported;
+    };
+
+    struct Usage
+    {
+        Usage() : objects(0), bytes(0) {}
+        void add(size_t size) { objects++; bytes += size; }
+        long objects;
+        size_t bytes;
+    };
+
+    void forgetLocked(int record)
+    {
+        _records[record].alive = false;
+        _freeRecords.push_back(record);
+    }
+
+    // Each leaked object is reported once
+    void reportLeaks(const std::vector<int> &leaked, const char *when)
+    {
+        if (leaked.empty())
+        {
+            return;
+        }
+        Usage categories[GPUResourceCategoryCount];
+        for (size_t iLeak = 0; iLeak < leaked.size(); iLeak++)
+        {
+            Record &record = _records[leaked[iLeak]];
+            categories[record.category].add(record.bytes);
+            record.leakReported = true;
+        }
+        fprintf(stderr, "GPU leak at %s: %d objects still alive\n", when, (int)leaked.size());
+        for (int iCategory = 0; iCategory < GPUResourceCategoryCount; iCategory++)
+        {
+            if (categories[iCategory].objects > 0)
+            {
+                fprintf(stderr, "  %-16s %6ld objects %12.1f KB\n", categoryName((GPUResourceCategory)iCategory),
+                        categories[iCategory].objects, categories[iCategory].bytes / 1024.0);
+            }
+        }
+    }
+
+    std::mutex _mutex;
+    std::vector<Record> _records;
+    std::vector<int> _freeRecords;
+    std::map<GLFWwindow *, std::string> _scenes;
+    bool _shutDown;
+};
+
+// Never destroyed, so handles in statics can still reach it at exit
+inline GPUMemoryTracker &sharedGPUMemoryTracker()
+{
+    static GPUMemoryTracker *tracker = new GPUMemoryTracker();
+    return *tracker;
+}
+
+// How each kind of object is generated and deleted, and its default category
+struct GLBufferTraits
+{
+    static const GPUResourceCategory category = GPUVertexData;
+    static GLuint generate() { GLuint name = 0; glGenBuffers(1, &name); return name; }
+    static void destroy(GLuint name) { glDeleteBuffers(1, &name); }
+};
+
+struct GLVertexArrayTraits
+{
+    static const GPUResourceCategory category = GPUVertexArrays;
+    static GLuint generate() { GLuint name = 0; glGenVertexArrays(1, &name); return name; }
+    static void destroy(GLuint name) { glDeleteVertexArrays(1, &name); }
+};
+
+struct GLProgramTraits
+{
+    static const GPUResourceCategory category = GPUPrograms;
+    static GLuint generate() { return glCreateProgram(); }
+    static void destroy(GLuint name) { glDeleteProgram(name); }
+};
+
+struct GLTextureTraits
+{
+    static const GPUResourceCategory category = GPUTextureData;
+    static GLuint generate() { GLuint name = 0; glGenTextures(1, &name); return name; }
+    static void destroy(GLuint name) { glDeleteTextures(1, &name); }
+};
+
+struct GLRenderbufferTraits
+{
+    static const GPUResourceCategory category = GPURenderTargets;
+    static GLuint generate() { GLuint name = 0; glGenRenderbuffers(1, &name); return name; }
+    static void destroy(GLuint name) { glDeleteRenderbuffers(1, &name); }
+};
+
+struct GLFramebufferTraits
+{
+    static const GPUResourceCategory category = GPUFramebuffers;
+    static GLuint generate() { GLuint name = 0; glGenFramebuffers(1, &name); return name; }
+    static void destroy(GLuint name) { glDeleteFramebuffers(1, &name); }
+};
+
+struct GLQueryTraits
+{
+    static const GPUResourceCategory category = GPUQueries;
+    static GLuint generate() { GLuint name = 0; glGenQueries(1, &name); return name; }
+    static void destroy(GLuint name) { glDeleteQueries(1, &name); }
+};
+
+template <typename Traits>
+class GLHandle
+{
+  public:
+    GLHandle() : _name(0), _record(-1) {}
+
+    GLHandle(GLHandle &&other)
+    : _name(other._name)
+    , _record(other._record)
+    {
+        other._name = 0;
+        other._record = -1;
+    }
+
+    GLHandle &operator=(GLHandle &&other)
+    {
+        if (this != &other)
+        {
+            reset();
+            _name = other._name;
+            _record = other._record;
+            other._name = 0;
+            other._record = -1;
+        }
+        return *this;
+    }
+
+    ~GLHandle()
+    {
+        reset();
+    }
+
+    // Generates a new object, deleting the one held
+    void create(GPUResourceCategory category = Traits::category, GPUResourceOwner owner = GPUOwnedByScene)
+    {
+        reset(Traits::generate(), category, owner);
+    }
+
+    // Takes ownership of name, an object made elsewhere (0 for none), deleting the one held
+    void reset(GLuint name = 0, GPUResourceCategory category = Traits::category, GPUResourceOwner owner = GPUOwnedByScene)
+    {
+        GPUMemoryTracker &tracker = sharedGPUMemoryTracker();
+        if (_name != 0 && tracker.remove(_record))
+        {
+            Traits::destroy(_name);
+        }
+        _name = name;
+        _record = name != 0 ? tracker.add(category, owner) : -1;
+    }
+
+    // Gives up ownership without deleting the object
+    GLuint release()
+    {
+        GLuint name = _name;
+        if (_name != 0)
+        {
+            sharedGPUMemoryTracker().forget(_record);
+        }
+        _name = 0;
+        _record = -1;
+        return name;
+    }
+
+    GLuint name() const { return _name; }
+    operator GLuint() const { return _name; }
+
+    // Bytes the object holds on the GPU, as recorded with the tracker
+    void setSize(size_t bytes)
+    {
+        if (_name != 0)
+        {
+            sharedGPUMemoryTracker().resize(_record, bytes);
+        }
+    }
+
+    // Buffers only: binds to target, allocates and records the size
+    void bufferData(GLenum target, GLsizeiptr size, const GLvoid *data, GLenum usage)
+    {
+        glBindBuffer(target, _name);
+        glBufferData(target, size, data, usage);
+        setSize((size_t)size);
+    }
+
+  private:
+    GLHandle(const GLHandle &);
+    GLHandle &operator=(const GLHandle &);
+
+    GLuint _name;
+    int _record;
+};
+
+typedef GLHandle<GLBufferTraits> GLBuffer;
+typedef GLHandle<GLVertexArrayTraits> GLVertexArray;
+typedef GLHandle<GLProgramTraits> GLProgram;
+typedef GLHandle<GLTextureTraits> GLTexture;
+typedef GLHandle<GLRenderbufferTraits> GLRenderbuffer;
+typedef GLHandle<GLFramebufferTraits> GLFramebuffer;
+typedef GLHandle<GLQueryTraits> GLQuery;
+
+#endif
@@ -0,0 +1,365 @@
+//
+//  jobsystem.h
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+
+#ifndef gltut_glfw_jobsystem_h
+#define gltut_glfw_jobsystem_h
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool for per-frame CPU work.
+//
+// Every worker owns a deque: it pushes and pops its own jobs from the back
+// and, when it runs dry, steals from the front of somebody else's deque.
+// Threads that are not workers (the main thread) submit into deque 0, which
+// they also drain while waiting on a JobCounter, so waiting never idles a core.
+//
+//  JobSystem &jobs = sharedJobSystem();
+//  JobCounter counter;
+//  jobs.parallelFor(0, count, 64, [&](int first, int last) { ... }, &counter);
+//  jobs.wait(counter);
+
+class JobSystem;
+
+// Counts outstanding jobs. Jobs submitted with submitAfter() run once the
+// counter they depend on drops to zero, which is how dependencies between
+// groups of jobs are expressed.
+class JobCounter
+{
+  public:
+    JobCounter() : _pending(0) {}
+
+    bool isDone() const { return _pending.load(std::memory_order_acquire) == 0; }
+
+  private:
+    friend class JobSystem;
+
+    JobCounter(const JobCounter &);
+    JobCounter &operator=(const JobCounter &);
+
+    std::atomic<int> _pending;
+    std::mutex _continuationsMutex;
+    std::vector<std::pair<std::function<void()>, JobCounter *> > _continuations;
+};
+
+class JobSystem
+{
+  public:
+    typedef std::function<void()> Job;
+
+    // workerCount == 0 picks one worker per hardware thread, minus the main thread.
+    explicit JobSystem(unsigned workerCount = 0)
+    : _queues(NULL)
+    , _queueCount(0)
+    , _queuedJobs(0)
+    , _running(true)
+    , _started(false)
+    {
+        if (workerCount == 0)
+        {
+            unsigned hardwareThreads = std::thread::hardware_concurrency();
+            workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+        }
+
+        _queueCount = workerCount + 1;
+        _queues = new WorkerQueue[_queueCount];
+        _workers.reserve(workerCount);
+
+        for (unsigned iWorker = 1; iWorker <= workerCount; iWorker++)
+        {
+            _workers.push_back(std::thread(&JobSystem::workerLoop, this, iWorker));
+        }
+
+        // Workers look themselves up in _workerIds, so they wait until it is complete
+        for (size_t iWorker = 0; iWorker < _workers.size(); iWorker++)
+        {
+            _workerIds.push_back(_workers[iWorker].get_id());
+        }
+        {
+            std::lock_guard<std::mutex> lock(_sleepMutex);
+            _started = true;
+        }
+        _wakeUp.notify_all();
+    }
+
+    ~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_sleepMutex);
+            _running = false;
+        }
+        _wakeUp.notify_all();
+
+        for (size_t iWorker = 0; iWorker < _workers.size(); iWorker++)
+        {
+            _workers[iWorker].join();
+        }
+
+        delete[] _queues;
+    }
+
+    // Number of threads that execute jobs, including the calling thread.
+    unsigned threadCount() const { return _queueCount; }
+
+    void submit(const Job &job, JobCounter *counter = NULL)
+    {
+        if (counter != NULL)
+        {
+            counter->_pending.fetch_add(1, std::memory_order_relaxed);
+        }
+        enqueue(QueuedJob(job, counter));
+    }
+
+    // Runs job (accounted against counter) once dependency has no pending jobs.
+    void submitAfter(JobCounter &dependency, const Job &job, JobCounter *counter = NULL)
+    {
+        if (counter != NULL)
+        {
+            counter->_pending.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(dependency._continuationsMutex);
+            if (!dependency.isDone())
+            {
+                dependency._continuations.push_back(std::make_pair(job, counter));
+                return;
+            }
+        }
+        enqueue(QueuedJob(job, counter));
+    }
+
+    // Splits [begin, end) into chunks of at most grainSize indices and calls
+    // func(first, last) for each chunk. Ranges that fit in one chunk run inline.
+    template <typename Func>
+    void parallelFor(int begin, int end, int grainSize, Func func, JobCounter *counter = NULL)
+    {
+        if (grainSize < 1)
+        {
+            grainSize = 1;
+        }
+
+        if (end - begin <= grainSize || _queueCount == 1)
+        {
+            if (begin < end)
+            {
+                func(begin, end);
+            }
+            return;
+        }
+
+        for (int first = begin; first < end; first += grainSize)
+        {
+            int last = std::min(first + grainSize, end);
+            submit(std::bind(func, first, last), counter);
+        }
+    }
+
+    // Blocking parallelFor: returns once every chunk has run.
+    template <typename Func>
+    void parallelForAndWait(int begin, int end, int grainSize, Func func)
+    {
+        JobCounter counter;
+        parallelFor(begin, end, grainSize, func, &counter);
+        wait(counter);
+    }
+
+    // Executes queued jobs on the calling thread until counter reaches zero,
+    // sleeping while there is nothing to run.
+    void wait(JobCounter &counter)
+    {
+        unsigned queueIndex = currentQueueIndex();
+        while (!counter.isDone())
+        {
+            if (runOneJob(queueIndex))
+            {
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(_sleepMutex);
+            _wakeUp.wait(lock, [this, &counter] { return _queuedJobs > 0 || counter.isDone(); });
+        }
+
+        // The job that finished the counter may still hold its mutex; the
+        // caller is free to destroy the counter once this returns
+        std::lock_guard<std::mutex> lock(counter._continuationsMutex);
+    }
+
+  private:
+    struct QueuedJob
+    {
+        QueuedJob() : counter(NULL) {}
+        QueuedJob(const Job &job, JobCounter *counter) : job(job), counter(counter) {}
+
+        Job job;
+        JobCounter *counter;
+    };
+
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<QueuedJob> jobs;
+    };
+
+    JobSystem(const JobSystem &);
+    JobSystem &operator=(const JobSystem &);
+
+    unsigned currentQueueIndex() const
+    {
+        std::thread::id threadId = std::this_thread::get_id();
+        for (size_t iWorker = 0; iWorker < _workerIds.size(); iWorker++)
+        {
+            if (_workerIds[iWorker] == threadId)
+            {
+                return (unsigned)iWorker + 1;
+            }
+        }
+        return 0;
+    }
+
+    bool popLocal(unsigned queueIndex, QueuedJob &queuedJob)
+    {
+        WorkerQueue &queue = _queues[queueIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty())
+        {
+            return false;
+        }
+
+        queuedJob = queue.jobs.back();
+        queue.jobs.pop_back();
+        return true;
+    }
+
+    bool steal(unsigned thiefIndex, QueuedJob &queuedJob)
+    {
+        for (unsigned iOffset = 1; iOffset < _queueCount; iOffset++)
+        {
+            WorkerQueue &victim = _queues[(thiefIndex + iOffset) % _queueCount];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.jobs.empty())
+            {
+                queuedJob = victim.jobs.front();
+                victim.jobs.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool runOneJob(unsigned queueIndex)
+    {
+        QueuedJob queuedJob;
+        if (!popLocal(queueIndex, queuedJob) && !steal(queueIndex, queuedJob))
+        {
+            return false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_sleepMutex);
+            _queuedJobs--;
+        }
+
+        queuedJob.job();
+
+        if (queuedJob.counter != NULL)
+        {
+            finishJob(queuedJob.counter);
+        }
+        return true;
+    }
+
+    void enqueue(const QueuedJob &queuedJob)
+    {
+        WorkerQueue &queue = _queues[currentQueueIndex()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.jobs.push_back(queuedJob);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_sleepMutex);
+            _queuedJobs++;
+        }
+        _wakeUp.notify_one();
+    }
+
+    void finishJob(JobCounter *counter)
+    {
+        std::vector<std::pair<Job, JobCounter *> > continuations;
+        {
+            std::lock_guard<std::mutex> lock(counter->_continuationsMutex);
+            if (counter->_pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            {
+                return;
+            }
+            continuations.swap(counter->_continuations);
+        }
+
+        // Wake threads sleeping in wait() on this counter
+        {
+            std::lock_guard<std::mutex> lock(_sleepMutex);
+        }
+        _wakeUp.notify_all();
+
+        for (size_t iLoop = 0; iLoop < continuations.size(); iLoop++)
+        {
+            enqueue(QueuedJob(continuations[iLoop].first, continuations[iLoop].second));
+        }
+    }
+
+    void workerLoop(unsigned queueIndex)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_sleepMutex);
+            _wakeUp.wait(lock, [this] { return _started || !_running; });
+        }
+
+        while (true)
+        {
+            if (runOneJob(queueIndex))
+            {
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(_sleepMutex);
+            _wakeUp.wait(lock, [this] { return _queuedJobs > 0 || !_running; });
+            if (!_running)
+            {
+                return;
+            }
+        }
+    }
+
+    WorkerQueue *_queues;
+    unsigned _queueCount;
+    std::vector<std::thread> _workers;
+    std::vector<std::thread::id> _workerIds;
+
+    std::mutex _sleepMutex;
+    std::condition_variable _wakeUp;
+    int _queuedJobs;
+    bool _running;
+    bool _started;
+};
+
+// Pool shared by main.cpp and every Scene, created on first use.
+inline JobSystem &sharedJobSystem()
+{
+    static JobSystem jobSystem;
+    return jobSystem;
+}
+
+#endif
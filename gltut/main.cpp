@@ -9,44 +9,599 @@
 //
 
 #include <iostream>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <math.h>
+#include <algorithm>
+#include <thread>
 
 #include "GLFW/glfw3.h"
 
 #include "Scene.h"
 
+#include "assetarchive.h"
+#include "benchmark.h"
+#include "debug.h"
+#include "glcapabilities.h"
+#include "glhelpers.h"
+#include "microbenchmark.h"
+#include "drawstrategy.h"
+#include "dynamicresolution.h"
+#include "framepacing.h"
+#include "offlinerenderer.h"
+#include "offscreentarget.h"
+#include "posterrenderer.h"
+#include "shaderbenchmark.h"
+
 const char* gltutglfwName = "gltut-glfw";
 
-static void onError(int error, const char* description)
+// Built with assetpack; when it is missing the loose shader files are used
+const char* assetArchiveFilename = "gltut.pak";
+
+static void onError(int, const char* description)
 {
     std::cout << "Error: " << description << std::endl;
 }
 
-GLFWwindow* createWindow()
+static void ignoreError(int, const char*)
+{
+}
+
+// Core profile versions to ask for, newest first; 3.2 is the oldest the
+// shaders run on. The first one the driver grants is used for every
+// window after it.
+static const int contextVersions[][2] = { {4, 6}, {4, 5}, {4, 4}, {4, 3}, {4, 2}, {4, 1}, {4, 0}, {3, 3}, {3, 2} };
+static const int contextVersionCount = sizeof(contextVersions) / sizeof(contextVersions[0]);
+static int grantedContextVersion = 0;
+
+// Benchmark workers render offscreen and never show their window. The
+// first window also fills sharedGLCapabilities() from its context, and
+// debug builds route every window's GL messages to debug.h.
+GLFWwindow* createWindow(bool visible = true)
 {
     if (!glfwInit()) {
         return NULL;
     }
     
-    glfwWindowHint( GLFW_CONTEXT_VERSION_MAJOR, 3 );
-    glfwWindowHint( GLFW_CONTEXT_VERSION_MINOR, 2 );
-    glfwWindowHint( GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE );
-    glfwWindowHint( GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE );
+    GLFWwindow* window = NULL;
+    for (int iVersion = grantedContextVersion; iVersion < contextVersionCount && !window; iVersion++) {
+        glfwWindowHint( GLFW_CONTEXT_VERSION_MAJOR, contextVersions[iVersion][0] );
+        glfwWindowHint( GLFW_CONTEXT_VERSION_MINOR, contextVersions[iVersion][1] );
+        glfwWindowHint( GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE );
+        glfwWindowHint( GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE );
+        glfwWindowHint( GLFW_VISIBLE, visible ? GL_TRUE : GL_FALSE );
+#ifdef DEBUG
+        glfwWindowHint( GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE );
+#endif
+        
+        // Refusals of the newer versions are expected; only the last one is an error
+        GLFWerrorfun previousCallback = NULL;
+        if (iVersion + 1 < contextVersionCount) {
+            previousCallback = glfwSetErrorCallback(ignoreError);
+        }
+        window = glfwCreateWindow(1024, 640, gltutglfwName, NULL, NULL);
+        if (iVersion + 1 < contextVersionCount) {
+            glfwSetErrorCallback(previousCallback);
+        }
+        if (window) {
+            grantedContextVersion = iVersion;
+        }
+    }
     
-    return glfwCreateWindow(1024, 640, gltutglfwName, NULL, NULL);
+    if (window) {
+        GLFWwindow* previousContext = glfwGetCurrentContext();
+        glfwMakeContextCurrent(window);
+        GLCapabilities &capabilities = sharedGLCapabilities();
+        if (!capabilities.queried) {
+            capabilities.query();
+        }
+        installOpenGLDebugOutput();
+        glfwMakeContextCurrent(previousContext);
+    }
+    return window;
 }
 
-Scene scene = Scene();
+// Owned here, created from the scene registry; switchToScene() replaces it
+SceneBase *scene = NULL;
+int sceneIndex = -1;
+DynamicResolution dynamicResolution;
+FramePacer framePacer;
+InputLatencyTracker inputLatency;
+
+// A window drag sends many resize events per displayed frame; only the
+// latest size is applied, once, before the next draw
+bool resizePending = false;
+int pendingWidth = 0;
+int pendingHeight = 0;
 
 void onFramebufferResize(GLFWwindow* window, int width, int height)
 {
-    scene.reshape(width, height);
+    pendingWidth = width;
+    pendingHeight = height;
+    resizePending = true;
+    // The callback is installed before the first scene is created
+    if (scene) {
+        scene->setNeedsRedraw();
+    }
+}
+
+void applyPendingResize()
+{
+    if (!resizePending) {
+        return;
+    }
+    resizePending = false;
+    dynamicResolution.resize(pendingWidth, pendingHeight);
+    scene->reshape(pendingWidth, pendingHeight);
+}
+
+// Draws and presents one frame of the running scene at the newest window size
+void drawFrame(GLFWwindow* window)
+{
+    applyPendingResize();
+    inputLatency.beginFrame();
+
+    dynamicResolution.beginFrame();
+    scene->draw();
+    dynamicResolution.endFrame();
+    scene->didRedraw();
+
     glfwSwapBuffers(window);
+    inputLatency.endFrame();
+}
+
+#ifdef __APPLE__
+// A live resize on OS X runs a modal loop inside glfwPollEvents, so the main
+// loop gets no turn until the drag ends. The window asks for a refresh
+// after every size change instead; draw the frame from there.
+void onWindowRefresh(GLFWwindow* window)
+{
+    if (resizePending && scene != NULL) {
+        drawFrame(window);
+    }
+}
+#endif
+
+// Frame times of the last benchmark job, in seconds
+std::vector<double> lastFrameTimes;
+
+// Put back the state the scenes assume is at its default in init()
+void resetSceneState()
+{
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    glDisable(GL_DEPTH_CLAMP);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+    glDepthRange(0.0, 1.0);
+    glFrontFace(GL_CCW);
+    glCullFace(GL_BACK);
+    glUseProgram(0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+// Replaces the running scene. The window, GL context, asset archive and
+// frame pacing carry over; only the scene's own GL objects are rebuilt.
+void switchToScene(int index)
+{
+    SceneRegistry &registry = sharedSceneRegistry();
+    index = (index % registry.size() + registry.size()) % registry.size();
+
+    delete scene;
+    scene = NULL;
+    resetSceneState();
+    printOpenGLError();
+
+    // Chapters load their shaders by bare name; look in the chapter's directory first
+    currentAssetDirectory() = registry.size() > 1 ? registry.name(index) : "";
+
+    sceneIndex = index;
+    scene = registry.create(index);
+    scene->init();
+    printOpenGLError();
+
+    resizePending = true;
+    scene->setNeedsRedraw();
+    if (registry.size() > 1) {
+        std::cout << "Scene: " << registry.name(index) << " (" << index + 1 << " of " << registry.size() << ")" << std::endl;
+    }
+}
+
+// Reports a scene whose shaders fail to load or link instead of throwing,
+// leaving no scene running. Callers skip to another scene.
+bool trySwitchToScene(int index)
+{
+    try {
+        switchToScene(index);
+    } catch (std::exception &exception) {
+        delete scene;
+        scene = NULL;
+        SceneRegistry &registry = sharedSceneRegistry();
+        index = (index % registry.size() + registry.size()) % registry.size();
+        std::cerr << registry.name(index) << ": " << exception.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Deletes what holds GL objects while a context is still current, then
+// terminates GLFW. Objects left alive are reported as GPU leaks.
+void shutDownGL()
+{
+    delete scene;
+    scene = NULL;
+    dynamicResolution.destroy();
+    inputLatency.destroy();
+    sharedGPUMemoryTracker().shutDown();
+    glfwTerminate();
+}
+
+// Draws every linked scene for a fixed number of frames, without vsync,
+// and prints the average frame time of each
+void runBatch(GLFWwindow* window, int frameCount)
+{
+    SceneRegistry &registry = sharedSceneRegistry();
+    framePacer.setSwapInterval(0);
+
+    for (int iScene = 0; iScene < registry.size() && !glfwWindowShouldClose(window); iScene++) {
+        if (!trySwitchToScene(iScene)) {
+            continue;
+        }
+        applyPendingResize();
+
+        // The first frames compile shaders and page in buffers
+        scene->draw();
+        glfwSwapBuffers(window);
+        glFinish();
+
+        double startTime = glfwGetTime();
+        for (int iFrame = 0; iFrame < frameCount; iFrame++) {
+            glfwPollEvents();
+            scene->draw();
+            glfwSwapBuffers(window);
+        }
+        glFinish();
+        double frameTime = (glfwGetTime() - startTime) / frameCount;
+
+        printf("%-12s %8.3f ms/frame\n", registry.name(iScene).c_str(), frameTime * 1000.0);
+    }
+}
+
+// Runs one benchmark job offscreen at the job's resolution. Each frame is
+// timed through glFinish, so the times cover CPU and GPU work.
+std::string runBenchmarkJob(const BenchmarkJob &job, OffscreenTarget &target)
+{
+    int index = sharedSceneRegistry().indexOf(job.scene);
+    if (index < 0) {
+        return "unknown scene";
+    }
+
+    try {
+        switchToScene(index);
+    } catch (std::exception &exception) {
+        delete scene;
+        scene = NULL;
+        return exception.what();
+    }
+    resizePending = false;
+
+    if (!target.resize(job.width, job.height)) {
+        return "framebuffer incomplete";
+    }
+    target.bind();
+    // Chapter 6 scenes leave the viewport alone in reshape()
+    glViewport(0, 0, job.width, job.height);
+    scene->reshape(job.width, job.height);
+    for (size_t iKey = 0; iKey < job.keys.size(); iKey++) {
+        // Printable GLFW key codes are their upper case ASCII characters
+        scene->keyStateChanged(toupper((unsigned char)job.keys[iKey]), GLFW_PRESS);
+    }
+
+    // The first frame compiles shaders and pages in buffers
+    scene->draw();
+    glFinish();
+
+    std::vector<double> frameTimes;
+    frameTimes.reserve(job.frames);
+    for (int iFrame = 0; iFrame < job.frames; iFrame++) {
+        double frameStart = glfwGetTime();
+        scene->draw();
+        glFinish();
+        frameTimes.push_back(glfwGetTime() - frameStart);
+    }
+    target.unbind();
+    printOpenGLError();
+
+    lastFrameTimes.swap(frameTimes);
+    return "";
+}
+
+// The worker side of the benchrunner protocol (see benchmark.h): jobs come
+// in on stdin and one JSON line per job goes out on results
+void runWorker(FILE *results)
+{
+    OffscreenTarget target;
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        BenchmarkJob job;
+        std::string error = job.parseLine(line) ? runBenchmarkJob(job, target) : "malformed job";
+        if (!error.empty()) {
+            lastFrameTimes.clear();
+        }
+        fprintf(results, "%s\n", BenchmarkResultJSON(job, lastFrameTimes, error).c_str());
+        fflush(results);
+    }
+}
+
+// Renders frames of one scene to disk (or to stream) on several hidden
+// contexts at once, with the scene clock pinned to each frame's time
+bool renderOffline(int index, const OfflineRenderSettings &settings, int threadCount,
+                   const std::string &output, FILE *stream)
+{
+    SceneRegistry &registry = sharedSceneRegistry();
+    currentAssetDirectory() = registry.size() > 1 ? registry.name(index) : "";
+
+    std::vector<GLFWwindow *> contexts;
+    for (int iThread = 0; iThread < threadCount; iThread++) {
+        GLFWwindow *context = createWindow(false);
+        if (!context) {
+            break;
+        }
+        contexts.push_back(context);
+    }
+    if (contexts.empty()) {
+        return false;
+    }
+
+    // Two frames in flight per context keeps every worker busy while the writer catches up
+    OrderedFrameSink sink(stream ? WritePPMStream(stream) : WritePPMFiles(output),
+                          settings.width, settings.height, settings.firstFrame, (int)contexts.size() * 2);
+    OfflineRenderer renderer;
+    double startTime = glfwGetTime();
+    bool complete = renderer.render([&registry, index]() { return registry.create(index); }, contexts, settings, sink);
+    double renderTime = glfwGetTime() - startTime;
+
+    std::cerr << registry.name(index) << ": " << settings.frameCount << " frames at "
+              << settings.width << "x" << settings.height << " on " << contexts.size() << " contexts in "
+              << renderTime << " s (" << settings.frameCount / renderTime << " frames/s)"
+              << (complete ? "" : ", incomplete") << std::endl;
+
+    for (size_t iContext = 0; iContext < contexts.size(); iContext++) {
+        glfwDestroyWindow(contexts[iContext]);
+    }
+    return complete;
+}
+
+// Renders one still of a scene, larger than the window or any framebuffer
+// allows, tile by tile into a PPM file
+bool renderPoster(int index, int width, int height, int tileSize, double time, const std::string &output)
+{
+    try {
+        switchToScene(index);
+    } catch (std::exception &exception) {
+        std::cerr << exception.what() << std::endl;
+        return false;
+    }
+    scene->setFixedTime(time);
+
+    FILE *file = fopen(output.c_str(), "wb");
+    if (file == NULL) {
+        std::cerr << "Could not write " << output << std::endl;
+        return false;
+    }
+
+    PosterRenderer poster;
+    poster.setTileSize(tileSize);
+    double startTime = glfwGetTime();
+    bool written = poster.render(*scene, width, height, file);
+    written = fclose(file) == 0 && written;
+    if (!written) {
+        remove(output.c_str());
+    }
+
+    std::cerr << sharedSceneRegistry().name(index) << ": " << width << "x" << height << " poster in "
+              << glfwGetTime() - startTime << " s" << (written ? "" : ", failed") << std::endl;
+    return written;
+}
+
+// Times every registered microbenchmark whose name contains filter, on one
+// core and without creating a window
+void runMicrobenchmarks(const std::string &filter)
+{
+    MicrobenchmarkRegistry &registry = sharedMicrobenchmarkRegistry();
+    if (!PinToCores(0, 1)) {
+        std::cerr << "Could not pin to a core; timings will be noisier" << std::endl;
+    }
+
+    printf("%-40s %12s %12s %12s\n", "benchmark", "median ns", "minimum ns", "TSC ticks");
+    for (int iBenchmark = 0; iBenchmark < registry.size(); iBenchmark++) {
+        if (registry.name(iBenchmark).find(filter) == std::string::npos)
+            continue;
+        MicrobenchmarkResult result = RunMicrobenchmark(registry.body(iBenchmark), 0.01, 15);
+        printf("%-40s %12.2f %12.2f %12.1f\n", registry.name(iBenchmark).c_str(),
+               result.medianNanoseconds, result.minimumNanoseconds, result.medianCycles);
+    }
+}
+
+// Times the registered shader programs whose names contain filter on the
+// vertex and fragment workloads of shaderbenchmark.h, offscreen at width x height
+bool runShaderBenchmarks(const std::string &filter, int width, int height)
+{
+    std::vector<ShaderBenchmarkCase> cases = sharedShaderBenchmarkCases();
+    std::sort(cases.begin(), cases.end(), [](const ShaderBenchmarkCase &first, const ShaderBenchmarkCase &second) {
+        return first.name() < second.name();
+    });
+
+    OffscreenTarget target;
+    if (!target.resize(width, height)) {
+        return false;
+    }
+    target.bind();
+    glViewport(0, 0, width, height);
+
+    ShaderBenchmark benchmark;
+    printf("%-56s %12s %12s %10s\n", "program", "ns/vertex", "ns/fragment", "coverage");
+    for (size_t iCase = 0; iCase < cases.size(); iCase++) {
+        if (cases[iCase].name().find(filter) == std::string::npos)
+            continue;
+
+        currentAssetDirectory() = sharedSceneRegistry().size() > 1 ? cases[iCase].scene : "";
+        GLProgram program;
+        try {
+            program.reset(createShaderProgramWithFilenames(cases[iCase].vertexShader, cases[iCase].fragmentShader),
+                          GPUPrograms, GPUOwnedByApplication);
+        } catch (std::exception &exception) {
+            printf("%-56s %s\n", cases[iCase].name().c_str(), exception.what());
+            continue;
+        }
 
+        glClear(GL_COLOR_BUFFER_BIT);
+        ShaderBenchmarkResult result = benchmark.measure(program, cases[iCase].setupUniforms);
+        printf("%-56s %12.4f %12.4f %9.1f%%\n", cases[iCase].name().c_str(), result.vertexNanoseconds,
+               result.fragmentNanoseconds, result.fragmentsPerLayer * 100.0 / ((double)width * height));
+    }
+
+    target.unbind();
+    return true;
+}
+
+// A grid of objects in front of the camera that fills about the same part
+// of the view whatever the count, each turned by its own angle
+std::vector<glm::mat4> drawBenchmarkMatrices(int objectCount)
+{
+    int columns = (int)ceil(sqrt((double)objectCount));
+    float spacing = 4.0f / columns;
+    std::vector<glm::mat4> matrices(objectCount);
+    for (int iObject = 0; iObject < objectCount; iObject++) {
+        float angle = iObject * 0.7f;
+        float scale = spacing * 0.3f;
+        glm::mat4 &matrix = matrices[iObject];
+        matrix[0] = glm::vec4(cosf(angle) * scale, 0.0f, -sinf(angle) * scale, 0.0f);
+        matrix[1] = glm::vec4(0.0f, scale, 0.0f, 0.0f);
+        matrix[2] = glm::vec4(sinf(angle) * scale, 0.0f, cosf(angle) * scale, 0.0f);
+        matrix[3] = glm::vec4(-2.0f + spacing * (iObject % columns + 0.5f),
+                              -2.0f + spacing * (iObject / columns + 0.5f), -5.0f, 1.0f);
+    }
+    return matrices;
+}
+
+// Times every strategy of drawstrategy.h drawing 10, 100, ... maxObjects
+// copies of the registered mesh, offscreen at width x height. Prints a
+// table, and writes the same rows as CSV to csvFilename if it is not empty.
+bool runDrawBenchmarks(int maxObjects, int width, int height, const std::string &csvFilename)
+{
+    std::vector<DrawBenchmarkMesh> &meshes = sharedDrawBenchmarkMeshes();
+    if (meshes.empty()) {
+        std::cerr << "No scene in this binary registers a draw benchmark mesh" << std::endl;
+        return false;
+    }
+    const DrawBenchmarkMesh &mesh = meshes[0];
+
+    FILE *csv = NULL;
+    if (!csvFilename.empty()) {
+        csv = fopen(csvFilename.c_str(), "w");
+        if (csv == NULL) {
+            std::cerr << "Could not write " << csvFilename << std::endl;
+            return false;
+        }
+        fprintf(csv, "strategy,objects,cpu_ms,gpu_ms\n");
+    }
+
+    OffscreenTarget target;
+    if (!target.resize(width, height)) {
+        if (csv != NULL) fclose(csv);
+        return false;
+    }
+    target.bind();
+    glViewport(0, 0, width, height);
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_BACK);
+    glFrontFace(GL_CW);
+    glEnable(GL_DEPTH_TEST);
+
+    // The 06d projection: 45 degree vertical field of view, near 1, far 100
+    float frustumScale = 1.0f / tanf(45.0f * 3.14159f / 360.0f);
+    float zNear = 1.0f, zFar = 100.0f;
+    glm::mat4 cameraToClipMatrix(0.0f);
+    cameraToClipMatrix[0].x = frustumScale * height / width;
+    cameraToClipMatrix[1].y = frustumScale;
+    cameraToClipMatrix[2].z = (zFar + zNear) / (zNear - zFar);
+    cameraToClipMatrix[2].w = -1.0f;
+    cameraToClipMatrix[3].z = (2 * zFar * zNear) / (zNear - zFar);
+
+    PerDrawUniformStrategy perDrawUniform;
+    UniformRingStrategy uniformRing;
+    InstancedStrategy instanced;
+    MultiDrawStrategy multiDraw;
+    DrawStrategy *strategies[] = { &perDrawUniform, &uniformRing, &instanced, &multiDraw };
+
+    std::cout << "Mesh: " << mesh.scene << ", " << mesh.indexCount / 3 << " triangles" << std::endl;
+    printf("%-20s %10s %12s %12s\n", "strategy", "objects", "CPU ms", "GPU ms");
+    for (size_t iStrategy = 0; iStrategy < sizeof(strategies) / sizeof(strategies[0]); iStrategy++) {
+        DrawStrategy &strategy = *strategies[iStrategy];
+        if (!strategy.supported()) {
+            printf("%-20s %s\n", strategy.name(), "not supported by this context");
+            continue;
+        }
+        try {
+            strategy.init(mesh);
+        } catch (std::exception &exception) {
+            printf("%-20s %s\n", strategy.name(), exception.what());
+            continue;
+        }
+
+        for (int objectCount = 10; objectCount <= maxObjects; objectCount *= 10) {
+            if (strategy.maxObjectCount() > 0 && objectCount > strategy.maxObjectCount()) {
+                printf("%-20s %10d %12s %12s\n", strategy.name(), objectCount, "skipped", "");
+                continue;
+            }
+            std::vector<glm::mat4> matrices = drawBenchmarkMatrices(objectCount);
+            // Fewer frames where one takes seconds
+            int frameCount = objectCount >= 100000 ? 3 : 9;
+            DrawStrategyTiming timing = MeasureDrawStrategy(strategy, matrices, cameraToClipMatrix, frameCount);
+            printf("%-20s %10d %12.3f %12.3f\n", strategy.name(), objectCount, timing.cpuMilliseconds, timing.gpuMilliseconds);
+            if (csv != NULL) {
+                fprintf(csv, "%s,%d,%.4f,%.4f\n", strategy.name(), objectCount, timing.cpuMilliseconds, timing.gpuMilliseconds);
+            }
+            fflush(stdout);
+        }
+    }
+    printOpenGLError();
+
+    resetSceneState();
+    target.unbind();
+    return csv == NULL || fclose(csv) == 0;
+}
+
+// Blocks until there is input, or until the timeout on GLFW versions that support one
+#if GLFW_VERSION_MAJOR > 3 || (GLFW_VERSION_MAJOR == 3 && GLFW_VERSION_MINOR >= 2)
+void waitForEvents(double timeout)
+{
+    glfwWaitEventsTimeout(timeout);
+}
+#else
+void waitForEvents(double)
+{
+    glfwWaitEvents();
 }
+#endif
 
 static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
     static bool depthClampingActive = false;
+    static const double targetRates[] = { 0.0, 30.0, 60.0, 120.0 };
+    static int targetRateIndex = 0;
+
+    if (action == GLFW_PRESS) {
+        inputLatency.recordInput("key", key);
+        scene->setNeedsRedraw();
+    }
 
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, GL_TRUE);
@@ -57,41 +612,256 @@ static void key_callback(GLFWwindow* window, int key, int scancode, int action,
             glEnable(GL_DEPTH_CLAMP);
         }
         depthClampingActive = !depthClampingActive;
-    } else if ( action == GLFW_PRESS ) {
-        scene.keyStateChanged(key, action);
+    } else if (key == GLFW_KEY_2 && action == GLFW_PRESS) {
+        dynamicResolution.setEnabled(!dynamicResolution.enabled());
+        std::cout << "Dynamic resolution: " << (dynamicResolution.enabled() ? "on" : "off") << std::endl;
+    } else if (key == GLFW_KEY_3 && action == GLFW_PRESS) {
+        bool sharpen = dynamicResolution.upscaleFilter() == UpscaleFilterBilinear;
+        dynamicResolution.setUpscaleFilter(sharpen ? UpscaleFilterSharpen : UpscaleFilterBilinear);
+        std::cout << "Upscale filter: " << (sharpen ? "sharpen" : "bilinear")
+                  << ", scale " << dynamicResolution.scale()
+                  << ", last frame " << dynamicResolution.lastFrameTime() * 1000.0 << " ms" << std::endl;
+    } else if (key == GLFW_KEY_4 && action == GLFW_PRESS) {
+        framePacer.setSwapInterval(framePacer.swapInterval() == 0 ? 1 : 0);
+        std::cout << "Swap interval: " << framePacer.swapInterval() << std::endl;
+    } else if (key == GLFW_KEY_5 && action == GLFW_PRESS) {
+        targetRateIndex = (targetRateIndex + 1) % (sizeof(targetRates) / sizeof(targetRates[0]));
+        framePacer.setTargetRate(targetRates[targetRateIndex]);
+        std::cout << "Frame limiter: ";
+        if (framePacer.targetRate() > 0.0) {
+            std::cout << framePacer.targetRate() << " Hz" << std::endl;
+        } else {
+            std::cout << "off" << std::endl;
+        }
+    } else if (key == GLFW_KEY_6 && action == GLFW_PRESS) {
+        sharedGPUMemoryTracker().print();
+    } else if (key == GLFW_KEY_7 && action == GLFW_PRESS) {
+        const InputLatencySummary &latency = inputLatency.summary();
+        std::cout << "Input to present avg " << latency.averageToPresent * 1000.0
+                  << " ms, max " << latency.maximumToPresent * 1000.0
+                  << " ms over " << latency.eventCount << " events" << std::endl;
+        inputLatency.resetSummary();
+    } else if ((key == GLFW_KEY_PAGE_UP || key == GLFW_KEY_PAGE_DOWN) && action == GLFW_PRESS
+               && sharedSceneRegistry().size() > 1) {
+        // Skips scenes that fail to load, coming back to the current one last
+        int step = key == GLFW_KEY_PAGE_DOWN ? 1 : -1;
+        int nextIndex = sceneIndex + step;
+        for (int iTry = 0; iTry < sharedSceneRegistry().size() && !trySwitchToScene(nextIndex); iTry++) {
+            nextIndex += step;
+        }
+        if (scene == NULL) {
+            glfwSetWindowShouldClose(window, GL_TRUE);
+        }
+    } else if ( action == GLFW_PRESS && scene != NULL ) {
+        scene->keyStateChanged(key, action);
     }
 }
 
+static void printUsage()
+{
+    std::cout << "usage: " << gltutglfwName << " [--scene name] [--list] [--batch [frames]]" << std::endl
+              << "       " << gltutglfwName << " --worker [--cores first count]" << std::endl
+              << "       " << gltutglfwName << " --scene name --offline frames [--fps n] [--size WxH] [--threads n] [--output pattern|-]" << std::endl
+              << "       " << gltutglfwName << " --scene name --poster WxH [--tile n] [--time seconds] [--output file.ppm]" << std::endl
+              << "       " << gltutglfwName << " --microbench [name filter]" << std::endl
+              << "       " << gltutglfwName << " --shaderbench [name filter] [--size WxH]" << std::endl
+              << "       " << gltutglfwName << " --drawbench [max objects] [--size WxH] [--output file.csv]" << std::endl
+              << "       " << gltutglfwName << " --caps" << std::endl
+              << "  --gldebug high|medium|low|all: lowest GL debug message severity printed (debug builds)" << std::endl;
+}
+
 int main(int argc, const char * argv[])
 {
+    SceneRegistry &registry = sharedSceneRegistry();
+    int firstScene = 0;
+    int batchFrames = 0;
+    bool worker = false;
+    OfflineRenderSettings offline = { 1280, 720, 0, 0, 60.0 };
+    int offlineThreads = std::max((int)std::thread::hardware_concurrency(), 1);
+    std::string output;
+    int posterWidth = 0;
+    int posterHeight = 0;
+    int posterTileSize = 1024;
+    double posterTime = 0.0;
+    bool shaderBenchmarks = false;
+    std::string shaderBenchmarkFilter;
+    int drawBenchmarkObjects = 0;
+    bool printCapabilities = false;
+
+    for (int iArg = 1; iArg < argc; iArg++) {
+        if (strcmp(argv[iArg], "--list") == 0) {
+            for (int iScene = 0; iScene < registry.size(); iScene++) {
+                std::cout << registry.name(iScene) << std::endl;
+            }
+            return 0;
+        } else if (strcmp(argv[iArg], "--scene") == 0 && iArg + 1 < argc) {
+            firstScene = registry.indexOf(argv[++iArg]);
+            if (firstScene < 0) {
+                std::cout << "No scene named " << argv[iArg] << "; --list shows them" << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[iArg], "--batch") == 0) {
+            batchFrames = 300;
+            if (iArg + 1 < argc && atoi(argv[iArg + 1]) > 0) {
+                batchFrames = atoi(argv[++iArg]);
+            }
+        } else if (strcmp(argv[iArg], "--offline") == 0 && iArg + 1 < argc) {
+            offline.frameCount = atoi(argv[++iArg]);
+        } else if (strcmp(argv[iArg], "--fps") == 0 && iArg + 1 < argc) {
+            offline.framesPerSecond = atof(argv[++iArg]);
+        } else if (strcmp(argv[iArg], "--size") == 0 && iArg + 1 < argc) {
+            sscanf(argv[++iArg], "%dx%d", &offline.width, &offline.height);
+        } else if (strcmp(argv[iArg], "--threads") == 0 && iArg + 1 < argc) {
+            offlineThreads = std::max(atoi(argv[++iArg]), 1);
+        } else if (strcmp(argv[iArg], "--output") == 0 && iArg + 1 < argc) {
+            output = argv[++iArg];
+        } else if (strcmp(argv[iArg], "--poster") == 0 && iArg + 1 < argc) {
+            sscanf(argv[++iArg], "%dx%d", &posterWidth, &posterHeight);
+        } else if (strcmp(argv[iArg], "--tile") == 0 && iArg + 1 < argc) {
+            posterTileSize = std::max(atoi(argv[++iArg]), 1);
+        } else if (strcmp(argv[iArg], "--time") == 0 && iArg + 1 < argc) {
+            posterTime = atof(argv[++iArg]);
+        } else if (strcmp(argv[iArg], "--microbench") == 0) {
+            runMicrobenchmarks(iArg + 1 < argc && argv[iArg + 1][0] != '-' ? argv[iArg + 1] : "");
+            return 0;
+        } else if (strcmp(argv[iArg], "--shaderbench") == 0) {
+            shaderBenchmarks = true;
+            if (iArg + 1 < argc && argv[iArg + 1][0] != '-') {
+                shaderBenchmarkFilter = argv[++iArg];
+            }
+        } else if (strcmp(argv[iArg], "--drawbench") == 0) {
+            drawBenchmarkObjects = 1000000;
+            if (iArg + 1 < argc && atoi(argv[iArg + 1]) > 0) {
+                drawBenchmarkObjects = atoi(argv[++iArg]);
+            }
+        } else if (strcmp(argv[iArg], "--gldebug") == 0 && iArg + 1 < argc) {
+            if (!setOpenGLDebugSeverity(argv[++iArg])) {
+                printUsage();
+                return 1;
+            }
+        } else if (strcmp(argv[iArg], "--caps") == 0) {
+            printCapabilities = true;
+        } else if (strcmp(argv[iArg], "--worker") == 0) {
+            worker = true;
+        } else if (strcmp(argv[iArg], "--cores") == 0 && iArg + 2 < argc) {
+            int firstCore = atoi(argv[++iArg]);
+            int coreCount = atoi(argv[++iArg]);
+            if (!PinToCores(firstCore, coreCount)) {
+                std::cerr << "Could not pin to cores " << firstCore << "-" << firstCore + coreCount - 1 << std::endl;
+            }
+        } else if (strncmp(argv[iArg], "-psn", 4) != 0) {
+            // -psn_* is passed by the Finder
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (registry.size() == 0) {
+        std::cout << "No scenes are linked into this binary" << std::endl;
+        return 1;
+    }
+
+    // Scenes print to stdout; keep it for the protocol (or the frame stream) and send the rest to stderr
+    FILE *results = NULL;
+    if (worker || (offline.frameCount > 0 && output == "-")) {
+        results = fdopen(dup(STDOUT_FILENO), "w");
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+    }
+
     glfwSetErrorCallback(onError);
+
+    if (sharedAssetArchive().open(assetArchiveFilename)) {
+        std::cout << "Assets: " << assetArchiveFilename << " (" << sharedAssetArchive().entryCount() << " entries)" << std::endl;
+    }
+
+    if (offline.frameCount > 0) {
+        bool complete = offline.width > 0 && offline.height > 0 && offline.framesPerSecond > 0.0
+                        && renderOffline(firstScene, offline, offlineThreads,
+                                         output.empty() ? "frame%05d.ppm" : output, results);
+        shutDownGL();
+        return complete ? 0 : 1;
+    }
     
-    GLFWwindow* window = createWindow();
+    GLFWwindow* window = createWindow(!worker && posterWidth == 0 && !shaderBenchmarks && drawBenchmarkObjects == 0
+                                      && !printCapabilities);
     if (!window)
         return 0;
 
     glfwMakeContextCurrent(window);
 
-    scene.init();
-    
     int windowWidth = 0;
     int windowHeight = 0;
     
     glfwGetFramebufferSize(window, &windowWidth, &windowHeight);
-    onFramebufferResize(window, windowWidth, windowHeight);
+    pendingWidth = windowWidth;
+    pendingHeight = windowHeight;
     glfwSetFramebufferSizeCallback(window, &onFramebufferResize);
+
+    if (printCapabilities) {
+        sharedGLCapabilities().print();
+        shutDownGL();
+        return 0;
+    }
+
+    if (worker) {
+        runWorker(results);
+        shutDownGL();
+        return 0;
+    }
+
+    if (shaderBenchmarks) {
+        bool measured = runShaderBenchmarks(shaderBenchmarkFilter, offline.width, offline.height);
+        shutDownGL();
+        return measured ? 0 : 1;
+    }
+
+    if (drawBenchmarkObjects > 0) {
+        bool measured = runDrawBenchmarks(drawBenchmarkObjects, offline.width, offline.height, output);
+        shutDownGL();
+        return measured ? 0 : 1;
+    }
+
+    if (posterWidth > 0 && posterHeight > 0) {
+        bool written = renderPoster(firstScene, posterWidth, posterHeight, posterTileSize, posterTime,
+                                    output.empty() ? "poster.ppm" : output);
+        shutDownGL();
+        return written ? 0 : 1;
+    }
+
+    if (batchFrames > 0) {
+        runBatch(window, batchFrames);
+        shutDownGL();
+        return 0;
+    }
+
+    switchToScene(firstScene);
     
     glfwSetKeyCallback(window, key_callback);
+#ifdef __APPLE__
+    glfwSetWindowRefreshCallback(window, &onWindowRefresh);
+#endif
+
+    framePacer.setSwapInterval(1);
 
     while (!glfwWindowShouldClose(window))
     {
-        scene.draw();
-        
-        glfwSwapBuffers(window);
+        if (!scene->needsRedraw()) {
+            // Identical frames would follow; sleep until something happens
+            waitForEvents(1.0);
+            continue;
+        }
+
+        framePacer.waitForNextFrame();
+
+        // Poll as late as possible so the frame draws the freshest input
         glfwPollEvents();
+        if (scene == NULL) {
+            break;
+        }
+        drawFrame(window);
     }
     
-    glfwTerminate();
+    shutDownGL();
     
     return 0;
 }
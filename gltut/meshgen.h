@@ -0,0 +1,417 @@
+//
+//  meshgen.h
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+
+#ifndef gltut_glfw_meshgen_h
+#define gltut_glfw_meshgen_h
+
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+#include "glm.hpp"
+
+#include "gpuresource.h"
+
+// Procedural versions of the hand-typed vertexData/indexData arrays.
+//
+// Every generator takes a tessellation parameter and produces a Mesh laid out
+// the way the chapters upload theirs: all positions (xyz) followed by all
+// colors (rgba) in one buffer, and an index list. Triangles are clockwise
+// when seen from outside, matching glFrontFace(GL_CW) in the scenes. Colors
+// are derived from the face normal so shapes read well without lighting.
+//
+// MeshLodChain holds the same shape at decreasing tessellations, and
+// SelectLod() picks a level from the object's projected size on screen.
+
+struct Mesh
+{
+    std::vector<float> positions;   // xyz
+    std::vector<float> colors;      // rgba
+    std::vector<GLuint> indices;
+
+    int vertexCount() const { return (int)positions.size() / 3; }
+    int triangleCount() const { return (int)indices.size() / 3; }
+
+    GLuint addVertex(const glm::vec3 &position, const glm::vec3 &normal)
+    {
+        positions.push_back(position.x);
+        positions.push_back(position.y);
+        positions.push_back(position.z);
+
+        glm::vec3 color = glm::abs(normal) * 0.8f + 0.2f;
+        colors.push_back(color.r);
+        colors.push_back(color.g);
+        colors.push_back(color.b);
+        colors.push_back(1.0f);
+
+        return (GLuint)(vertexCount() - 1);
+    }
+
+    // a, b, c, d go clockwise around the quad seen from the front
+    void addQuad(GLuint a, GLuint b, GLuint c, GLuint d)
+    {
+        addTriangle(a, b, c);
+        addTriangle(c, d, a);
+    }
+
+    void addTriangle(GLuint a, GLuint b, GLuint c)
+    {
+        indices.push_back(a);
+        indices.push_back(b);
+        indices.push_back(c);
+    }
+
+    // Radius of the bounding sphere centered at the origin
+    float boundingRadius() const
+    {
+        float maxLengthSquared = 0.0f;
+        for (size_t iLoop = 0; iLoop + 2 < positions.size(); iLoop += 3)
+        {
+            float lengthSquared = positions[iLoop] * positions[iLoop] +
+                                  positions[iLoop + 1] * positions[iLoop + 1] +
+                                  positions[iLoop + 2] * positions[iLoop + 2];
+            maxLengthSquared = std::max(maxLengthSquared, lengthSquared);
+        }
+        return sqrtf(maxLengthSquared);
+    }
+};
+
+// Adds a (tessellation x tessellation) patch spanning origin + [0,1]*uAxis + [0,1]*vAxis.
+// The front face is the side cross(uAxis, vAxis) points to.
+inline void AddPatch(Mesh &mesh, const glm::vec3 &origin, const glm::vec3 &uAxis, const glm::vec3 &vAxis,
+                     int tessellation)
+{
+    glm::vec3 normal = glm::normalize(glm::cross(uAxis, vAxis));
+    GLuint firstVertex = (GLuint)mesh.vertexCount();
+    int rowLength = tessellation + 1;
+
+    for (int iV = 0; iV <= tessellation; iV++)
+    {
+        for (int iU = 0; iU <= tessellation; iU++)
+        {
+            glm::vec3 position = origin + uAxis * (iU / (float)tessellation) + vAxis * (iV / (float)tessellation);
+            mesh.addVertex(position, normal);
+        }
+    }
+
+    for (int iV = 0; iV < tessellation; iV++)
+    {
+        for (int iU = 0; iU < tessellation; iU++)
+        {
+            GLuint corner = firstVertex + iV * rowLength + iU;
+            mesh.addQuad(corner, corner + rowLength, corner + rowLength + 1, corner + 1);
+        }
+    }
+}
+
+// Unit box spanning [-1, 1] on every axis, like the 06x cube.
+inline Mesh GenerateBox(int tessellation)
+{
+    tessellation = std::max(tessellation, 1);
+    Mesh mesh;
+
+    const glm::vec3 x(2.0f, 0.0f, 0.0f), y(0.0f, 2.0f, 0.0f), z(0.0f, 0.0f, 2.0f);
+    AddPatch(mesh, glm::vec3(-1.0f, -1.0f, +1.0f), x, y, tessellation);    // front  (+z)
+    AddPatch(mesh, glm::vec3(+1.0f, -1.0f, -1.0f), -x, y, tessellation);   // back   (-z)
+    AddPatch(mesh, glm::vec3(+1.0f, -1.0f, +1.0f), -z, y, tessellation);   // +x
+    AddPatch(mesh, glm::vec3(-1.0f, -1.0f, -1.0f), z, y, tessellation);    // -x
+    AddPatch(mesh, glm::vec3(-1.0f, +1.0f, +1.0f), x, -z, tessellation);   // top    (+y)
+    AddPatch(mesh, glm::vec3(-1.0f, -1.0f, -1.0f), x, z, tessellation);    // bottom (-y)
+
+    return mesh;
+}
+
+// Flat grid in the XZ plane spanning [-1, 1], facing +y.
+inline Mesh GenerateGrid(int tessellation)
+{
+    tessellation = std::max(tessellation, 1);
+    Mesh mesh;
+    AddPatch(mesh, glm::vec3(-1.0f, 0.0f, +1.0f), glm::vec3(2.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -2.0f), tessellation);
+    return mesh;
+}
+
+// Surface of revolution around the y axis. profile(t) gives (radius, height)
+// for t in [0, 1]; caps close the ends when the radius there is not zero.
+template <typename Profile>
+inline Mesh GenerateRevolution(int slices, int stacks, Profile profile, bool caps)
+{
+    Mesh mesh;
+    const float twoPi = 3.14159265f * 2.0f;
+    int rowLength = slices + 1;
+
+    for (int iStack = 0; iStack <= stacks; iStack++)
+    {
+        float t = iStack / (float)stacks;
+        glm::vec2 point = profile(t);
+        // Finite-difference tangent along the profile gives the normal
+        glm::vec2 tangent = profile(std::min(t + 0.001f, 1.0f)) - profile(std::max(t - 0.001f, 0.0f));
+
+        for (int iSlice = 0; iSlice <= slices; iSlice++)
+        {
+            float angle = twoPi * iSlice / (float)slices;
+            glm::vec3 direction(cosf(angle), 0.0f, sinf(angle));
+            glm::vec3 normal = direction * tangent.y - glm::vec3(0.0f, tangent.x, 0.0f);
+            if (glm::length(normal) > 0.0f)
+            {
+                normal = glm::normalize(normal);
+            }
+            mesh.addVertex(direction * point.x + glm::vec3(0.0f, point.y, 0.0f), normal);
+        }
+    }
+
+    for (int iStack = 0; iStack < stacks; iStack++)
+    {
+        for (int iSlice = 0; iSlice < slices; iSlice++)
+        {
+            GLuint corner = iStack * rowLength + iSlice;
+            mesh.addQuad(corner, corner + 1, corner + rowLength + 1, corner + rowLength);
+        }
+    }
+
+    if (caps)
+    {
+        for (int iCap = 0; iCap < 2; iCap++)
+        {
+            glm::vec2 edge = profile((float)iCap);
+            if (edge.x <= 0.0f)
+            {
+                continue;
+            }
+
+            glm::vec3 normal(0.0f, iCap == 0 ? -1.0f : 1.0f, 0.0f);
+            GLuint center = mesh.addVertex(glm::vec3(0.0f, edge.y, 0.0f), normal);
+            GLuint firstRim = (GLuint)mesh.vertexCount();
+            for (int iSlice = 0; iSlice <= slices; iSlice++)
+            {
+                float angle = twoPi * iSlice / (float)slices;
+                mesh.addVertex(glm::vec3(cosf(angle) * edge.x, edge.y, sinf(angle) * edge.x), normal);
+            }
+            for (int iSlice = 0; iSlice < slices; iSlice++)
+            {
+                if (iCap == 0)
+                    mesh.addTriangle(center, firstRim + iSlice + 1, firstRim + iSlice);
+                else
+                    mesh.addTriangle(center, firstRim + iSlice, firstRim + iSlice + 1);
+            }
+        }
+    }
+
+    return mesh;
+}
+
+struct SphereProfile
+{
+    glm::vec2 operator()(float t) const
+    {
+        float angle = 3.14159265f * (t - 0.5f);
+        return glm::vec2(cosf(angle), sinf(angle));
+    }
+};
+
+struct CylinderProfile
+{
+    glm::vec2 operator()(float t) const { return glm::vec2(1.0f, t * 2.0f - 1.0f); }
+};
+
+// Unit sphere; tessellation is the number of stacks, slices are twice that.
+inline Mesh GenerateSphere(int tessellation)
+{
+    tessellation = std::max(tessellation, 2);
+    return GenerateRevolution(tessellation * 2, tessellation, SphereProfile(), false);
+}
+
+// Radius 1, y in [-1, 1].
+inline Mesh GenerateCylinder(int tessellation)
+{
+    tessellation = std::max(tessellation, 3);
+    return GenerateRevolution(tessellation, std::max(tessellation / 4, 1), CylinderProfile(), true);
+}
+
+// n-sided prism, radius 1, y in [-1, 1]. Four sides is the chapter 04/05 box.
+inline Mesh GeneratePrism(int sides, int tessellation)
+{
+    sides = std::max(sides, 3);
+    tessellation = std::max(tessellation, 1);
+    return GenerateRevolution(sides, tessellation, CylinderProfile(), true);
+}
+
+// Torus around the y axis with major radius 1.
+inline Mesh GenerateTorus(int tessellation, float minorRadius = 0.3f)
+{
+    tessellation = std::max(tessellation, 3);
+    int majorSegments = tessellation * 2;
+    int minorSegments = tessellation;
+    const float twoPi = 3.14159265f * 2.0f;
+
+    Mesh mesh;
+    int rowLength = minorSegments + 1;
+    for (int iMajor = 0; iMajor <= majorSegments; iMajor++)
+    {
+        float majorAngle = twoPi * iMajor / (float)majorSegments;
+        glm::vec3 ringDirection(cosf(majorAngle), 0.0f, sinf(majorAngle));
+
+        for (int iMinor = 0; iMinor <= minorSegments; iMinor++)
+        {
+            float minorAngle = twoPi * iMinor / (float)minorSegments;
+            glm::vec3 normal = ringDirection * cosf(minorAngle) + glm::vec3(0.0f, sinf(minorAngle), 0.0f);
+            mesh.addVertex(ringDirection + normal * minorRadius, normal);
+        }
+    }
+
+    for (int iMajor = 0; iMajor < majorSegments; iMajor++)
+    {
+        for (int iMinor = 0; iMinor < minorSegments; iMinor++)
+        {
+            GLuint corner = iMajor * rowLength + iMinor;
+            mesh.addQuad(corner, corner + rowLength, corner + rowLength + 1, corner + 1);
+        }
+    }
+
+    return mesh;
+}
+
+enum MeshShape
+{
+    MeshShapeBox,
+    MeshShapePrism,
+    MeshShapeSphere,
+    MeshShapeCylinder,
+    MeshShapeTorus,
+    MeshShapeGrid,
+};
+
+inline Mesh GenerateShape(MeshShape shape, int tessellation)
+{
+    switch (shape)
+    {
+        case MeshShapeBox: return GenerateBox(tessellation);
+        case MeshShapePrism: return GeneratePrism(6, tessellation);
+        case MeshShapeSphere: return GenerateSphere(tessellation);
+        case MeshShapeCylinder: return GenerateCylinder(tessellation);
+        case MeshShapeTorus: return GenerateTorus(tessellation);
+        case MeshShapeGrid: return GenerateGrid(tessellation);
+    }
+    return Mesh();
+}
+
+// Same shape at halving tessellations. Level i is meant for objects whose
+// projected radius is at least minPixelRadius[i].
+struct MeshLodChain
+{
+    std::vector<Mesh> levels;
+    std::vector<float> minPixelRadius;
+    float boundingRadius;
+};
+
+// The finest level is used down to finestPixelRadius, every coarser level
+// covers half the screen size of the previous one.
+inline MeshLodChain BuildLodChain(MeshShape shape, int finestTessellation, int levelCount,
+                                  float finestPixelRadius = 200.0f)
+{
+    MeshLodChain chain;
+    int tessellation = finestTessellation;
+    float pixelRadius = finestPixelRadius;
+
+    for (int iLevel = 0; iLevel < levelCount; iLevel++)
+    {
+        chain.levels.push_back(GenerateShape(shape, tessellation));
+        chain.minPixelRadius.push_back(iLevel == levelCount - 1 ? 0.0f : pixelRadius);
+
+        tessellation = std::max(tessellation / 2, 1);
+        pixelRadius *= 0.5f;
+    }
+
+    chain.boundingRadius = chain.levels.empty() ? 0.0f : chain.levels[0].boundingRadius();
+    return chain;
+}
+
+// Radius in pixels of a sphere at cameraSpaceCenter once projected through
+// cameraToClipMatrix onto a viewport viewportHeight pixels tall.
+inline float ProjectedPixelRadius(const glm::mat4 &cameraToClipMatrix, const glm::vec3 &cameraSpaceCenter,
+                                  float radius, int viewportHeight)
+{
+    float depth = -cameraSpaceCenter.z;
+    if (depth <= radius)
+    {
+        return 1e30f;   // camera inside or touching the sphere
+    }
+    return radius * cameraToClipMatrix[1].y / depth * (viewportHeight * 0.5f);
+}
+
+inline int SelectLod(const MeshLodChain &chain, const glm::mat4 &cameraToClipMatrix,
+                     const glm::vec3 &cameraSpaceCenter, float scale, int viewportHeight)
+{
+    float pixelRadius = ProjectedPixelRadius(cameraToClipMatrix, cameraSpaceCenter,
+                                             chain.boundingRadius * scale, viewportHeight);
+
+    for (size_t iLevel = 0; iLevel < chain.minPixelRadius.size(); iLevel++)
+    {
+        if (pixelRadius >= chain.minPixelRadius[iLevel])
+        {
+            return (int)iLevel;
+        }
+    }
+    return (int)chain.minPixelRadius.size() - 1;
+}
+
+// Uploads a Mesh into a VBO/IBO/VAO with positions and colors at the given
+// attribute locations, the same way the chapters set up their arrays.
+// Moves but does not copy; the GL objects go with it.
+struct MeshBuffers
+{
+    MeshBuffers() : indexCount(0) {}
+
+    void upload(const Mesh &mesh, GLuint positionAttribute, GLuint colorAttribute)
+    {
+        size_t positionBytes = mesh.positions.size() * sizeof(float);
+        size_t colorBytes = mesh.colors.size() * sizeof(float);
+
+        vertexBufferObject.create();
+        vertexBufferObject.bufferData(GL_ARRAY_BUFFER, positionBytes + colorBytes, NULL, GL_STATIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, positionBytes, mesh.positions.data());
+        glBufferSubData(GL_ARRAY_BUFFER, positionBytes, colorBytes, mesh.colors.data());
+
+        indexBufferObject.create(GPUIndexData);
+        vertexArrayObject.create();
+        glBindVertexArray(vertexArrayObject);
+
+        glEnableVertexAttribArray(positionAttribute);
+        glEnableVertexAttribArray(colorAttribute);
+        glVertexAttribPointer(positionAttribute, 3, GL_FLOAT, GL_FALSE, 0, 0);
+        glVertexAttribPointer(colorAttribute, 4, GL_FLOAT, GL_FALSE, 0, (void*)positionBytes);
+
+        indexBufferObject.bufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(GLuint), mesh.indices.data(),
+                                     GL_STATIC_DRAW);
+
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        indexCount = (GLsizei)mesh.indices.size();
+    }
+
+    void draw() const
+    {
+        glBindVertexArray(vertexArrayObject);
+        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+    }
+
+    void destroy()
+    {
+        vertexArrayObject.reset();
+        indexBufferObject.reset();
+        vertexBufferObject.reset();
+        indexCount = 0;
+    }
+
+    GLBuffer vertexBufferObject;
+    GLBuffer indexBufferObject;
+    GLVertexArray vertexArrayObject;
+    GLsizei indexCount;
+};
+
+#endif
@@ -0,0 +1,157 @@
+//
+//  microbenchmark.h
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+
+#ifndef gltut_glfw_microbenchmark_h
+#define gltut_glfw_microbenchmark_h
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+// Timings of the CPU math the scenes run every frame, without a GL context.
+//
+// A chapter registers benchmarks for its own functions next to them, so
+// they measure the code the scene runs and not a copy of it:
+//
+//  REGISTER_MICROBENCHMARK("06d MatrixStack Translate", [](int iterations) {
+//      MatrixStack stack;
+//      for (int iIteration = 0; iIteration < iterations; iIteration++)
+//          stack.Translate(glm::vec3(iIteration, 0.0f, 0.0f));
+//      DoNotOptimize(stack.Top());
+//  });
+//
+// main.cpp --microbench runs them pinned to one core. Each body runs until
+// its iteration count fills a sample of a few milliseconds, which also
+// warms caches and branch predictors, and is then timed over several
+// samples. The median is reported since the fastest and slowest samples
+// mostly measure the machine rather than the code.
+
+typedef std::function<void(int iterations)> MicrobenchmarkBody;
+
+// Keeps value, and everything it depends on, from being optimized away
+template <typename T>
+inline void DoNotOptimize(const T &value)
+{
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+// Time stamp counter ticks on x86, which run at the nominal clock rate
+// whatever the core's current one. Zero where there is no such counter.
+inline unsigned long long ReadCycleCounter()
+{
+#if defined(__i386__) || defined(__x86_64__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+struct MicrobenchmarkResult
+{
+    int iterations;
+    double medianNanoseconds;
+    double minimumNanoseconds;
+    double medianCycles;
+};
+
+inline MicrobenchmarkResult RunMicrobenchmark(const MicrobenchmarkBody &body, double sampleSeconds, int sampleCount)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    // Double the iterations until one sample is long enough to time
+    int iterations = 1;
+    while (true)
+    {
+        Clock::time_point start = Clock::now();
+        body(iterations);
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if (seconds >= sampleSeconds || iterations >= (1 << 28))
+            break;
+        iterations *= 2;
+    }
+
+    std::vector<double> nanoseconds(sampleCount);
+    std::vector<double> cycles(sampleCount);
+    for (int iSample = 0; iSample < sampleCount; iSample++)
+    {
+        unsigned long long startCycles = ReadCycleCounter();
+        Clock::time_point start = Clock::now();
+        body(iterations);
+        Clock::time_point end = Clock::now();
+        unsigned long long endCycles = ReadCycleCounter();
+
+        nanoseconds[iSample] = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+        cycles[iSample] = (double)(endCycles - startCycles) / iterations;
+    }
+
+    std::sort(nanoseconds.begin(), nanoseconds.end());
+    std::sort(cycles.begin(), cycles.end());
+    MicrobenchmarkResult result = { iterations, nanoseconds[sampleCount / 2], nanoseconds[0], cycles[sampleCount / 2] };
+    return result;
+}
+
+class MicrobenchmarkRegistry
+{
+  public:
+    // Kept sorted by name, like the scene registry
+    void add(const std::string &name, const MicrobenchmarkBody &body)
+    {
+        Registration registration = { name, body };
+        _registrations.insert(std::upper_bound(_registrations.begin(), _registrations.end(), registration, nameLess),
+                              registration);
+    }
+
+    int size() const { return (int)_registrations.size(); }
+    const std::string &name(int index) const { return _registrations[index].name; }
+    const MicrobenchmarkBody &body(int index) const { return _registrations[index].body; }
+
+  private:
+    struct Registration
+    {
+        std::string name;
+        MicrobenchmarkBody body;
+    };
+
+    static bool nameLess(const Registration &first, const Registration &second)
+    {
+        return first.name < second.name;
+    }
+
+    std::vector<Registration> _registrations;
+};
+
+inline MicrobenchmarkRegistry &sharedMicrobenchmarkRegistry()
+{
+    static MicrobenchmarkRegistry registry;
+    return registry;
+}
+
+struct MicrobenchmarkRegistrar
+{
+    MicrobenchmarkRegistrar(const char *name, const MicrobenchmarkBody &body)
+    {
+        sharedMicrobenchmarkRegistry().add(name, body);
+    }
+};
+
+#define MICROBENCHMARK_CONCATENATE_(first, second) first##second
+#define MICROBENCHMARK_CONCATENATE(first, second) MICROBENCHMARK_CONCATENATE_(first, second)
+
+// Use at namespace scope, any number of times per file. Variadic so the
+// body can contain unparenthesized commas.
+#define REGISTER_MICROBENCHMARK(name, ...) \
+    MicrobenchmarkRegistrar MICROBENCHMARK_CONCATENATE(microbenchmarkRegistrar, __LINE__)(name, __VA_ARGS__)
+
+#endif
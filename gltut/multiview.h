@@ -0,0 +1,157 @@
+//
+//  multiview.h
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+
+#ifndef gltut_glfw_multiview_h
+#define gltut_glfw_multiview_h
+
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+#include "glm.hpp"
+
+#include "gpuresource.h"
+
+// Renders a scene from several cameras into a grid of tiles in one pass.
+//
+// The scene is traversed once. Each draw is issued instanced, one instance
+// per view, and the vertex shader uses gl_InstanceID to pick that view's
+// camera-to-clip matrix and tile from a uniform block. GL 3.2 has no
+// viewport arrays, so the shader squeezes the clip position into the tile
+// and writes four clip distances at the tile edges to keep geometry from
+// spilling into its neighbours:
+//
+//  layout(std140) uniform MultiView
+//  {
+//      mat4 cameraToClipMatrices[16];
+//      vec4 viewportTransforms[16];    // xy scale, zw offset in NDC
+//  };
+//
+//  vec4 clipPos = cameraToClipMatrices[gl_InstanceID] * cameraPos;
+//  gl_ClipDistance[0] = clipPos.w + clipPos.x;     // ... and -x, +y, -y
+//  vec4 tile = viewportTransforms[gl_InstanceID];
+//  gl_Position = vec4(clipPos.xy * tile.xy + tile.zw * clipPos.w, clipPos.zw);
+
+class MultiViewRenderer
+{
+  public:
+    static const int maxViews = 16;
+
+    MultiViewRenderer()
+    : _bindingPoint(0)
+    , _viewCount(1)
+    , _columns(1)
+    , _rows(1)
+    {
+    }
+
+    // Deletes the buffer; the next init() makes a new one
+    void destroy()
+    {
+        _uniformBuffer.reset();
+    }
+
+    // Connects the program's MultiView block to the buffer this object owns
+    void init(GLuint program, GLuint bindingPoint = 0, const char *blockName = "MultiView")
+    {
+        _bindingPoint = bindingPoint;
+
+        GLuint blockIndex = glGetUniformBlockIndex(program, blockName);
+        glUniformBlockBinding(program, blockIndex, _bindingPoint);
+
+        if (_uniformBuffer == 0)
+        {
+            _uniformBuffer.create(GPUUniformData);
+            _uniformBuffer.bufferData(GL_UNIFORM_BUFFER, sizeof(MultiViewBlock), NULL, GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+    }
+
+    // Picks the smallest near-square grid that fits viewCount tiles
+    void setViewCount(int viewCount)
+    {
+        _viewCount = std::max(1, std::min(viewCount, (int)maxViews));
+        _columns = (int)ceilf(sqrtf((float)_viewCount));
+        _rows = (_viewCount + _columns - 1) / _columns;
+    }
+
+    int viewCount() const { return _viewCount; }
+    int columns() const { return _columns; }
+    int rows() const { return _rows; }
+
+    // Width over height of one tile of a framebuffer this size
+    float tileAspectRatio(int width, int height) const
+    {
+        return (width / (float)_columns) / (height / (float)_rows);
+    }
+
+    // One matrix per view; tiles are filled left to right, top to bottom
+    void setCameraToClipMatrices(const std::vector<glm::mat4> &cameraToClipMatrices)
+    {
+        int viewCount = std::min((int)cameraToClipMatrices.size(), _viewCount);
+        for (int iView = 0; iView < viewCount; iView++)
+        {
+            int column = iView % _columns;
+            int row = iView / _columns;
+
+            _block.cameraToClipMatrices[iView] = cameraToClipMatrices[iView];
+            _block.viewportTransforms[iView] = glm::vec4(1.0f / _columns,
+                                                         1.0f / _rows,
+                                                         -1.0f + (2.0f * column + 1.0f) / _columns,
+                                                         1.0f - (2.0f * row + 1.0f) / _rows);
+        }
+
+        glBindBuffer(GL_UNIFORM_BUFFER, _uniformBuffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(MultiViewBlock), &_block);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    void beginPass()
+    {
+        glBindBufferBase(GL_UNIFORM_BUFFER, _bindingPoint, _uniformBuffer);
+        for (int iPlane = 0; iPlane < 4; iPlane++)
+        {
+            glEnable(GL_CLIP_DISTANCE0 + iPlane);
+        }
+    }
+
+    void endPass()
+    {
+        for (int iPlane = 0; iPlane < 4; iPlane++)
+        {
+            glDisable(GL_CLIP_DISTANCE0 + iPlane);
+        }
+    }
+
+    // Same arguments as glDrawElements; draws once per view
+    void drawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid *indices)
+    {
+        glDrawElementsInstanced(mode, count, type, indices, _viewCount);
+    }
+
+  private:
+    // std140 layout: a mat4 array has a 64 byte stride, a vec4 array 16
+    struct MultiViewBlock
+    {
+        glm::mat4 cameraToClipMatrices[maxViews];
+        glm::vec4 viewportTransforms[maxViews];
+    };
+
+    MultiViewRenderer(const MultiViewRenderer &);
+    MultiViewRenderer &operator=(const MultiViewRenderer &);
+
+    GLBuffer _uniformBuffer;
+    GLuint _bindingPoint;
+    int _viewCount;
+    int _columns;
+    int _rows;
+    MultiViewBlock _block;
+};
+
+#endif
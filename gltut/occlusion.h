@@ -0,0 +1,289 @@
+//
+//  occlusion.h
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+
+#ifndef gltut_glfw_occlusion_h
+#define gltut_glfw_occlusion_h
+
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "glcapabilities.h"
+#include "gpuresource.h"
+
+// Hardware occlusion culling for expensive groups of draws.
+//
+// Before drawing a group, the scene draws a cheap bounding proxy with color
+// and depth writes off inside an occlusion query. Depending on the policy the
+// real draws are then either skipped on the CPU when the proxy was hidden a
+// few frames ago (no stall, one frame of latency) or wrapped in
+// glBeginConditionalRender so the GPU drops them itself.
+//
+//  if (occlusion.beginObject(objectId, drawProxy))
+//  {
+//      ...real draws...
+//  }
+//  occlusion.endObject(objectId);
+
+// Any-samples queries may stop counting at the first sample that passes;
+// 3.2 contexts only have the counting kind
+inline GLenum OcclusionQueryTarget()
+{
+#ifdef GL_ANY_SAMPLES_PASSED
+    if (sharedGLCapabilities().anySamplesPassed)
+    {
+        return GL_ANY_SAMPLES_PASSED;
+    }
+#endif
+    return GL_SAMPLES_PASSED;
+}
+
+enum OcclusionPolicy
+{
+    OcclusionPolicyDisabled,            // always draw, no queries
+    OcclusionPolicyPreviousFrame,       // CPU skips groups whose last finished query failed
+    OcclusionPolicyConditionalNoWait,   // GPU skips, draws anyway if the result is late
+    OcclusionPolicyConditionalWait,     // GPU skips, waits for this frame's result
+};
+
+struct OcclusionStats
+{
+    int queriesIssued;
+    int objectsSkipped;     // dropped on the CPU
+    int conditionalDraws;   // left for the GPU to decide
+};
+
+// Recycles query objects instead of generating and deleting them per frame.
+class OcclusionQueryPool
+{
+  public:
+    explicit OcclusionQueryPool(size_t batchSize = 32)
+    : _batchSize(batchSize)
+    {
+    }
+
+    ~OcclusionQueryPool()
+    {
+        destroy();
+    }
+
+    // Deletes every query, for before the context goes
+    void destroy()
+    {
+        _allQueries.clear();
+        _freeQueries.clear();
+    }
+
+    GLuint acquire()
+    {
+        if (_freeQueries.empty())
+        {
+            std::vector<GLuint> batch(_batchSize);
+            glGenQueries((GLsizei)_batchSize, &batch[0]);
+            for (size_t iQuery = 0; iQuery < batch.size(); iQuery++)
+            {
+                _allQueries.push_back(GLQuery());
+                _allQueries.back().reset(batch[iQuery]);
+                _freeQueries.push_back(batch[iQuery]);
+            }
+        }
+
+        GLuint query = _freeQueries.back();
+        _freeQueries.pop_back();
+        return query;
+    }
+
+    void release(GLuint query)
+    {
+        _freeQueries.push_back(query);
+    }
+
+    size_t size() const { return _allQueries.size(); }
+
+  private:
+    size_t _batchSize;
+    std::vector<GLQuery> _allQueries;
+    std::vector<GLuint> _freeQueries;
+};
+
+class OcclusionCuller
+{
+  public:
+    OcclusionCuller()
+    : _policy(OcclusionPolicyPreviousFrame)
+    , _maxQueriesInFlight(3)
+    , _conditionalRenderActive(false)
+    {
+        resetStats();
+    }
+
+    void setPolicy(OcclusionPolicy policy) { _policy = policy; }
+    OcclusionPolicy policy() const { return _policy; }
+
+    // How many frames of queries an object may have outstanding before no
+    // new proxy is issued for it. More hides more latency, but visibility
+    // changes show up later.
+    void setMaxQueriesInFlight(int maxQueriesInFlight) { _maxQueriesInFlight = maxQueriesInFlight > 0 ? maxQueriesInFlight : 1; }
+    int maxQueriesInFlight() const { return _maxQueriesInFlight; }
+
+    const OcclusionStats &stats() const { return _stats; }
+    const OcclusionQueryPool &queryPool() const { return _queryPool; }
+
+    // Deletes the queries and forgets every object's visibility; the next
+    // frame starts over
+    void destroy()
+    {
+        _objects.clear();
+        _queryPool.destroy();
+    }
+
+    // Forgets every object's visibility, keeping the queries. Call when the
+    // projection changes (a resize, or the next tile of a poster), since the
+    // old results were measured against a different view.
+    void resetHistory()
+    {
+        for (std::map<int, ObjectState>::iterator iObject = _objects.begin(); iObject != _objects.end(); ++iObject)
+        {
+            std::deque<GLuint> &pendingQueries = iObject->second.pendingQueries;
+            for (size_t iQuery = 0; iQuery < pendingQueries.size(); iQuery++)
+            {
+                _queryPool.release(pendingQueries[iQuery]);
+            }
+        }
+        _objects.clear();
+    }
+
+    // Call once per frame before the first beginObject().
+    void beginFrame()
+    {
+        resetStats();
+    }
+
+    // Draws the proxy under a query and returns whether the real draws should
+    // be submitted. drawProxy() must only issue the bounding geometry; the
+    // writes it would do are masked here.
+    template <typename ProxyFunc>
+    bool beginObject(int objectId, ProxyFunc drawProxy)
+    {
+        if (_policy == OcclusionPolicyDisabled)
+        {
+            return true;
+        }
+
+        ObjectState &object = _objects[objectId];
+        collectResults(object);
+
+        GLuint query = 0;
+        if ((int)object.pendingQueries.size() < _maxQueriesInFlight)
+        {
+            query = _queryPool.acquire();
+            issueProxy(query, drawProxy);
+            object.pendingQueries.push_back(query);
+        }
+
+        if (_policy == OcclusionPolicyPreviousFrame)
+        {
+            if (!object.visible)
+            {
+                _stats.objectsSkipped++;
+            }
+            return object.visible;
+        }
+
+        // Conditional modes need a query from this frame to render against
+        if (query != 0)
+        {
+            glBeginConditionalRender(query, _policy == OcclusionPolicyConditionalWait ? GL_QUERY_WAIT : GL_QUERY_NO_WAIT);
+            _conditionalRenderActive = true;
+            _stats.conditionalDraws++;
+        }
+        return true;
+    }
+
+    void endObject(int)
+    {
+        if (_conditionalRenderActive)
+        {
+            glEndConditionalRender();
+            _conditionalRenderActive = false;
+        }
+    }
+
+  private:
+    struct ObjectState
+    {
+        ObjectState() : visible(true) {}
+
+        std::deque<GLuint> pendingQueries;
+        bool visible;
+    };
+
+    void resetStats()
+    {
+        _stats.queriesIssued = 0;
+        _stats.objectsSkipped = 0;
+        _stats.conditionalDraws = 0;
+    }
+
+    // Reads back every finished query without ever waiting on the GPU
+    void collectResults(ObjectState &object)
+    {
+        while (!object.pendingQueries.empty())
+        {
+            GLuint query = object.pendingQueries.front();
+            GLuint available = GL_FALSE;
+            glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+            {
+                break;
+            }
+
+            GLuint samplesPassed = 0;
+            glGetQueryObjectuiv(query, GL_QUERY_RESULT, &samplesPassed);
+            object.visible = samplesPassed != 0;
+
+            object.pendingQueries.pop_front();
+            _queryPool.release(query);
+        }
+    }
+
+    template <typename ProxyFunc>
+    void issueProxy(GLuint query, ProxyFunc drawProxy)
+    {
+        // Back faces too, so the proxy still counts when the camera is inside it
+        GLboolean cullFaceEnabled = glIsEnabled(GL_CULL_FACE);
+        glDisable(GL_CULL_FACE);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_FALSE);
+
+        GLenum target = OcclusionQueryTarget();
+        glBeginQuery(target, query);
+        drawProxy();
+        glEndQuery(target);
+
+        glDepthMask(GL_TRUE);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        if (cullFaceEnabled)
+        {
+            glEnable(GL_CULL_FACE);
+        }
+
+        _stats.queriesIssued++;
+    }
+
+    OcclusionPolicy _policy;
+    int _maxQueriesInFlight;
+    bool _conditionalRenderActive;
+
+    OcclusionQueryPool _queryPool;
+    std::map<int, ObjectState> _objects;
+    OcclusionStats _stats;
+};
+
+#endif
@@ -0,0 +1,322 @@
+//
+//  offlinerenderer.h
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+
+#ifndef gltut_glfw_offlinerenderer_h
+#define gltut_glfw_offlinerenderer_h
+
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "offscreentarget.h"
+
+// Renders the frames of an animation on several GL contexts at once.
+//
+// A frame of a time-driven scene (06a-06c) depends only on its time, so
+// frames can be drawn in any order and on any context. Each worker thread
+// makes one context current, builds its own instance of the scene in it,
+// and claims frame indices until none are left, so every frame is drawn
+// exactly once. Finished frames go to an OrderedFrameSink, which writes
+// them in index order.
+//
+// GLFW creates contexts on the main thread only, so the caller creates one
+// hidden window per worker and passes them in:
+//
+//  OrderedFrameSink sink(WritePPMFiles("frame%05d.ppm"), settings.width, settings.height, settings.firstFrame, 8);
+//  OfflineRenderer renderer;
+//  renderer.render(factory, contexts, settings, sink);
+//
+// Scenes keep their GL objects in members, or in the ChapterState they
+// create in init(), so every worker's instance owns its own. Most still
+// keep uniform locations and matrices in file-scope globals, set by init()
+// and reshape(), so those two run one worker at a time, and nobody
+// draws until every worker has set up (or deletes its scene until every
+// worker is done drawing). Only draw() runs concurrently, and it reads
+// those globals without writing them.
+// Scenes that step a simulation from frame to frame (03e) depend on the
+// order of their own frames and do not render correctly this way.
+
+struct OfflineRenderSettings
+{
+    int width;
+    int height;
+    int firstFrame;
+    int frameCount;
+    double framesPerSecond;
+};
+
+// Receives each frame as tightly packed RGBA rows, bottom row first
+typedef std::function<bool(int frameIndex, int width, int height, const std::vector<unsigned char> &pixels)> FrameWriter;
+
+// Binary PPM, top row first, alpha dropped
+inline bool WritePPM(FILE *file, int width, int height, const std::vector<unsigned char> &pixels)
+{
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    std::vector<unsigned char> row(width * 3);
+    for (int y = height - 1; y >= 0; y--)
+    {
+        const unsigned char *source = &pixels[(size_t)y * width * 4];
+        for (int x = 0; x < width; x++)
+        {
+            row[x * 3 + 0] = source[x * 4 + 0];
+            row[x * 3 + 1] = source[x * 4 + 1];
+            row[x * 3 + 2] = source[x * 4 + 2];
+        }
+        fwrite(&row[0], 1, row.size(), file);
+    }
+    return !ferror(file);
+}
+
+// One file per frame; pattern is a printf format taking the frame index
+inline FrameWriter WritePPMFiles(const std::string &pattern)
+{
+    return [pattern](int frameIndex, int width, int height, const std::vector<unsigned char> &pixels) -> bool {
+        char filename[1024];
+        snprintf(filename, sizeof(filename), pattern.c_str(), frameIndex);
+        FILE *file = fopen(filename, "wb");
+        if (file == NULL)
+        {
+            fprintf(stderr, "Could not write %s\n", filename);
+            return false;
+        }
+        bool written = WritePPM(file, width, height, pixels);
+        return fclose(file) == 0 && written;
+    };
+}
+
+// Every frame back to back on one stream, for piping into an encoder
+inline FrameWriter WritePPMStream(FILE *stream)
+{
+    return [stream](int, int width, int height, const std::vector<unsigned char> &pixels) -> bool {
+        return WritePPM(stream, width, height, pixels) && fflush(stream) == 0;
+    };
+}
+
+// Takes frames in any order and hands them to a writer thread in index
+// order. At most window frames are held at once: a worker that gets that
+// far ahead of the oldest unwritten frame waits in waitForSlot().
+class OrderedFrameSink
+{
+  public:
+    OrderedFrameSink(const FrameWriter &writer, int width, int height, int firstFrame, int window)
+    : _writer(writer)
+    , _width(width)
+    , _height(height)
+    , _nextFrame(firstFrame)
+    , _window(std::max(window, 1))
+    , _closed(false)
+    , _failed(false)
+    {
+        _writerThread = std::thread(&OrderedFrameSink::writeFrames, this);
+    }
+
+    ~OrderedFrameSink()
+    {
+        close();
+    }
+
+    // False once writing has failed; the frame should not be rendered
+    bool waitForSlot(int frameIndex)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _slotFreed.wait(lock, [&]() { return _failed || frameIndex < _nextFrame + _window; });
+        return !_failed;
+    }
+
+    void deliver(int frameIndex, std::vector<unsigned char> &pixels)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _pending[frameIndex].swap(pixels);
+        _frameArrived.notify_one();
+    }
+
+    // Call once nothing more will be delivered. Writes what can be written
+    // in order and returns the index after the last frame written.
+    int close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _closed = true;
+            _frameArrived.notify_one();
+        }
+        if (_writerThread.joinable())
+        {
+            _writerThread.join();
+        }
+        return _failed ? -1 : _nextFrame;
+    }
+
+  private:
+    OrderedFrameSink(const OrderedFrameSink &);
+    OrderedFrameSink &operator=(const OrderedFrameSink &);
+
+    void writeFrames()
+    {
+        std::vector<unsigned char> pixels;
+        while (true)
+        {
+            int frameIndex;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _frameArrived.wait(lock, [&]() {
+                    return _pending.count(_nextFrame) != 0 || _closed || _failed;
+                });
+                if (_pending.count(_nextFrame) == 0 || _failed)
+                {
+                    return;
+                }
+                frameIndex = _nextFrame;
+                pixels.swap(_pending[frameIndex]);
+                _pending.erase(frameIndex);
+            }
+
+            // The writer runs outside the lock so workers can keep delivering
+            bool written = _writer(frameIndex, _width, _height, pixels);
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            _failed = _failed || !written;
+            _nextFrame++;
+            _slotFreed.notify_all();
+        }
+    }
+
+    FrameWriter _writer;
+    int _width;
+    int _height;
+    int _nextFrame;
+    int _window;
+    bool _closed;
+    bool _failed;
+
+    std::map<int, std::vector<unsigned char> > _pending;
+    std::mutex _mutex;
+    std::condition_variable _frameArrived;
+    std::condition_variable _slotFreed;
+    std::thread _writerThread;
+};
+
+class OfflineRenderer
+{
+  public:
+    typedef std::function<SceneBase *()> SceneFactory;
+
+    OfflineRenderer() : _nextFrame(0), _workerCount(0), _barrierCount(0), _barrierGeneration(0) {}
+
+    // contexts must not be current on any thread. Returns once the workers
+    // are done, true if every frame was written. A context whose scene fails
+    // to initialize drops out and the others render its share.
+    bool render(const SceneFactory &factory, const std::vector<GLFWwindow *> &contexts,
+                const OfflineRenderSettings &settings, OrderedFrameSink &sink)
+    {
+        _nextFrame = settings.firstFrame;
+        _workerCount = (int)contexts.size();
+
+        std::vector<std::thread> workers;
+        for (size_t iContext = 0; iContext < contexts.size(); iContext++)
+        {
+            workers.push_back(std::thread(&OfflineRenderer::renderFrames, this, factory, contexts[iContext],
+                                          settings, std::ref(sink)));
+        }
+        for (size_t iWorker = 0; iWorker < workers.size(); iWorker++)
+        {
+            workers[iWorker].join();
+        }
+
+        return sink.close() == settings.firstFrame + settings.frameCount;
+    }
+
+  private:
+    OfflineRenderer(const OfflineRenderer &);
+    OfflineRenderer &operator=(const OfflineRenderer &);
+
+    void renderFrames(SceneFactory factory, GLFWwindow *context, OfflineRenderSettings settings, OrderedFrameSink &sink)
+    {
+        glfwMakeContextCurrent(context);
+        {
+            OffscreenTarget target;
+            SceneBase *scene = NULL;
+            {
+                std::lock_guard<std::mutex> lock(_setupMutex);
+                try
+                {
+                    if (target.resize(settings.width, settings.height))
+                    {
+                        scene = factory();
+                        scene->init();
+                        target.bind();
+                        glViewport(0, 0, settings.width, settings.height);
+                        scene->reshape(settings.width, settings.height);
+                    }
+                }
+                catch (std::exception &exception)
+                {
+                    fprintf(stderr, "Offline render: %s\n", exception.what());
+                    delete scene;
+                    scene = NULL;
+                }
+            }
+
+            synchronizeWorkers();
+
+            std::vector<unsigned char> pixels;
+            int endFrame = settings.firstFrame + settings.frameCount;
+            int frameIndex;
+            while (scene != NULL && (frameIndex = _nextFrame++) < endFrame && sink.waitForSlot(frameIndex))
+            {
+                scene->setFixedTime(frameIndex / settings.framesPerSecond);
+                target.bind();
+                scene->draw();
+                target.readPixels(pixels);
+                sink.deliver(frameIndex, pixels);
+            }
+
+            synchronizeWorkers();
+            if (scene != NULL)
+            {
+                std::lock_guard<std::mutex> lock(_setupMutex);
+                delete scene;
+            }
+            target.unbind();
+        }
+        glfwMakeContextCurrent(NULL);
+    }
+
+    // Blocks until every worker has reached the same point
+    void synchronizeWorkers()
+    {
+        std::unique_lock<std::mutex> lock(_setupMutex);
+        int generation = _barrierGeneration;
+        if (++_barrierCount == _workerCount)
+        {
+            _barrierCount = 0;
+            _barrierGeneration++;
+            _barrierReleased.notify_all();
+        }
+        else
+        {
+            _barrierReleased.wait(lock, [&]() { return generation != _barrierGeneration; });
+        }
+    }
+
+    std::atomic<int> _nextFrame;
+    std::mutex _setupMutex;
+    std::condition_variable _barrierReleased;
+    int _workerCount;
+    int _barrierCount;
+    int _barrierGeneration;
+};
+
+#endif
@@ -0,0 +1,122 @@
+//
+//  offscreentarget.h
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+
+#ifndef gltut_glfw_offscreentarget_h
+#define gltut_glfw_offscreentarget_h
+
+#include <vector>
+
+#include "gpuresource.h"
+
+// A color plus depth framebuffer of a fixed size, for rendering scenes
+// without drawing to the window: benchmarks at resolutions the window does
+// not have, and frames that are read back and written to disk.
+//
+//  target.resize(1920, 1080);
+//  target.bind();
+//  scene->reshape(1920, 1080);
+//  scene->draw();
+//  target.readPixels(pixels);
+//  target.unbind();
+//
+// Its buffers belong to the application rather than to the scene drawn.
+
+class OffscreenTarget
+{
+  public:
+    OffscreenTarget()
+    : _width(0)
+    , _height(0)
+    {
+    }
+
+    int width() const { return _width; }
+    int height() const { return _height; }
+
+    // Reallocates only when the size changes. False if the driver rejects the framebuffer.
+    bool resize(int width, int height)
+    {
+        if (_framebuffer != 0 && width == _width && height == _height)
+        {
+            return true;
+        }
+        destroy();
+        _width = width;
+        _height = height;
+
+        // 24 bit depth is stored in 32
+        size_t bytes = (size_t)width * height * 4;
+        _colorRenderbuffer.create(GPURenderTargets, GPUOwnedByApplication);
+        _colorRenderbuffer.setSize(bytes);
+        glBindRenderbuffer(GL_RENDERBUFFER, _colorRenderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+        _depthRenderbuffer.create(GPURenderTargets, GPUOwnedByApplication);
+        _depthRenderbuffer.setSize(bytes);
+        glBindRenderbuffer(GL_RENDERBUFFER, _depthRenderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        _framebuffer.create(GPUFramebuffers, GPUOwnedByApplication);
+        glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _colorRenderbuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depthRenderbuffer);
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        printOpenGLError();
+
+        if (!complete)
+        {
+            fprintf(stderr, "Offscreen framebuffer %dx%d incomplete\n", width, height);
+            destroy();
+        }
+        return complete;
+    }
+
+    // Scenes set their own viewport in reshape()
+    void bind()
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+    }
+
+    void unbind()
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // Tightly packed RGBA rows, bottom row first
+    void readPixels(std::vector<unsigned char> &pixels)
+    {
+        pixels.resize((size_t)_width * _height * 4);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, _framebuffer);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        printOpenGLError();
+    }
+
+  private:
+    OffscreenTarget(const OffscreenTarget &);
+    OffscreenTarget &operator=(const OffscreenTarget &);
+
+    void destroy()
+    {
+        _framebuffer.reset();
+        _colorRenderbuffer.reset();
+        _depthRenderbuffer.reset();
+    }
+
+    int _width;
+    int _height;
+    GLFramebuffer _framebuffer;
+    GLRenderbuffer _colorRenderbuffer;
+    GLRenderbuffer _depthRenderbuffer;
+};
+
+#endif
@@ -0,0 +1,223 @@
+//
+//  posterrenderer.h
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+
+#ifndef gltut_glfw_posterrenderer_h
+#define gltut_glfw_posterrenderer_h
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "glm.hpp"
+
+#include "offscreentarget.h"
+
+// Renders a still far larger than any framebuffer by splitting the view
+// into tiles and writing them to a PPM file as they finish.
+//
+// Every tile is drawn with the full camera-to-clip matrix followed by a
+// scale and offset of clip space that makes the tile fill the target, so
+// the tiles are sub-frusta of the one view and line up without seams.
+// Scenes apply that extra matrix with SceneBase::clipTile().
+//
+// Tiles are drawn one band of rows at a time, top band first, which is
+// the order PPM scanlines are stored in. Each tile is read into a pixel
+// buffer object and copied out while the next tile draws. Memory use is
+// one band (width x tile height) plus two tiles, whatever the height.
+//
+//  PosterRenderer poster;
+//  poster.render(*scene, 16384, 16384, file);
+
+class PosterRenderer
+{
+  public:
+    PosterRenderer()
+    : _tileSize(1024)
+    , _imageWidth(0)
+    , _imageHeight(0)
+    , _bandHeight(0)
+    , _nextBuffer(0)
+    {
+        _pending[0].valid = _pending[1].valid = false;
+    }
+
+    // Clamped to what the driver can render to
+    void setTileSize(int tileSize) { _tileSize = tileSize; }
+    int tileSize() const { return _tileSize; }
+
+    // The scene must be initialized and its context current. False if the
+    // scene ignores clipTile() or a write fails.
+    bool render(SceneBase &scene, int width, int height, FILE *file)
+    {
+        GLint maxRenderbufferSize = 0;
+        GLint maxViewportSize[2] = { 0, 0 };
+        glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxRenderbufferSize);
+        glGetIntegerv(GL_MAX_VIEWPORT_DIMS, maxViewportSize);
+        int tileSize = std::min(_tileSize, (int)std::min(maxRenderbufferSize, std::min(maxViewportSize[0], maxViewportSize[1])));
+        tileSize = std::max(tileSize, 1);
+
+        if (!_target.resize(tileSize, tileSize))
+        {
+            return false;
+        }
+        createPackBuffers(tileSize);
+
+        _imageWidth = width;
+        _imageHeight = height;
+        _band.resize((size_t)width * tileSize * 3);
+
+        // The scene computes its aspect ratio from the full image
+        _target.bind();
+        glViewport(0, 0, tileSize, tileSize);
+        scene.setClipTile(glm::mat4(1.0f));
+        scene.reshape(width, height);
+        if (!scene.usesClipTile())
+        {
+            fprintf(stderr, "This scene does not support tiled rendering\n");
+            _target.unbind();
+            return false;
+        }
+
+        fprintf(file, "P6\n%d %d\n255\n", width, height);
+
+        bool written = true;
+        for (int bandTop = height; bandTop > 0 && written; bandTop -= tileSize)
+        {
+            _bandHeight = std::min(tileSize, bandTop);
+
+            for (int tileLeft = 0; tileLeft < width; tileLeft += tileSize)
+            {
+                drawTile(scene, tileLeft, bandTop - tileSize, tileSize);
+            }
+
+            // The band's last tile has to land before the band is written
+            copyPendingTile(_nextBuffer);
+            copyPendingTile(1 - _nextBuffer);
+
+            written = fwrite(&_band[0], 1, (size_t)width * _bandHeight * 3, file) == (size_t)width * _bandHeight * 3;
+        }
+
+        scene.setClipTile(glm::mat4(1.0f));
+        _target.unbind();
+        printOpenGLError();
+        return written && !ferror(file);
+    }
+
+  private:
+    struct PendingTile
+    {
+        bool valid;
+        int left;
+        int width;
+        int height;
+    };
+
+    PosterRenderer(const PosterRenderer &);
+    PosterRenderer &operator=(const PosterRenderer &);
+
+    void createPackBuffers(int tileSize)
+    {
+        for (int iBuffer = 0; iBuffer < 2; iBuffer++)
+        {
+            if (_packBuffers[iBuffer] == 0)
+            {
+                _packBuffers[iBuffer].create(GPURenderTargets, GPUOwnedByApplication);
+            }
+            _packBuffers[iBuffer].bufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)tileSize * tileSize * 4, NULL, GL_STREAM_READ);
+            _pending[iBuffer].valid = false;
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    // Draws the tile whose lower left pixel is (left, bottom); bottom can
+    // be negative for the last band, whose rows below zero are discarded
+    void drawTile(SceneBase &scene, int left, int bottom, int tileSize)
+    {
+        float scaleX = _imageWidth / (float)tileSize;
+        float scaleY = _imageHeight / (float)tileSize;
+        float tileLeft = -1.0f + 2.0f * left / _imageWidth;
+        float tileBottom = -1.0f + 2.0f * bottom / _imageHeight;
+
+        // Maps the tile's part of clip space onto the whole target; applied
+        // before the perspective divide, so offsets scale with w
+        glm::mat4 clipTile(1.0f);
+        clipTile[0].x = scaleX;
+        clipTile[1].y = scaleY;
+        clipTile[3].x = -1.0f - tileLeft * scaleX;
+        clipTile[3].y = -1.0f - tileBottom * scaleY;
+
+        scene.setClipTile(clipTile);
+        scene.reshape(_imageWidth, _imageHeight);
+        _target.bind();
+        glViewport(0, 0, tileSize, tileSize);
+        scene.draw();
+
+        PendingTile &tile = _pending[_nextBuffer];
+        tile.left = left;
+        tile.width = std::min(tileSize, _imageWidth - left);
+        tile.height = _bandHeight;
+
+        // Rows below the image sit at the bottom of the target
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, _packBuffers[_nextBuffer]);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, tileSize - tile.height, tile.width, tile.height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        tile.valid = true;
+
+        // The previous tile's transfer overlapped with this tile's drawing
+        _nextBuffer = 1 - _nextBuffer;
+        copyPendingTile(_nextBuffer);
+    }
+
+    // Copies a finished tile into the band, flipping it to top row first
+    void copyPendingTile(int buffer)
+    {
+        PendingTile &tile = _pending[buffer];
+        if (!tile.valid)
+        {
+            return;
+        }
+        tile.valid = false;
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, _packBuffers[buffer]);
+        const unsigned char *pixels = (const unsigned char *)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+                                                                              (GLsizeiptr)tile.width * tile.height * 4,
+                                                                              GL_MAP_READ_BIT);
+        if (pixels != NULL)
+        {
+            for (int row = 0; row < tile.height; row++)
+            {
+                const unsigned char *source = pixels + (size_t)row * tile.width * 4;
+                unsigned char *destination = &_band[((size_t)(tile.height - 1 - row) * _imageWidth + tile.left) * 3];
+                for (int x = 0; x < tile.width; x++)
+                {
+                    destination[x * 3 + 0] = source[x * 4 + 0];
+                    destination[x * 3 + 1] = source[x * 4 + 1];
+                    destination[x * 3 + 2] = source[x * 4 + 2];
+                }
+            }
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    int _tileSize;
+    int _imageWidth;
+    int _imageHeight;
+    int _bandHeight;
+    int _nextBuffer;
+
+    OffscreenTarget _target;
+    GLBuffer _packBuffers[2];
+    PendingTile _pending[2];
+    std::vector<unsigned char> _band;
+};
+
+#endif
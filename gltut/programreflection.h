@@ -0,0 +1,419 @@
+//
+//  programreflection.h
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+
+#ifndef gltut_glfw_programreflection_h
+#define gltut_glfw_programreflection_h
+
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "glm.hpp"
+#include "gtc/type_ptr.hpp"
+
+#include "glcapabilities.h"
+
+// The active uniforms and attributes of a linked program, enumerated with
+// glGetActiveUniform and glGetActiveAttrib, and a CPU copy of every
+// uniform's last uploaded value. Typed handles upload through the copy and
+// skip values the program already holds, so a static parameter set every
+// frame costs a comparison instead of a GL call:
+//
+//  Uniform<glm::vec3> offsetUniform(program, "offset");    // once linked
+//  ...
+//  glUseProgram(program);
+//  offsetUniform.set(glm::vec3(0.0f, 0.0f, -1.0f));        // uploads once
+//
+// glhelpers.h reflects every program it links. A handle's set() writes to
+// the handle's own program, whichever program is in use: with
+// glProgramUniform where the context has it, otherwise by binding the
+// program around glUniform. A uniform set through a handle should not also
+// be set with glUniform, or the copy goes stale.
+//
+// Offline rendering links the same program under the same name in several
+// contexts at once, so reflections are kept per context. A handle keeps a
+// pointer to the reflection of the context it was made in, and only looks
+// its program up again when set() runs in another one. Reflecting a program
+// again, when a deleted program's name is reused, drops the old copy.
+
+struct ProgramVariable
+{
+    std::string name;       // without the "[0]" arrays are reported with
+    GLenum type;
+    GLint size;             // array elements
+    GLint location;         // -1 for uniforms in blocks
+    size_t shadowOffset;    // uniforms only
+};
+
+class ProgramReflection
+{
+  public:
+    ProgramReflection() : _program(0) {}
+
+    void reflect(GLuint program)
+    {
+        _program = program;
+        _uniforms.clear();
+        _attributes.clear();
+        _shadow.clear();
+        _known.clear();
+
+        GLint nameLength = 0;
+        GLint count = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &nameLength);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+        std::vector<GLchar> name(std::max(nameLength, 1) + 1);
+        for (GLint iUniform = 0; iUniform < count; iUniform++)
+        {
+            ProgramVariable uniform = ProgramVariable();
+            glGetActiveUniform(program, iUniform, (GLsizei)name.size(), NULL, &uniform.size, &uniform.type, &name[0]);
+            uniform.name = baseName(&name[0]);
+            uniform.location = glGetUniformLocation(program, uniform.name.c_str());
+            uniform.shadowOffset = _shadow.size();
+            _shadow.resize(_shadow.size() + valueSize(uniform.type) * std::max(uniform.size, 1));
+            _uniforms.push_back(uniform);
+        }
+        _known.assign(_uniforms.size(), false);
+
+        glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &nameLength);
+        glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+        name.resize(std::max(nameLength, 1) + 1);
+        for (GLint iAttribute = 0; iAttribute < count; iAttribute++)
+        {
+            ProgramVariable attribute = ProgramVariable();
+            glGetActiveAttrib(program, iAttribute, (GLsizei)name.size(), NULL, &attribute.size, &attribute.type, &name[0]);
+            attribute.name = baseName(&name[0]);
+            attribute.location = glGetAttribLocation(program, attribute.name.c_str());
+            attribute.shadowOffset = 0;
+            _attributes.push_back(attribute);
+        }
+    }
+
+    GLuint program() const { return _program; }
+    const std::vector<ProgramVariable> &uniforms() const { return _uniforms; }
+    const std::vector<ProgramVariable> &attributes() const { return _attributes; }
+
+    // Index into uniforms(), or -1 if the program has no such active uniform
+    int findUniform(const std::string &name) const { return find(_uniforms, name); }
+    int findAttribute(const std::string &name) const { return find(_attributes, name); }
+
+    // Records value as the uniform's first element; false if it held it already
+    bool update(int uniformIndex, const void *value, size_t size)
+    {
+        if (uniformIndex < 0 || uniformIndex >= (int)_uniforms.size())
+        {
+            // A handle made before the program was reflected again
+            return true;
+        }
+        unsigned char *shadow = &_shadow[_uniforms[uniformIndex].shadowOffset];
+        if (_known[uniformIndex] && memcmp(shadow, value, size) == 0)
+        {
+            return false;
+        }
+        memcpy(shadow, value, size);
+        _known[uniformIndex] = true;
+        return true;
+    }
+
+    // Bytes of one value of a GL type, as a handle hands it over
+    static size_t valueSize(GLenum type)
+    {
+        switch (type)
+        {
+            case GL_FLOAT_VEC2: case GL_INT_VEC2: return 2 * sizeof(GLint);
+            case GL_FLOAT_VEC3: case GL_INT_VEC3: return 3 * sizeof(GLint);
+            case GL_FLOAT_VEC4: case GL_INT_VEC4: return 4 * sizeof(GLint);
+            case GL_FLOAT_MAT3: return 9 * sizeof(GLfloat);
+            case GL_FLOAT_MAT4: return 16 * sizeof(GLfloat);
+            default: return sizeof(GLint);
+        }
+    }
+
+    static bool isSampler(GLenum type)
+    {
+        switch (type)
+        {
+            case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+            case GL_SAMPLER_1D_SHADOW: case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_CUBE_SHADOW:
+            case GL_SAMPLER_1D_ARRAY: case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_2D_ARRAY_SHADOW:
+            case GL_SAMPLER_2D_RECT: case GL_SAMPLER_BUFFER:
+            case GL_SAMPLER_2D_MULTISAMPLE: case GL_SAMPLER_2D_MULTISAMPLE_ARRAY:
+            case GL_INT_SAMPLER_2D: case GL_INT_SAMPLER_BUFFER:
+            case GL_UNSIGNED_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+  private:
+    static std::string baseName(const char *name)
+    {
+        std::string result(name);
+        if (result.size() > 3 && result.compare(result.size() - 3, 3, "[0]") == 0)
+        {
+            result.resize(result.size() - 3);
+        }
+        return result;
+    }
+
+    static int find(const std::vector<ProgramVariable> &variables, const std::string &name)
+    {
+        for (size_t iVariable = 0; iVariable < variables.size(); iVariable++)
+        {
+            if (variables[iVariable].name == name)
+            {
+                return (int)iVariable;
+            }
+        }
+        return -1;
+    }
+
+    GLuint _program;
+    std::vector<ProgramVariable> _uniforms;
+    std::vector<ProgramVariable> _attributes;
+    std::vector<unsigned char> _shadow;
+    std::vector<bool> _known;
+};
+
+// The reflections of every context's programs
+class ProgramReflectionRegistry
+{
+  public:
+    // Called by glhelpers.h once a program links
+    void reflect(GLuint program)
+    {
+        ProgramReflection reflection;
+        reflection.reflect(program);
+        std::lock_guard<std::mutex> lock(_mutex);
+        _reflections[key(program)] = reflection;
+    }
+
+    // The active uniform's index and description, reflecting programs that
+    // were not linked through glhelpers.h on first use; -1 if there is none.
+    // reflection is set to the current context's reflection of program,
+    // which stays at the same address for the life of the registry.
+    int findUniform(GLuint program, const std::string &name, ProgramVariable &uniform,
+                    ProgramReflection *&reflection)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        reflection = &reflectionFor(program);
+        int index = reflection->findUniform(name);
+        if (index >= 0)
+        {
+            uniform = reflection->uniforms()[index];
+        }
+        return index;
+    }
+
+    bool update(GLuint program, int uniformIndex, const void *value, size_t size)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return reflectionFor(program).update(uniformIndex, value, size);
+    }
+
+    // A copy, for listing what a program takes
+    ProgramReflection reflection(GLuint program)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return reflectionFor(program);
+    }
+
+  private:
+    // std::map, so reflections never move once made
+    typedef std::pair<GLFWwindow *, GLuint> Key;
+
+    static Key key(GLuint program) { return Key(glfwGetCurrentContext(), program); }
+
+    ProgramReflection &reflectionFor(GLuint program)
+    {
+        ProgramReflection &reflection = _reflections[key(program)];
+        if (reflection.program() != program)
+        {
+            reflection.reflect(program);
+        }
+        return reflection;
+    }
+
+    std::mutex _mutex;
+    std::map<Key, ProgramReflection> _reflections;
+};
+
+inline ProgramReflectionRegistry &sharedProgramReflections()
+{
+    static ProgramReflectionRegistry registry;
+    return registry;
+}
+
+// How each handle type is checked against the reflected GL type and uploaded
+template <typename T> struct UniformTraits;
+
+template <> struct UniformTraits<float>
+{
+    static bool accepts(GLenum type) { return type == GL_FLOAT; }
+    static void upload(GLint location, const float &value) { glUniform1f(location, value); }
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_separate_shader_objects)
+    static void upload(GLuint program, GLint location, const float &value) { glProgramUniform1f(program, location, value); }
+#endif
+};
+
+// Integers, booleans and samplers' texture units
+template <> struct UniformTraits<int>
+{
+    static bool accepts(GLenum type)
+    {
+        return type == GL_INT || type == GL_BOOL || ProgramReflection::isSampler(type);
+    }
+    static void upload(GLint location, const int &value) { glUniform1i(location, value); }
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_separate_shader_objects)
+    static void upload(GLuint program, GLint location, const int &value) { glProgramUniform1i(program, location, value); }
+#endif
+};
+
+template <> struct UniformTraits<glm::vec2>
+{
+    static bool accepts(GLenum type) { return type == GL_FLOAT_VEC2; }
+    static void upload(GLint location, const glm::vec2 &value) { glUniform2fv(location, 1, glm::value_ptr(value)); }
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_separate_shader_objects)
+    static void upload(GLuint program, GLint location, const glm::vec2 &value) { glProgramUniform2fv(program, location, 1, glm::value_ptr(value)); }
+#endif
+};
+
+template <> struct UniformTraits<glm::vec3>
+{
+    static bool accepts(GLenum type) { return type == GL_FLOAT_VEC3; }
+    static void upload(GLint location, const glm::vec3 &value) { glUniform3fv(location, 1, glm::value_ptr(value)); }
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_separate_shader_objects)
+    static void upload(GLuint program, GLint location, const glm::vec3 &value) { glProgramUniform3fv(program, location, 1, glm::value_ptr(value)); }
+#endif
+};
+
+template <> struct UniformTraits<glm::vec4>
+{
+    static bool accepts(GLenum type) { return type == GL_FLOAT_VEC4; }
+    static void upload(GLint location, const glm::vec4 &value) { glUniform4fv(location, 1, glm::value_ptr(value)); }
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_separate_shader_objects)
+    static void upload(GLuint program, GLint location, const glm::vec4 &value) { glProgramUniform4fv(program, location, 1, glm::value_ptr(value)); }
+#endif
+};
+
+template <> struct UniformTraits<glm::mat3>
+{
+    static bool accepts(GLenum type) { return type == GL_FLOAT_MAT3; }
+    static void upload(GLint location, const glm::mat3 &value)
+    {
+        glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
+    }
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_separate_shader_objects)
+    static void upload(GLuint program, GLint location, const glm::mat3 &value)
+    {
+        glProgramUniformMatrix3fv(program, location, 1, GL_FALSE, glm::value_ptr(value));
+    }
+#endif
+};
+
+template <> struct UniformTraits<glm::mat4>
+{
+    static bool accepts(GLenum type) { return type == GL_FLOAT_MAT4; }
+    static void upload(GLint location, const glm::mat4 &value)
+    {
+        glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+    }
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_separate_shader_objects)
+    static void upload(GLuint program, GLint location, const glm::mat4 &value)
+    {
+        glProgramUniformMatrix4fv(program, location, 1, GL_FALSE, glm::value_ptr(value));
+    }
+#endif
+};
+
+// A uniform of type T (float, int, glm vectors and matrices). A name the
+// linker optimized away gives an inactive handle whose set() does nothing,
+// as glUniform does with location -1; a type that does not match the
+// shader's declaration throws.
+template <typename T>
+class Uniform
+{
+  public:
+    Uniform() : _program(0), _index(-1), _location(-1), _context(NULL), _reflection(NULL) {}
+
+    Uniform(GLuint program, const std::string &name)
+    : _program(program)
+    , _index(-1)
+    , _location(-1)
+    , _context(glfwGetCurrentContext())
+    , _reflection(NULL)
+    {
+        ProgramVariable uniform;
+        _index = sharedProgramReflections().findUniform(program, name, uniform, _reflection);
+        if (_index < 0)
+        {
+            return;
+        }
+        if (!UniformTraits<T>::accepts(uniform.type))
+        {
+            throw std::runtime_error("Uniform " + name + " is declared with another type");
+        }
+        _location = uniform.location;
+    }
+
+    bool isActive() const { return _location >= 0; }
+    GLint location() const { return _location; }
+
+    // Uploads to the handle's program, unless it already holds value
+    void set(const T &value) const
+    {
+        if (_location < 0)
+        {
+            return;
+        }
+        // Only this context's thread touches its reflections, so the cached
+        // one needs no lock
+        bool changed = glfwGetCurrentContext() == _context
+                       ? _reflection->update(_index, &value, sizeof(T))
+                       : sharedProgramReflections().update(_program, _index, &value, sizeof(T));
+        if (!changed)
+        {
+            return;
+        }
+
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_separate_shader_objects)
+        if (sharedGLCapabilities().programUniform)
+        {
+            UniformTraits<T>::upload(_program, _location, value);
+            return;
+        }
+#endif
+        GLint current = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+        if ((GLuint)current != _program)
+        {
+            glUseProgram(_program);
+        }
+        UniformTraits<T>::upload(_location, value);
+        if ((GLuint)current != _program)
+        {
+            glUseProgram(current);
+        }
+    }
+
+  private:
+    GLuint _program;
+    int _index;
+    GLint _location;
+    GLFWwindow *_context;
+    ProgramReflection *_reflection;     // _context's, in sharedProgramReflections()
+};
+
+#endif
@@ -0,0 +1,205 @@
+//
+//  renderqueue.h
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+
+#ifndef gltut_glfw_renderqueue_h
+#define gltut_glfw_renderqueue_h
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "gpuresource.h"
+
+// Collects the opaque draws of a frame so they can be reordered before
+// submission, instead of going to GL in the order the scene issues them.
+//
+// Front-to-back sorting lets early depth rejection discard hidden fragments
+// before they are shaded. The optional depth pre-pass goes further: every
+// draw first lays down depth with color writes off, then the color pass runs
+// with GL_EQUAL so each pixel is shaded exactly once, at the cost of
+// submitting the geometry twice.
+//
+// The color pass is wrapped in a GL_SAMPLES_PASSED query, which counts the
+// fragments that passed the depth test and were therefore shaded and
+// written. Comparing it across modes shows the fragment work saved. Results
+// are read a few frames late and only once available, so the queries never
+// stall the pipeline; a frame that finds every query still in flight goes
+// unmeasured.
+
+enum OpaqueSortMode
+{
+    OpaqueSortSubmissionOrder,
+    OpaqueSortFrontToBack,
+};
+
+class OpaqueRenderQueue
+{
+  public:
+    typedef std::function<void()> DrawFunc;
+
+    // Frames of sample queries in flight
+    static const int queryCount = 3;
+
+    OpaqueRenderQueue()
+    : _sortMode(OpaqueSortSubmissionOrder)
+    , _depthPrepass(false)
+    , _queryIndex(0)
+    , _shadedSamples(0)
+    {
+        for (int iQuery = 0; iQuery < queryCount; iQuery++)
+        {
+            _queryPending[iQuery] = false;
+        }
+    }
+
+    void setSortMode(OpaqueSortMode sortMode) { _sortMode = sortMode; }
+    OpaqueSortMode sortMode() const { return _sortMode; }
+
+    void setDepthPrepass(bool depthPrepass) { _depthPrepass = depthPrepass; }
+    bool depthPrepass() const { return _depthPrepass; }
+
+    // viewDepth is the distance along the view direction, positive in front
+    // of the camera; draw() must issue the same geometry every time it is called.
+    void add(float viewDepth, const DrawFunc &draw)
+    {
+        QueuedDraw queuedDraw = { viewDepth, (int)_draws.size(), draw };
+        _draws.push_back(queuedDraw);
+    }
+
+    // Submits every queued draw and empties the queue. Expects depth testing
+    // enabled with GL_LEQUAL and depth writes on, as the scenes set it up.
+    void flush()
+    {
+        if (_sortMode == OpaqueSortFrontToBack)
+        {
+            std::sort(_draws.begin(), _draws.end(), frontToBack);
+        }
+
+        if (_depthPrepass)
+        {
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            submitAll();
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+            glDepthFunc(GL_EQUAL);
+            glDepthMask(GL_FALSE);
+        }
+
+        bool querying = beginSampleQuery();
+        submitAll();
+        if (querying)
+        {
+            endSampleQuery();
+        }
+
+        if (_depthPrepass)
+        {
+            glDepthMask(GL_TRUE);
+            glDepthFunc(GL_LEQUAL);
+        }
+
+        _draws.clear();
+    }
+
+    // Fragments shaded by the color pass in the most recent frame whose
+    // query has finished. Never waits on the GPU.
+    GLuint shadedSamples()
+    {
+        // Oldest first, so _shadedSamples ends up as the newest finished frame
+        for (int iQuery = 1; iQuery <= queryCount; iQuery++)
+        {
+            int index = (_queryIndex + iQuery) % queryCount;
+            if (_queryPending[index])
+            {
+                readSampleQuery(index);
+            }
+        }
+        return _shadedSamples;
+    }
+
+  private:
+    struct QueuedDraw
+    {
+        float viewDepth;
+        int submissionIndex;
+        DrawFunc draw;
+    };
+
+    static bool frontToBack(const QueuedDraw &first, const QueuedDraw &second)
+    {
+        if (first.viewDepth != second.viewDepth)
+        {
+            return first.viewDepth < second.viewDepth;
+        }
+        return first.submissionIndex < second.submissionIndex;
+    }
+
+    void submitAll()
+    {
+        for (size_t iDraw = 0; iDraw < _draws.size(); iDraw++)
+        {
+            _draws[iDraw].draw();
+        }
+    }
+
+    bool readSampleQuery(int index)
+    {
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(_queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            return false;
+        }
+
+        glGetQueryObjectuiv(_queries[index], GL_QUERY_RESULT, &_shadedSamples);
+        _queryPending[index] = false;
+        return true;
+    }
+
+    // False when the next query is still in flight; the frame then goes unmeasured
+    bool beginSampleQuery()
+    {
+        if (_queries[0] == 0)
+        {
+            for (int iQuery = 0; iQuery < queryCount; iQuery++)
+            {
+                _queries[iQuery].create();
+            }
+        }
+
+        // Collect finished results before their query objects are reused
+        shadedSamples();
+        int nextIndex = (_queryIndex + 1) % queryCount;
+        if (_queryPending[nextIndex])
+        {
+            return false;
+        }
+
+        _queryIndex = nextIndex;
+        glBeginQuery(GL_SAMPLES_PASSED, _queries[_queryIndex]);
+        return true;
+    }
+
+    void endSampleQuery()
+    {
+        glEndQuery(GL_SAMPLES_PASSED);
+        _queryPending[_queryIndex] = true;
+    }
+
+    OpaqueSortMode _sortMode;
+    bool _depthPrepass;
+    std::vector<QueuedDraw> _draws;
+
+    GLQuery _queries[queryCount];
+    bool _queryPending[queryCount];
+    int _queryIndex;
+    GLuint _shadedSamples;
+};
+
+#endif
@@ -0,0 +1,102 @@
+//
+//  sceneregistry.h
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+
+#ifndef gltut_glfw_sceneregistry_h
+#define gltut_glfw_sceneregistry_h
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "gpuresource.h"
+
+// Named factories for every scene linked into the binary.
+//
+// Each chapter registers itself at the end of its Scene.cpp:
+//
+//  REGISTER_SCENE("gltut 03a");
+//
+// A chapter target links one scene and runs it. The "gltut all" target
+// links all of them, so main.cpp can switch between scenes at runtime and
+// run the whole catalogue in one process and one GL context.
+
+class SceneBase;
+
+class SceneRegistry
+{
+  public:
+    typedef std::function<SceneBase *()> SceneFactory;
+
+    // Kept sorted by name, so the order does not depend on static initialization order
+    void add(const std::string &name, const SceneFactory &factory)
+    {
+        Registration registration = { name, factory };
+        _registrations.insert(std::upper_bound(_registrations.begin(), _registrations.end(), registration, nameLess),
+                              registration);
+    }
+
+    int size() const { return (int)_registrations.size(); }
+    const std::string &name(int index) const { return _registrations[index].name; }
+
+    // -1 if no scene has that name
+    int indexOf(const std::string &name) const
+    {
+        for (size_t iScene = 0; iScene < _registrations.size(); iScene++)
+        {
+            if (_registrations[iScene].name == name)
+            {
+                return (int)iScene;
+            }
+        }
+        return -1;
+    }
+
+    // The caller owns the scene; create and init() it with a current GL
+    // context, whose new GL objects are then attributed to the scene
+    SceneBase *create(int index) const
+    {
+        sharedGPUMemoryTracker().beginScene(name(index));
+        return _registrations[index].factory();
+    }
+
+  private:
+    struct Registration
+    {
+        std::string name;
+        SceneFactory factory;
+    };
+
+    static bool nameLess(const Registration &first, const Registration &second)
+    {
+        return first.name < second.name;
+    }
+
+    std::vector<Registration> _registrations;
+};
+
+inline SceneRegistry &sharedSceneRegistry()
+{
+    static SceneRegistry registry;
+    return registry;
+}
+
+struct SceneRegistrar
+{
+    SceneRegistrar(const char *name, const SceneRegistry::SceneFactory &factory)
+    {
+        sharedSceneRegistry().add(name, factory);
+    }
+};
+
+// Use once per chapter, inside its GLTUT_CHAPTER namespace
+#define REGISTER_SCENE(name) \
+    SceneRegistrar sceneRegistrar(name, []() -> SceneBase * { return new Scene(); })
+
+#endif
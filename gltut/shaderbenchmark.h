@@ -0,0 +1,262 @@
+//
+//  shaderbenchmark.h
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+
+#ifndef gltut_glfw_shaderbenchmark_h
+#define gltut_glfw_shaderbenchmark_h
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "glcapabilities.h"
+#include "gpuresource.h"
+
+// Measures what a chapter's shader program costs per vertex and per
+// fragment, on synthetic workloads that load one stage and not the other.
+//
+// Vertex cost: a grid of tiny triangles, 390,000 unshared vertices, drawn
+// with GL_RASTERIZER_DISCARD on, so every vertex is shaded and nothing is
+// rasterized. Fragment cost: full-screen quads drawn over each other with
+// depth testing off, so every layer shades every pixel and the four
+// vertices per layer cost nothing. Both are timed with GL_TIME_ELAPSED
+// queries, and a GL_SAMPLES_PASSED query counts the fragments actually
+// shaded, which catches a program that moved the quad off screen.
+//
+// Chapters register their programs next to the code that uses them:
+//
+//  REGISTER_SHADER_BENCHMARK("gltut 04b", "ManualPerspective.vert", "StandardColors.frag",
+//                            [](GLuint program) { ...set uniforms... });
+//
+// Workload vertices have position (x, y, -0.75, 1) at location 0 and a
+// color at location 1. The uniform setup must put z = -0.75 inside the
+// view: a perspective projection needs its near plane closer than 0.75.
+// main.cpp --shaderbench runs every registered program.
+
+typedef std::function<void(GLuint program)> ShaderUniformSetup;
+
+struct ShaderBenchmarkCase
+{
+    std::string scene;
+    std::string vertexShader;
+    std::string fragmentShader;
+    ShaderUniformSetup setupUniforms;
+
+    std::string name() const
+    {
+        return scene + " " + vertexShader + " + " + fragmentShader;
+    }
+};
+
+inline std::vector<ShaderBenchmarkCase> &sharedShaderBenchmarkCases()
+{
+    static std::vector<ShaderBenchmarkCase> cases;
+    return cases;
+}
+
+struct ShaderBenchmarkRegistrar
+{
+    ShaderBenchmarkRegistrar(const char *scene, const char *vertexShader, const char *fragmentShader,
+                             const ShaderUniformSetup &setupUniforms)
+    {
+        ShaderBenchmarkCase benchmarkCase = { scene, vertexShader, fragmentShader, setupUniforms };
+        sharedShaderBenchmarkCases().push_back(benchmarkCase);
+    }
+};
+
+#define SHADER_BENCHMARK_CONCATENATE_(first, second) first##second
+#define SHADER_BENCHMARK_CONCATENATE(first, second) SHADER_BENCHMARK_CONCATENATE_(first, second)
+
+// Use at namespace scope, any number of times per file
+#define REGISTER_SHADER_BENCHMARK(scene, vertexShader, fragmentShader, ...) \
+    ShaderBenchmarkRegistrar SHADER_BENCHMARK_CONCATENATE(shaderBenchmarkRegistrar, __LINE__)(scene, vertexShader, fragmentShader, __VA_ARGS__)
+
+struct ShaderBenchmarkResult
+{
+    double vertexNanoseconds;    // per vertex
+    double fragmentNanoseconds;  // per fragment
+    double fragmentsPerLayer;
+};
+
+class ShaderBenchmark
+{
+  public:
+    static const int vertexGridSize = 256;
+    static const int overdrawLayers = 16;
+
+    ShaderBenchmark()
+    : _repetitions(9)
+    {
+    }
+
+    // Medians over this many timed draws, after one untimed draw of each
+    void setRepetitions(int repetitions) { _repetitions = std::max(repetitions, 1); }
+
+    // Draws into whatever framebuffer is bound, at the current viewport
+    ShaderBenchmarkResult measure(GLuint program, const ShaderUniformSetup &setupUniforms)
+    {
+        createWorkloads();
+        glUseProgram(program);
+        if (setupUniforms)
+        {
+            setupUniforms(program);
+        }
+        glBindVertexArray(_vertexArray);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_CULL_FACE);
+
+        ShaderBenchmarkResult result;
+        int vertexCount = gridVertexCount();
+        bindWorkload(_gridBuffer);
+        glEnable(GL_RASTERIZER_DISCARD);
+        result.vertexNanoseconds = medianDrawTime([vertexCount]() {
+            glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+        }) / vertexCount;
+        glDisable(GL_RASTERIZER_DISCARD);
+
+        bindWorkload(_quadBuffer);
+        result.fragmentsPerLayer = countFragments();
+        double layersTime = medianDrawTime([]() {
+            for (int iLayer = 0; iLayer < overdrawLayers; iLayer++)
+            {
+                glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+            }
+        });
+        result.fragmentNanoseconds = result.fragmentsPerLayer > 0.0 ? layersTime / (result.fragmentsPerLayer * overdrawLayers) : 0.0;
+
+        glBindVertexArray(0);
+        glUseProgram(0);
+        printOpenGLError();
+        return result;
+    }
+
+  private:
+    ShaderBenchmark(const ShaderBenchmark &);
+    ShaderBenchmark &operator=(const ShaderBenchmark &);
+
+    static int gridVertexCount() { return (vertexGridSize - 1) * (vertexGridSize - 1) * 6; }
+
+    void createWorkloads()
+    {
+        if (_vertexArray != 0)
+        {
+            return;
+        }
+
+        // Position then color, both vec4
+        const float depth = -0.75f;
+        std::vector<float> grid;
+        grid.reserve(gridVertexCount() * 8);
+        const int corners[6][2] = { {0, 0}, {1, 0}, {0, 1}, {0, 1}, {1, 0}, {1, 1} };
+        for (int iRow = 0; iRow < vertexGridSize - 1; iRow++)
+        {
+            for (int iColumn = 0; iColumn < vertexGridSize - 1; iColumn++)
+            {
+                for (int iCorner = 0; iCorner < 6; iCorner++)
+                {
+                    float x = (iColumn + corners[iCorner][0]) * 2.0f / (vertexGridSize - 1) - 1.0f;
+                    float y = (iRow + corners[iCorner][1]) * 2.0f / (vertexGridSize - 1) - 1.0f;
+                    float vertex[8] = { x, y, depth, 1.0f, 0.5f + 0.5f * x, 0.5f + 0.5f * y, 1.0f, 1.0f };
+                    grid.insert(grid.end(), vertex, vertex + 8);
+                }
+            }
+        }
+
+        // Much larger than the view, so it covers it under any projection
+        const float quad[] =
+        {
+            -100.0f, -100.0f, depth, 1.0f,   1.0f, 0.0f, 0.0f, 1.0f,
+             100.0f, -100.0f, depth, 1.0f,   0.0f, 1.0f, 0.0f, 1.0f,
+            -100.0f,  100.0f, depth, 1.0f,   0.0f, 0.0f, 1.0f, 1.0f,
+             100.0f,  100.0f, depth, 1.0f,   1.0f, 1.0f, 1.0f, 1.0f,
+        };
+
+        // Made without a scene, for --shaderbench, so they are the application's
+        _vertexArray.create(GPUVertexArrays, GPUOwnedByApplication);
+        _gridBuffer.create(GPUVertexData, GPUOwnedByApplication);
+        _gridBuffer.bufferData(GL_ARRAY_BUFFER, grid.size() * sizeof(float), &grid[0], GL_STATIC_DRAW);
+        _quadBuffer.create(GPUVertexData, GPUOwnedByApplication);
+        _quadBuffer.bufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void bindWorkload(GLuint buffer)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), 0);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(4 * sizeof(float)));
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    double countFragments()
+    {
+        GLQuery query;
+        query.create(GPUQueries, GPUOwnedByApplication);
+        glBeginQuery(GL_SAMPLES_PASSED, query);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        glEndQuery(GL_SAMPLES_PASSED);
+        GLuint samples = 0;
+        glGetQueryObjectuiv(query, GL_QUERY_RESULT, &samples);
+        return samples;
+    }
+
+    // Nanoseconds on the GPU, or glFinish-bracketed CPU time without timer queries
+    double medianDrawTime(const std::function<void()> &draw)
+    {
+        draw();
+        glFinish();
+
+        std::vector<double> times(_repetitions);
+        bool timed = false;
+#ifdef GL_TIME_ELAPSED
+        if (sharedGLCapabilities().timerQuery)
+        {
+            std::vector<GLQuery> queries(_repetitions);
+            for (int iRepetition = 0; iRepetition < _repetitions; iRepetition++)
+            {
+                queries[iRepetition].create(GPUQueries, GPUOwnedByApplication);
+            }
+            for (int iRepetition = 0; iRepetition < _repetitions; iRepetition++)
+            {
+                glBeginQuery(GL_TIME_ELAPSED, queries[iRepetition]);
+                draw();
+                glEndQuery(GL_TIME_ELAPSED);
+            }
+            for (int iRepetition = 0; iRepetition < _repetitions; iRepetition++)
+            {
+                GLuint64 elapsedNanoseconds = 0;
+                glGetQueryObjectui64v(queries[iRepetition], GL_QUERY_RESULT, &elapsedNanoseconds);
+                times[iRepetition] = elapsedNanoseconds;
+            }
+            timed = true;
+        }
+#endif
+        if (!timed)
+        {
+            for (int iRepetition = 0; iRepetition < _repetitions; iRepetition++)
+            {
+                double start = glfwGetTime();
+                draw();
+                glFinish();
+                times[iRepetition] = (glfwGetTime() - start) * 1e9;
+            }
+        }
+        std::sort(times.begin(), times.end());
+        return times[_repetitions / 2];
+    }
+
+    GLVertexArray _vertexArray;
+    GLBuffer _gridBuffer;
+    GLBuffer _quadBuffer;
+    int _repetitions;
+};
+
+#endif
@@ -0,0 +1,490 @@
+//
+//  streamingloader.h
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+
+#ifndef gltut_glfw_streamingloader_h
+#define gltut_glfw_streamingloader_h
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "assetarchive.h"
+#include "glcapabilities.h"
+#include "meshgen.h"
+
+// Loads meshes in the background and uploads them a slice at a time.
+//
+// Reading and generating happen on dedicated I/O threads. They are kept
+// apart from the job system because they spend most of their time blocked
+// on the disk. Each result is packed into one staging block laid out like
+// the final buffers: positions, colors, then indices. The main thread calls
+// update() once per frame. It copies staged bytes into mapped GL buffers in
+// fixed-size chunks until the frame's upload budget is used up. A mesh
+// becomes drawable once its last chunk lands, so init() returns immediately
+// and objects appear over the following frames.
+//
+//  int handle = loader.requestFile("arm.mesh");
+//  ...
+//  loader.update(positionAttribute, colorAttribute);     // every frame
+//  if (loader.isReady(handle)) loader.buffers(handle).draw();
+
+// Binary mesh file: "GLTM", version, vertex count, index count (uint32 each),
+// then the positions, colors and indices arrays of a Mesh.
+const char meshFileMagic[4] = { 'G', 'L', 'T', 'M' };
+const unsigned meshFileVersion = 1;
+
+inline bool WriteMeshFile(const std::string &filename, const Mesh &mesh)
+{
+    std::ofstream file(filename.c_str(), std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    unsigned header[3] = { meshFileVersion, (unsigned)mesh.vertexCount(), (unsigned)mesh.indices.size() };
+    file.write(meshFileMagic, sizeof(meshFileMagic));
+    file.write((const char *)header, sizeof(header));
+    file.write((const char *)mesh.positions.data(), mesh.positions.size() * sizeof(float));
+    file.write((const char *)mesh.colors.data(), mesh.colors.size() * sizeof(float));
+    file.write((const char *)mesh.indices.data(), mesh.indices.size() * sizeof(GLuint));
+    return file.good();
+}
+
+inline bool ReadMeshData(const char *data, size_t size, Mesh &mesh)
+{
+    unsigned header[3];
+    if (size < sizeof(meshFileMagic) + sizeof(header) || memcmp(data, meshFileMagic, sizeof(meshFileMagic)) != 0)
+    {
+        return false;
+    }
+    memcpy(header, data + sizeof(meshFileMagic), sizeof(header));
+
+    // The counts come from the file; bound each by the bytes that follow
+    // before multiplying, so a corrupt header can neither overflow the
+    // sizes nor make us allocate more than the file holds
+    const char *payload = data + sizeof(meshFileMagic) + sizeof(header);
+    size_t payloadSize = size - sizeof(meshFileMagic) - sizeof(header);
+    size_t vertexCount = header[1];
+    size_t indexCount = header[2];
+    if (header[0] != meshFileVersion
+        || vertexCount > payloadSize / (7 * sizeof(float))
+        || indexCount > payloadSize / sizeof(GLuint))
+    {
+        return false;
+    }
+
+    size_t positionBytes = vertexCount * 3 * sizeof(float);
+    size_t colorBytes = vertexCount * 4 * sizeof(float);
+    size_t indexBytes = indexCount * sizeof(GLuint);
+    if (payloadSize < positionBytes + colorBytes + indexBytes)
+    {
+        return false;
+    }
+
+    mesh.positions.resize(vertexCount * 3);
+    mesh.colors.resize(vertexCount * 4);
+    mesh.indices.resize(indexCount);
+    memcpy(mesh.positions.data(), payload, positionBytes);
+    memcpy(mesh.colors.data(), payload + positionBytes, colorBytes);
+    memcpy(mesh.indices.data(), payload + positionBytes + colorBytes, indexBytes);
+    return true;
+}
+
+// Resolved by FindAsset(), so archived meshes are parsed in place
+inline bool ReadMeshFile(const std::string &filename, Mesh &mesh)
+{
+    AssetView asset;
+    std::string storage;
+    return FindAsset(filename, asset, storage) && ReadMeshData(asset.data, asset.size, mesh);
+}
+
+struct StreamingStats
+{
+    int pendingMeshes;      // requested but not drawable yet
+    size_t bytesUploaded;   // during the last update()
+    double uploadTime;      // seconds spent in the last update()
+};
+
+class StreamingLoader
+{
+  public:
+    // Runs on an I/O thread; returns false if the mesh could not be produced
+    typedef std::function<bool(Mesh &mesh)> MeshSource;
+
+    explicit StreamingLoader(unsigned ioThreadCount = 2)
+    : _uploadBudget(0.002)
+    , _chunkSize(256 * 1024)
+    , _uploadingHandle(-1)
+    , _stopping(false)
+    , _generation(0)
+    {
+        _stats.pendingMeshes = 0;
+        _stats.bytesUploaded = 0;
+        _stats.uploadTime = 0.0;
+
+        for (unsigned iThread = 0; iThread < std::max(ioThreadCount, 1u); iThread++)
+        {
+            _ioThreads.push_back(std::thread(&StreamingLoader::ioThreadMain, this));
+        }
+    }
+
+    ~StreamingLoader()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopping = true;
+        }
+        _requestAvailable.notify_all();
+        for (size_t iThread = 0; iThread < _ioThreads.size(); iThread++)
+        {
+            _ioThreads[iThread].join();
+        }
+
+        clear();
+    }
+
+    // Milliseconds of each frame that update() may spend copying into GL
+    void setUploadBudget(double milliseconds) { _uploadBudget = milliseconds / 1000.0; }
+    double uploadBudget() const { return _uploadBudget * 1000.0; }
+
+    // Bytes copied per map; smaller chunks follow the budget more closely
+    void setChunkSize(size_t chunkSize) { _chunkSize = std::max(chunkSize, (size_t)4096); }
+
+    int request(const MeshSource &source)
+    {
+        int handle = (int)_entries.size();
+        _entries.push_back(Entry());
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            Request request = { handle, _generation, source };
+            _requests.push_back(request);
+        }
+        _requestAvailable.notify_one();
+        return handle;
+    }
+
+    int requestFile(const std::string &filename)
+    {
+        return request([filename](Mesh &mesh) {
+            if (!ReadMeshFile(filename, mesh))
+            {
+                fprintf(stderr, "Could not read mesh file: %s\n", filename.c_str());
+                return false;
+            }
+            return true;
+        });
+    }
+
+    bool isReady(int handle) const { return _entries[handle].state == EntryReady; }
+    const MeshBuffers &buffers(int handle) const { return _entries[handle].buffers; }
+    float boundingRadius(int handle) const { return _entries[handle].boundingRadius; }
+    int meshCount() const { return (int)_entries.size(); }
+    const StreamingStats &stats() const { return _stats; }
+
+    // Call once per frame on the GL thread.
+    void update(GLuint positionAttribute, GLuint colorAttribute)
+    {
+        double startTime = glfwGetTime();
+        _stats.bytesUploaded = 0;
+
+        collectStaged();
+
+        // Always make some progress, even when a frame starts over budget
+        do
+        {
+            if (_uploadingHandle < 0 && !startNextUpload())
+            {
+                break;
+            }
+            uploadChunk(positionAttribute, colorAttribute);
+        }
+        while (glfwGetTime() - startTime < _uploadBudget);
+
+        _stats.uploadTime = glfwGetTime() - startTime;
+
+        _stats.pendingMeshes = 0;
+        for (size_t iEntry = 0; iEntry < _entries.size(); iEntry++)
+        {
+            if (_entries[iEntry].state != EntryReady && _entries[iEntry].state != EntryFailed)
+            {
+                _stats.pendingMeshes++;
+            }
+        }
+    }
+
+    // Forgets every mesh, deleting its GL objects. Requests still on the I/O
+    // threads finish and are dropped.
+    void clear()
+    {
+        _entries.clear();
+        _uploadQueue.clear();
+        _uploadingHandle = -1;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _requests.clear();
+        _staged.clear();
+        _generation++;
+    }
+
+  private:
+    enum EntryState
+    {
+        EntryLoading,
+        EntryStaged,
+        EntryUploading,
+        EntryReady,
+        EntryFailed,
+    };
+
+    struct Entry
+    {
+        Entry() : state(EntryLoading), boundingRadius(0.0f), positionBytes(0), vertexBytes(0), uploadedBytes(0) {}
+
+        EntryState state;
+        MeshBuffers buffers;
+        float boundingRadius;
+
+        // positions | colors | indices, filled by an I/O thread
+        std::vector<char> staging;
+        size_t positionBytes;
+        size_t vertexBytes;
+        size_t uploadedBytes;
+    };
+
+    struct Request
+    {
+        int handle;
+        unsigned generation;
+        MeshSource source;
+    };
+
+    struct Staged
+    {
+        int handle;
+        unsigned generation;
+        bool succeeded;
+        float boundingRadius;
+        size_t positionBytes;
+        size_t vertexBytes;
+        std::vector<char> staging;
+    };
+
+    StreamingLoader(const StreamingLoader &);
+    StreamingLoader &operator=(const StreamingLoader &);
+
+    void ioThreadMain()
+    {
+        for (;;)
+        {
+            Request request;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _requestAvailable.wait(lock, [this]() { return _stopping || !_requests.empty(); });
+                if (_stopping)
+                {
+                    return;
+                }
+                request = _requests.front();
+                _requests.pop_front();
+            }
+
+            Staged staged;
+            staged.handle = request.handle;
+            staged.generation = request.generation;
+            staged.boundingRadius = 0.0f;
+            staged.positionBytes = 0;
+            staged.vertexBytes = 0;
+
+            Mesh mesh;
+            staged.succeeded = request.source(mesh) && !mesh.indices.empty();
+            if (staged.succeeded)
+            {
+                size_t positionBytes = mesh.positions.size() * sizeof(float);
+                size_t colorBytes = mesh.colors.size() * sizeof(float);
+                size_t indexBytes = mesh.indices.size() * sizeof(GLuint);
+
+                staged.positionBytes = positionBytes;
+                staged.vertexBytes = positionBytes + colorBytes;
+                staged.boundingRadius = mesh.boundingRadius();
+                staged.staging.resize(positionBytes + colorBytes + indexBytes);
+                memcpy(&staged.staging[0], &mesh.positions[0], positionBytes);
+                memcpy(&staged.staging[positionBytes], &mesh.colors[0], colorBytes);
+                memcpy(&staged.staging[staged.vertexBytes], &mesh.indices[0], indexBytes);
+            }
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            _staged.push_back(std::move(staged));
+        }
+    }
+
+    // Moves finished I/O work into the entries, in completion order
+    void collectStaged()
+    {
+        std::deque<Staged> staged;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            staged.swap(_staged);
+        }
+
+        for (size_t iStaged = 0; iStaged < staged.size(); iStaged++)
+        {
+            Staged &result = staged[iStaged];
+            if (result.generation != _generation)
+            {
+                continue;
+            }
+
+            Entry &entry = _entries[result.handle];
+            if (!result.succeeded)
+            {
+                entry.state = EntryFailed;
+                continue;
+            }
+
+            entry.state = EntryStaged;
+            entry.boundingRadius = result.boundingRadius;
+            entry.positionBytes = result.positionBytes;
+            entry.vertexBytes = result.vertexBytes;
+            entry.staging.swap(result.staging);
+            _uploadQueue.push_back(result.handle);
+        }
+    }
+
+    // Allocates the GL buffers of the next staged mesh
+    bool startNextUpload()
+    {
+        if (_uploadQueue.empty())
+        {
+            return false;
+        }
+
+        _uploadingHandle = _uploadQueue.front();
+        _uploadQueue.pop_front();
+
+        Entry &entry = _entries[_uploadingHandle];
+        entry.state = EntryUploading;
+        entry.uploadedBytes = 0;
+
+        MeshBuffers &buffers = entry.buffers;
+        buffers.vertexBufferObject.create();
+        glBindBuffer(GL_ARRAY_BUFFER, buffers.vertexBufferObject);
+        allocateBuffer(entry.vertexBytes);
+        buffers.vertexBufferObject.setSize(entry.vertexBytes);
+
+        buffers.indexBufferObject.create(GPUIndexData);
+        glBindBuffer(GL_ARRAY_BUFFER, buffers.indexBufferObject);
+        allocateBuffer(entry.staging.size() - entry.vertexBytes);
+        buffers.indexBufferObject.setSize(entry.staging.size() - entry.vertexBytes);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        return true;
+    }
+
+    // Immutable storage where the context has it: the size can never
+    // change, so the driver can place the buffer once and skip checking for
+    // reallocation on every map. Dynamic so the glBufferSubData fallback
+    // still works.
+    static void allocateBuffer(size_t size)
+    {
+#ifdef GL_MAP_PERSISTENT_BIT
+        if (sharedGLCapabilities().bufferStorage)
+        {
+            glBufferStorage(GL_ARRAY_BUFFER, size, NULL, GL_MAP_WRITE_BIT | GL_DYNAMIC_STORAGE_BIT);
+            return;
+        }
+#endif
+        glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STATIC_DRAW);
+    }
+
+    void uploadChunk(GLuint positionAttribute, GLuint colorAttribute)
+    {
+        Entry &entry = _entries[_uploadingHandle];
+
+        // The vertex part goes to the vertex buffer, the rest to the index buffer
+        size_t offset = entry.uploadedBytes;
+        bool inVertices = offset < entry.vertexBytes;
+        size_t end = inVertices ? entry.vertexBytes : entry.staging.size();
+        size_t size = std::min(_chunkSize, end - offset);
+        GLintptr bufferOffset = inVertices ? offset : offset - entry.vertexBytes;
+
+        // Unsynchronized: nothing has drawn from these buffers yet
+        glBindBuffer(GL_ARRAY_BUFFER, inVertices ? entry.buffers.vertexBufferObject : entry.buffers.indexBufferObject);
+        void *destination = glMapBufferRange(GL_ARRAY_BUFFER, bufferOffset, size,
+                                             GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (destination != NULL)
+        {
+            memcpy(destination, &entry.staging[offset], size);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        }
+        else
+        {
+            glBufferSubData(GL_ARRAY_BUFFER, bufferOffset, size, &entry.staging[offset]);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        entry.uploadedBytes += size;
+        _stats.bytesUploaded += size;
+
+        if (entry.uploadedBytes == entry.staging.size())
+        {
+            finishUpload(entry, positionAttribute, colorAttribute);
+            _uploadingHandle = -1;
+        }
+    }
+
+    void finishUpload(Entry &entry, GLuint positionAttribute, GLuint colorAttribute)
+    {
+        MeshBuffers &buffers = entry.buffers;
+        buffers.vertexArrayObject.create();
+        glBindVertexArray(buffers.vertexArrayObject);
+
+        glBindBuffer(GL_ARRAY_BUFFER, buffers.vertexBufferObject);
+        glEnableVertexAttribArray(positionAttribute);
+        glEnableVertexAttribArray(colorAttribute);
+        glVertexAttribPointer(positionAttribute, 3, GL_FLOAT, GL_FALSE, 0, 0);
+        glVertexAttribPointer(colorAttribute, 4, GL_FLOAT, GL_FALSE, 0, (void*)entry.positionBytes);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.indexBufferObject);
+
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        buffers.indexCount = (GLsizei)((entry.staging.size() - entry.vertexBytes) / sizeof(GLuint));
+        entry.state = EntryReady;
+        std::vector<char>().swap(entry.staging);
+    }
+
+    double _uploadBudget;
+    size_t _chunkSize;
+
+    std::vector<Entry> _entries;
+    std::deque<int> _uploadQueue;
+    int _uploadingHandle;
+    StreamingStats _stats;
+
+    // Shared with the I/O threads
+    std::mutex _mutex;
+    std::condition_variable _requestAvailable;
+    std::deque<Request> _requests;
+    std::deque<Staged> _staged;
+    bool _stopping;
+    unsigned _generation;
+
+    std::vector<std::thread> _ioThreads;
+};
+
+#endif
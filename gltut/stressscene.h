@@ -0,0 +1,385 @@
+//
+//  stressscene.h
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+
+#ifndef gltut_glfw_stressscene_h
+#define gltut_glfw_stressscene_h
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "glm.hpp"
+
+#include "fastmath.h"
+#include "meshgen.h"
+
+// Generates scenes of any size from a handful of parameters and a seed, to
+// measure how the framework scales past the 14 cubes of the 06d armature.
+//
+// A stress scene has two kinds of things in it:
+//  - Instances, as in 06c: a mesh with an offset and a rotation driven by
+//    the elapsed time. Here each one also gets its own scale, axis and
+//    loop duration.
+//  - Armatures, as in 06d's Hierarchy: a tree of joints, each turned about
+//    one axis relative to its parent and drawn as a stretched cube. The
+//    tree is stored flat, parents before children, so a joint's matrix is
+//    its parent's times its own and no matrix stack is needed.
+//
+// Instances are laid out on a jittered grid in overdrawDepth layers, each
+// of which roughly covers the view, so the depth complexity of the frame
+// is about overdrawDepth. Armatures stand in random layers. A random
+// animatedFraction of instances and armatures move; the rest are static.
+//
+// Random numbers come straight from std::mt19937, whose output the
+// standard fixes, and not from the std distributions, whose results differ
+// between standard libraries, and every object takes the same number of
+// them whatever it turns out to be, so changing animatedFraction changes
+// which objects move but not where they are. The same parameters therefore
+// give the same scene everywhere, so scaling curves can be reproduced.
+//
+//  StressSceneParameters parameters;
+//  parameters.parse(ReadAssetOrThrow("stress.scene"));
+//  StressScene scene = GenerateStressScene(parameters, frustumScale, 1.6f);
+
+struct StressSceneParameters
+{
+    StressSceneParameters()
+    : seed(1)
+    , objectCount(1000)
+    , armatureCount(8)
+    , jointsPerArmature(14)
+    , trianglesPerObject(200)
+    , overdrawDepth(4)
+    , animatedFraction(0.5f)
+    {
+    }
+
+    // "name value" per line, # starts a comment; false on an unknown name
+    // or a malformed value, after applying the lines that did parse
+    bool parse(const std::string &text)
+    {
+        bool valid = true;
+        std::istringstream lines(text);
+        std::string line;
+        while (std::getline(lines, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            std::istringstream fields(line);
+            std::string name;
+            double value;
+            fields >> name >> value;
+            if (fields.fail() || !set(name, value))
+            {
+                fprintf(stderr, "Bad stress scene parameter: %s\n", line.c_str());
+                valid = false;
+            }
+        }
+        return valid;
+    }
+
+    bool set(const std::string &name, double value)
+    {
+        if (name == "seed") seed = (unsigned int)value;
+        else if (name == "objects") objectCount = std::max((int)value, 0);
+        else if (name == "armatures") armatureCount = std::max((int)value, 0);
+        else if (name == "joints") jointsPerArmature = std::max((int)value, 1);
+        else if (name == "triangles") trianglesPerObject = std::max((int)value, 1);
+        else if (name == "overdraw") overdrawDepth = std::max((int)value, 1);
+        else if (name == "animated") animatedFraction = glm::clamp((float)value, 0.0f, 1.0f);
+        else return false;
+        return true;
+    }
+
+    void print() const
+    {
+        printf("seed %u, %d objects of ~%d triangles, %d armatures of %d joints, overdraw %d, %.0f%% animated\n",
+               seed, objectCount, trianglesPerObject, armatureCount, jointsPerArmature, overdrawDepth,
+               animatedFraction * 100.0f);
+    }
+
+    unsigned int seed;
+    int objectCount;
+    int armatureCount;
+    int jointsPerArmature;
+    int trianglesPerObject;
+    int overdrawDepth;
+    float animatedFraction;
+};
+
+class StressRandom
+{
+  public:
+    explicit StressRandom(unsigned int seed) : _generator(seed) {}
+
+    // [0, 1) from the top 24 bits, exact in a float
+    float unit() { return (_generator() >> 8) * (1.0f / 16777216.0f); }
+    float uniform(float minimum, float maximum) { return minimum + (maximum - minimum) * unit(); }
+    int below(int count) { return std::min((int)(unit() * count), count - 1); }
+    bool chance(float probability) { return unit() < probability; }
+
+    glm::vec3 direction()
+    {
+        glm::vec3 axis(uniform(-1.0f, 1.0f), uniform(-1.0f, 1.0f), uniform(-1.0f, 1.0f));
+        return glm::length(axis) > 0.01f ? glm::normalize(axis) : glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+
+  private:
+    std::mt19937 _generator;
+};
+
+inline glm::mat4 StressTranslation(const glm::vec3 &offset)
+{
+    glm::mat4 theMat(1.0f);
+    theMat[3] = glm::vec4(offset, 1.0f);
+    return theMat;
+}
+
+inline glm::mat4 StressScaling(const glm::vec3 &scale)
+{
+    glm::mat4 theMat(1.0f);
+    theMat[0].x = scale.x;
+    theMat[1].y = scale.y;
+    theMat[2].z = scale.z;
+    return theMat;
+}
+
+struct StressInstance
+{
+    int mesh;                   // index into StressScene::meshShapes
+    glm::vec3 offset;
+    float scale;
+    glm::vec3 axis;
+    float angleRad;             // at time zero
+    float loopDuration;         // seconds per turn, 0 when static
+
+    bool animated() const { return loopDuration > 0.0f; }
+
+    float AngleRad(float fElapsedTime) const
+    {
+        float fAngRad = angleRad;
+        if (animated())
+        {
+            fAngRad += fmodf(fElapsedTime, loopDuration) * (3.14159f * 2.0f / loopDuration);
+        }
+        return fAngRad;
+    }
+
+    // fSin and fCos of AngleRad(), for callers that evaluate many at once
+    glm::mat4 ConstructMatrix(float fSin, float fCos) const
+    {
+        glm::mat4 theMat(AxisRotation(axis, fSin, fCos) * scale);
+        theMat[3] = glm::vec4(offset, 1.0f);
+        return theMat;
+    }
+
+    glm::mat4 ConstructMatrix(float fElapsedTime) const
+    {
+        float fSin, fCos;
+        SinCos(AngleRad(fElapsedTime), fSin, fCos);
+        return ConstructMatrix(fSin, fCos);
+    }
+};
+
+struct StressJoint
+{
+    int parent;                 // earlier joint, or -1 for the root
+    int axis;                   // 0, 1, 2 for x, y, z
+    float angleDeg;
+    float swingDeg;             // amplitude of the animation, 0 when static
+    float loopDuration;
+    glm::vec3 size;             // width, height and length of the cube drawn along +z
+};
+
+struct StressArmature
+{
+    glm::vec3 position;
+    float headingDeg;
+    float scale;
+    bool animated;
+    std::vector<StressJoint> joints;
+
+    // One model-to-camera matrix per joint, for drawing its cube. Children
+    // hang off the far end of their parent, like 06d's arm segments. The
+    // heading and every joint angle go through one SinCosArray().
+    void ConstructMatrices(float fElapsedTime, std::vector<glm::mat4> &matrices) const
+    {
+        const float degToRad = 3.14159f * 2.0f / 360.0f;
+        static const glm::vec3 axes[3] = { glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f) };
+
+        // Element 0 is the heading, then one per joint
+        std::vector<float> angles(joints.size() + 1);
+        std::vector<float> sines(angles.size());
+        std::vector<float> cosines(angles.size());
+        angles[0] = headingDeg * degToRad;
+        for (size_t iJoint = 0; iJoint < joints.size(); iJoint++)
+        {
+            const StressJoint &joint = joints[iJoint];
+            float angleDeg = joint.angleDeg;
+            if (animated && joint.loopDuration > 0.0f)
+            {
+                angleDeg += joint.swingDeg * sinf(fmodf(fElapsedTime, joint.loopDuration) * (3.14159f * 2.0f / joint.loopDuration));
+            }
+            angles[iJoint + 1] = angleDeg * degToRad;
+        }
+        SinCosArray(&angles[0], &sines[0], &cosines[0], (int)angles.size());
+
+        std::vector<glm::mat4> jointFrames(joints.size());
+        matrices.resize(joints.size());
+        glm::mat4 base = StressTranslation(position) * glm::mat4(AxisRotation(axes[1], sines[0], cosines[0]))
+                         * StressScaling(glm::vec3(scale));
+        for (size_t iJoint = 0; iJoint < joints.size(); iJoint++)
+        {
+            const StressJoint &joint = joints[iJoint];
+            glm::mat4 parentFrame = base;
+            if (joint.parent >= 0)
+            {
+                parentFrame = jointFrames[joint.parent] * StressTranslation(glm::vec3(0.0f, 0.0f, joints[joint.parent].size.z));
+            }
+            jointFrames[iJoint] = parentFrame * glm::mat4(AxisRotation(axes[joint.axis], sines[iJoint + 1], cosines[iJoint + 1]));
+            matrices[iJoint] = jointFrames[iJoint] * StressTranslation(glm::vec3(0.0f, 0.0f, joint.size.z / 2.0f))
+                               * StressScaling(joint.size / 2.0f);
+        }
+    }
+};
+
+struct StressScene
+{
+    StressSceneParameters parameters;
+
+    // Instance meshes: one per shape, tessellated to about trianglesPerObject.
+    // Armature joints are drawn with the 06x cube, GenerateBox(1).
+    std::vector<MeshShape> meshShapes;
+    std::vector<int> meshTessellations;
+
+    std::vector<StressInstance> instances;
+    std::vector<StressArmature> armatures;
+
+    int jointCount() const
+    {
+        int count = 0;
+        for (size_t iArmature = 0; iArmature < armatures.size(); iArmature++)
+        {
+            count += (int)armatures[iArmature].joints.size();
+        }
+        return count;
+    }
+};
+
+// Smallest tessellation whose mesh has at least triangles triangles, or the
+// largest one tried. Searches upwards by doubling, then bisects.
+inline int TessellationForTriangles(MeshShape shape, int triangles)
+{
+    const int maxTessellation = 1024;
+    int low = 1;
+    int high = 1;
+    while (high < maxTessellation && GenerateShape(shape, high).triangleCount() < triangles)
+    {
+        low = high;
+        high *= 2;
+    }
+    while (low < high)
+    {
+        int middle = (low + high) / 2;
+        if (GenerateShape(shape, middle).triangleCount() < triangles)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return high;
+}
+
+// frustumScale and aspect are the camera's, which looks down -z from the
+// origin; the layers start 8 units in front of it and are 3 units apart
+inline StressScene GenerateStressScene(const StressSceneParameters &parameters, float frustumScale, float aspect)
+{
+    const float firstLayerDepth = 8.0f;
+    const float layerSpacing = 3.0f;
+
+    StressScene scene;
+    scene.parameters = parameters;
+    StressRandom random(parameters.seed);
+
+    const MeshShape shapes[] = { MeshShapeBox, MeshShapeSphere, MeshShapeCylinder, MeshShapeTorus, MeshShapePrism };
+    for (size_t iShape = 0; iShape < sizeof(shapes) / sizeof(shapes[0]); iShape++)
+    {
+        scene.meshShapes.push_back(shapes[iShape]);
+        scene.meshTessellations.push_back(TessellationForTriangles(shapes[iShape], parameters.trianglesPerObject));
+    }
+
+    // Each layer gets an equal share of the instances on a grid of cells
+    // shaped like the view; an instance fills its cell, give or take jitter
+    int layerCount = parameters.overdrawDepth;
+    int perLayer = (parameters.objectCount + layerCount - 1) / layerCount;
+    int columns = std::max((int)ceilf(sqrtf(perLayer * aspect)), 1);
+    int rows = std::max((perLayer + columns - 1) / columns, 1);
+    scene.instances.reserve(parameters.objectCount);
+    for (int iObject = 0; iObject < parameters.objectCount; iObject++)
+    {
+        int layer = iObject % layerCount;
+        int cell = iObject / layerCount;
+        float depth = firstLayerDepth + layer * layerSpacing;
+        float halfHeight = depth / frustumScale;
+        float halfWidth = halfHeight * aspect;
+        float cellWidth = 2.0f * halfWidth / columns;
+        float cellHeight = 2.0f * halfHeight / rows;
+
+        StressInstance instance;
+        instance.mesh = random.below((int)scene.meshShapes.size());
+        instance.offset = glm::vec3(-halfWidth + cellWidth * (cell % columns + random.uniform(0.25f, 0.75f)),
+                                    -halfHeight + cellHeight * (cell / columns + random.uniform(0.25f, 0.75f)),
+                                    -depth + random.uniform(-0.5f, 0.5f));
+        instance.scale = 0.6f * std::max(cellWidth, cellHeight);
+        instance.axis = random.direction();
+        instance.angleRad = random.uniform(0.0f, 3.14159f * 2.0f);
+        float loopDuration = random.uniform(2.0f, 8.0f);
+        instance.loopDuration = random.chance(parameters.animatedFraction) ? loopDuration : 0.0f;
+        scene.instances.push_back(instance);
+    }
+
+    // Random trees: each joint hangs off the previous one most of the time,
+    // or branches from an earlier one
+    for (int iArmature = 0; iArmature < parameters.armatureCount; iArmature++)
+    {
+        StressArmature armature;
+        float depth = firstLayerDepth + random.below(layerCount) * layerSpacing;
+        float halfHeight = depth / frustumScale;
+        armature.position = glm::vec3(random.uniform(-0.8f, 0.8f) * halfHeight * aspect,
+                                      random.uniform(-0.8f, 0.8f) * halfHeight, -depth);
+        armature.headingDeg = random.uniform(0.0f, 360.0f);
+        armature.scale = halfHeight * 0.04f;
+        armature.animated = random.chance(parameters.animatedFraction);
+
+        for (int iJoint = 0; iJoint < parameters.jointsPerArmature; iJoint++)
+        {
+            StressJoint joint;
+            bool chained = random.chance(0.7f);
+            int branch = random.below(std::max(iJoint, 1));
+            joint.parent = iJoint == 0 ? -1 : (chained ? iJoint - 1 : branch);
+            joint.axis = random.below(3);
+            joint.angleDeg = random.uniform(-60.0f, 60.0f);
+            joint.swingDeg = random.uniform(10.0f, 45.0f);
+            joint.loopDuration = random.uniform(2.0f, 6.0f);
+            float width = random.uniform(0.5f, 1.5f);
+            joint.size = glm::vec3(width, width, random.uniform(1.0f, 5.0f));
+            armature.joints.push_back(joint);
+        }
+        scene.armatures.push_back(armature);
+    }
+
+    return scene;
+}
+
+#endif
@@ -0,0 +1,297 @@
+//
+//  assetpack.cpp
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+// Builds the asset archives read by assetarchive.h.
+//
+//  assetpack [-z] [-a alignment] [-r root] output.pak file...
+//  assetpack -l archive.pak
+//  assetpack -t
+//
+// Entries are named after the file name without its directory, which is
+// how the scenes ask for their shaders. With -r they keep their path
+// relative to root instead, e.g. "gltut 03a/standard.vert" for the
+// multi-scene binary. -z compresses every entry that LZ4 makes smaller.
+// -a sets the entry alignment (default 16 bytes). -t checks the LZ4 codec
+// against blocks written by the reference lz4 tool.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "assetarchive.h"
+
+struct PackedEntry
+{
+    std::string name;
+    std::vector<char> data;
+    uint64_t size;
+    uint32_t flags;
+};
+
+static bool entryHashLess(const PackedEntry &first, const PackedEntry &second)
+{
+    uint64_t firstHash = AssetNameHash(first.name);
+    uint64_t secondHash = AssetNameHash(second.name);
+    if (firstHash != secondHash)
+    {
+        return firstHash < secondHash;
+    }
+    return first.name < second.name;
+}
+
+static std::string entryName(const std::string &path, const std::string &root)
+{
+    if (!root.empty())
+    {
+        std::string prefix = root[root.size() - 1] == '/' ? root : root + "/";
+        if (path.compare(0, prefix.size(), prefix) == 0)
+        {
+            return path.substr(prefix.size());
+        }
+    }
+
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+static void padTo(std::vector<char> &archive, size_t alignment)
+{
+    archive.resize((archive.size() + alignment - 1) / alignment * alignment, 0);
+}
+
+static int listArchive(const std::string &filename)
+{
+    std::ifstream file(filename.c_str(), std::ios::binary);
+    std::vector<char> archive((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (archive.size() < sizeof(AssetArchiveHeader))
+    {
+        fprintf(stderr, "Could not read %s\n", filename.c_str());
+        return 1;
+    }
+
+    AssetArchiveHeader header;
+    memcpy(&header, &archive[0], sizeof(header));
+    if (memcmp(header.magic, assetArchiveMagic, sizeof(header.magic)) != 0)
+    {
+        fprintf(stderr, "%s is not an asset archive\n", filename.c_str());
+        return 1;
+    }
+    if (header.tocOffset > archive.size() ||
+        header.entryCount > (archive.size() - header.tocOffset) / sizeof(AssetArchiveEntry) ||
+        header.namesOffset > archive.size())
+    {
+        fprintf(stderr, "%s has a corrupt header\n", filename.c_str());
+        return 1;
+    }
+    size_t namesSize = archive.size() - (size_t)header.namesOffset;
+
+    printf("%u entries, %u byte alignment\n", header.entryCount, header.alignment);
+    for (uint32_t iEntry = 0; iEntry < header.entryCount; iEntry++)
+    {
+        AssetArchiveEntry entry;
+        memcpy(&entry, &archive[header.tocOffset + iEntry * sizeof(entry)], sizeof(entry));
+        if (entry.nameOffset > namesSize || entry.nameLength > namesSize - entry.nameOffset)
+        {
+            fprintf(stderr, "Entry %u has a corrupt name\n", iEntry);
+            return 1;
+        }
+        std::string name(archive.begin() + header.namesOffset + entry.nameOffset,
+                         archive.begin() + header.namesOffset + entry.nameOffset + entry.nameLength);
+        printf("%10llu %10llu %s %s\n", (unsigned long long)entry.size, (unsigned long long)entry.storedSize,
+               (entry.flags & AssetEntryCompressed) ? "lz4" : "   ", name.c_str());
+    }
+    return 0;
+}
+
+// Blocks from lz4 1.9.4 ("lz4 -12 --no-frame-crc", block taken out of the
+// frame). The second has a match overlapping its own output (offset 1).
+static const char lz4ReferenceText0[] =
+    "#version 330\n\nlayout(location = 0) in vec4 position;\nlayout(location = 1) in vec4 color;\n\n"
+    "smooth out vec4 theColor;\n";
+static const unsigned char lz4ReferenceBlock0[] = {
+    0xf0,0x0b,0x23,0x76,0x65,0x72,0x73,0x69,0x6f,0x6e,0x20,0x33,0x33,0x30,0x0a,0x0a,
+    0x6c,0x61,0x79,0x6f,0x75,0x74,0x28,0x6c,0x6f,0x63,0x61,0x74,0x15,0x00,0xf0,0x02,
+    0x3d,0x20,0x30,0x29,0x20,0x69,0x6e,0x20,0x76,0x65,0x63,0x34,0x20,0x70,0x6f,0x73,
+    0x69,0x16,0x00,0x2e,0x3b,0x0a,0x27,0x00,0x16,0x31,0x27,0x00,0xf2,0x03,0x63,0x6f,
+    0x6c,0x6f,0x72,0x3b,0x0a,0x0a,0x73,0x6d,0x6f,0x6f,0x74,0x68,0x20,0x6f,0x75,0x74,
+    0x18,0x00,0xa0,0x74,0x68,0x65,0x43,0x6f,0x6c,0x6f,0x72,0x3b,0x0a,
+};
+static const char lz4ReferenceText1[] =
+    "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+    "01234567890123456789012345678901234567890123456789012345678901234567890123456789";
+static const unsigned char lz4ReferenceBlock1[] = {
+    0x1f,0x61,0x01,0x00,0x50,0xaf,0x30,0x31,0x32,0x33,0x34,0x35,0x36,0x37,0x38,0x39,
+    0x0a,0x00,0x2e,0x50,0x35,0x36,0x37,0x38,0x39,
+};
+
+static bool checkLZ4(const char *text, size_t textSize, const unsigned char *block, size_t blockSize)
+{
+    // The reference block must decode to the text...
+    std::vector<char> decoded(textSize);
+    if (!LZ4DecompressBlock((const char *)block, blockSize, &decoded[0], decoded.size()) ||
+        memcmp(&decoded[0], text, textSize) != 0)
+    {
+        return false;
+    }
+
+    // ...and so must our own block for it, which lz4 -d was checked to accept
+    std::vector<char> compressed = LZ4CompressBlock(text, textSize);
+    std::fill(decoded.begin(), decoded.end(), 0);
+    return LZ4DecompressBlock(&compressed[0], compressed.size(), &decoded[0], decoded.size()) &&
+           memcmp(&decoded[0], text, textSize) == 0;
+}
+
+static int selfTest()
+{
+    bool passed = checkLZ4(lz4ReferenceText0, sizeof(lz4ReferenceText0) - 1, lz4ReferenceBlock0, sizeof(lz4ReferenceBlock0)) &&
+                  checkLZ4(lz4ReferenceText1, sizeof(lz4ReferenceText1) - 1, lz4ReferenceBlock1, sizeof(lz4ReferenceBlock1));
+    printf("LZ4 round trip: %s\n", passed ? "passed" : "FAILED");
+    return passed ? 0 : 1;
+}
+
+static void printUsage()
+{
+    fprintf(stderr, "usage: assetpack [-z] [-a alignment] [-r root] output.pak file...\n"
+                    "       assetpack -l archive.pak\n"
+                    "       assetpack -t\n");
+}
+
+int main(int argc, const char * argv[])
+{
+    bool compress = false;
+    size_t alignment = 16;
+    std::string root;
+
+    int iArg = 1;
+    for (; iArg < argc && argv[iArg][0] == '-'; iArg++)
+    {
+        if (strcmp(argv[iArg], "-z") == 0)
+        {
+            compress = true;
+        }
+        else if (strcmp(argv[iArg], "-a") == 0 && iArg + 1 < argc)
+        {
+            alignment = (size_t)atoi(argv[++iArg]);
+        }
+        else if (strcmp(argv[iArg], "-r") == 0 && iArg + 1 < argc)
+        {
+            root = argv[++iArg];
+        }
+        else if (strcmp(argv[iArg], "-l") == 0 && iArg + 1 < argc)
+        {
+            return listArchive(argv[iArg + 1]);
+        }
+        else if (strcmp(argv[iArg], "-t") == 0)
+        {
+            return selfTest();
+        }
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (argc - iArg < 2 || alignment == 0 || (alignment & (alignment - 1)) != 0)
+    {
+        printUsage();
+        return 1;
+    }
+    std::string outputFilename = argv[iArg++];
+
+    std::vector<PackedEntry> entries;
+    std::set<std::string> names;
+    for (; iArg < argc; iArg++)
+    {
+        PackedEntry entry;
+        entry.name = entryName(argv[iArg], root);
+        if (!names.insert(entry.name).second)
+        {
+            fprintf(stderr, "Two inputs are named %s\n", entry.name.c_str());
+            return 1;
+        }
+
+        std::ifstream file(argv[iArg], std::ios::binary);
+        if (!file.is_open())
+        {
+            fprintf(stderr, "Could not read %s\n", argv[iArg]);
+            return 1;
+        }
+        entry.data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        entry.size = entry.data.size();
+        entry.flags = 0;
+
+        if (compress && !entry.data.empty())
+        {
+            std::vector<char> compressed = LZ4CompressBlock(&entry.data[0], entry.data.size());
+            if (compressed.size() < entry.data.size())
+            {
+                entry.data.swap(compressed);
+                entry.flags |= AssetEntryCompressed;
+            }
+        }
+        entries.push_back(entry);
+    }
+
+    // The reader binary searches the table of contents by hash
+    std::sort(entries.begin(), entries.end(), entryHashLess);
+
+    std::vector<char> archive(sizeof(AssetArchiveHeader), 0);
+    std::vector<AssetArchiveEntry> toc(entries.size());
+    std::string nameBlock;
+    for (size_t iEntry = 0; iEntry < entries.size(); iEntry++)
+    {
+        padTo(archive, alignment);
+
+        AssetArchiveEntry &tocEntry = toc[iEntry];
+        memset(&tocEntry, 0, sizeof(tocEntry));
+        tocEntry.nameHash = AssetNameHash(entries[iEntry].name);
+        tocEntry.offset = archive.size();
+        tocEntry.storedSize = entries[iEntry].data.size();
+        tocEntry.size = entries[iEntry].size;
+        tocEntry.nameOffset = (uint32_t)nameBlock.size();
+        tocEntry.nameLength = (uint32_t)entries[iEntry].name.size();
+        tocEntry.flags = entries[iEntry].flags;
+
+        archive.insert(archive.end(), entries[iEntry].data.begin(), entries[iEntry].data.end());
+        nameBlock += entries[iEntry].name;
+    }
+
+    padTo(archive, 8);
+    AssetArchiveHeader header;
+    memcpy(header.magic, assetArchiveMagic, sizeof(header.magic));
+    header.version = assetArchiveVersion;
+    header.entryCount = (uint32_t)toc.size();
+    header.alignment = (uint32_t)alignment;
+    header.tocOffset = archive.size();
+    if (!toc.empty())
+    {
+        archive.insert(archive.end(), (const char *)&toc[0], (const char *)&toc[0] + toc.size() * sizeof(AssetArchiveEntry));
+    }
+    header.namesOffset = archive.size();
+    archive.insert(archive.end(), nameBlock.begin(), nameBlock.end());
+    memcpy(&archive[0], &header, sizeof(header));
+
+    std::ofstream output(outputFilename.c_str(), std::ios::binary);
+    output.write(&archive[0], archive.size());
+    if (!output.good())
+    {
+        fprintf(stderr, "Could not write %s\n", outputFilename.c_str());
+        return 1;
+    }
+
+    printf("Packed %u entries into %s (%lu bytes)\n", header.entryCount, outputFilename.c_str(), (unsigned long)archive.size());
+    return 0;
+}
@@ -0,0 +1,292 @@
+//
+//  benchcompare.cpp
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+// Compares two benchrunner reports, a baseline and a candidate, job by job
+// and fails when the candidate is significantly slower.
+//
+//  benchcompare [-t percent] [-a alpha] [-r resamples] baseline.json candidate.json
+//
+// Frame times are too noisy to compare averages by eye, so every job's
+// frame times are compared as samples. For the median and the 95th
+// percentile the tool bootstraps a confidence interval (1 - alpha, 99% by
+// default) for the relative change. A metric is slower when that whole
+// interval is above zero and the change is beyond the threshold (-t, 3% by
+// default); faster likewise. The Mann-Whitney U test p-value of the two
+// samples is printed alongside as a check that the distributions differ.
+//
+// Jobs are matched by scene, size and keys. Exits with 1 if any metric is
+// slower, a job that ran in the baseline failed in the candidate, or a
+// baseline job is missing from the candidate, with 2 if a report cannot be
+// read.
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+
+struct MetricComparison
+{
+    double baseline;
+    double candidate;
+    double change;
+    double lowerChange;
+    double upperChange;
+};
+
+static bool readReport(const std::string &filename, std::map<std::string, BenchmarkResult> &results,
+                       std::vector<std::string> &order)
+{
+    std::ifstream report(filename.c_str());
+    if (!report.is_open())
+    {
+        fprintf(stderr, "Could not read %s\n", filename.c_str());
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(report, line))
+    {
+        if (!line.empty() && line[line.size() - 1] == ',')
+        {
+            line.erase(line.size() - 1);
+        }
+        BenchmarkResult result;
+        if (!result.parseJSON(line))
+            continue;
+        if (results.count(result.key()) == 0)
+        {
+            order.push_back(result.key());
+        }
+        results[result.key()] = result;
+    }
+
+    if (results.empty())
+    {
+        fprintf(stderr, "%s has no benchmark results\n", filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+// The same rank FrameStatistics uses, so the numbers match the report's
+static double percentile(std::vector<double> &samples, int percent)
+{
+    size_t rank = std::min(samples.size() - 1, samples.size() * percent / 100);
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    return samples[rank];
+}
+
+static void resample(const std::vector<double> &samples, std::vector<double> &resampled, std::mt19937 &generator)
+{
+    std::uniform_int_distribution<size_t> pick(0, samples.size() - 1);
+    resampled.resize(samples.size());
+    for (size_t iSample = 0; iSample < samples.size(); iSample++)
+    {
+        resampled[iSample] = samples[pick(generator)];
+    }
+}
+
+// Percentile bootstrap of candidate / baseline - 1. The generator is seeded
+// the same way every run, so a report pair always gives the same verdict.
+static MetricComparison compareMetric(const std::vector<double> &baseline, const std::vector<double> &candidate,
+                                      int percent, double alpha, int resamples)
+{
+    std::vector<double> baselineCopy(baseline), candidateCopy(candidate);
+    MetricComparison comparison;
+    comparison.baseline = percentile(baselineCopy, percent);
+    comparison.candidate = percentile(candidateCopy, percent);
+    comparison.change = comparison.candidate / comparison.baseline - 1.0;
+
+    std::mt19937 generator(percent);
+    std::vector<double> changes(resamples);
+    for (int iResample = 0; iResample < resamples; iResample++)
+    {
+        resample(baseline, baselineCopy, generator);
+        resample(candidate, candidateCopy, generator);
+        changes[iResample] = percentile(candidateCopy, percent) / percentile(baselineCopy, percent) - 1.0;
+    }
+    std::sort(changes.begin(), changes.end());
+    comparison.lowerChange = changes[(size_t)(alpha / 2.0 * (resamples - 1))];
+    comparison.upperChange = changes[(size_t)((1.0 - alpha / 2.0) * (resamples - 1))];
+    return comparison;
+}
+
+// Two-sided p-value from the normal approximation with tie correction,
+// which is close enough at the hundreds of frames a job runs
+static double mannWhitneyP(const std::vector<double> &baseline, const std::vector<double> &candidate)
+{
+    std::vector<std::pair<double, int> > samples;
+    for (size_t iSample = 0; iSample < baseline.size(); iSample++)
+    {
+        samples.push_back(std::make_pair(baseline[iSample], 0));
+    }
+    for (size_t iSample = 0; iSample < candidate.size(); iSample++)
+    {
+        samples.push_back(std::make_pair(candidate[iSample], 1));
+    }
+    std::sort(samples.begin(), samples.end());
+
+    double n = samples.size();
+    double baselineRankSum = 0.0;
+    double tieCorrection = 0.0;
+    for (size_t first = 0; first < samples.size(); )
+    {
+        size_t last = first;
+        while (last + 1 < samples.size() && samples[last + 1].first == samples[first].first)
+        {
+            last++;
+        }
+        double averageRank = (first + last) / 2.0 + 1.0;
+        double ties = last - first + 1;
+        tieCorrection += ties * ties * ties - ties;
+        for (size_t iSample = first; iSample <= last; iSample++)
+        {
+            if (samples[iSample].second == 0)
+            {
+                baselineRankSum += averageRank;
+            }
+        }
+        first = last + 1;
+    }
+
+    double n1 = baseline.size(), n2 = candidate.size();
+    double u = baselineRankSum - n1 * (n1 + 1.0) / 2.0;
+    double mean = n1 * n2 / 2.0;
+    double variance = n1 * n2 / 12.0 * ((n + 1.0) - tieCorrection / (n * (n - 1.0)));
+    if (variance <= 0.0)
+    {
+        return 1.0;
+    }
+    double z = std::max(fabs(u - mean) - 0.5, 0.0) / sqrt(variance);
+    return erfc(z / sqrt(2.0));
+}
+
+static const char *verdict(const MetricComparison &comparison, double threshold)
+{
+    if (comparison.lowerChange > 0.0 && comparison.change > threshold)
+        return "SLOWER";
+    if (comparison.upperChange < 0.0 && comparison.change < -threshold)
+        return "faster";
+    return "";
+}
+
+static void printUsage()
+{
+    fprintf(stderr, "usage: benchcompare [-t percent] [-a alpha] [-r resamples] baseline.json candidate.json\n");
+}
+
+int main(int argc, const char * argv[])
+{
+    double threshold = 0.03;
+    double alpha = 0.01;
+    int resamples = 2000;
+
+    int iArg = 1;
+    for (; iArg < argc && argv[iArg][0] == '-'; iArg++)
+    {
+        if (strcmp(argv[iArg], "-t") == 0 && iArg + 1 < argc)
+        {
+            threshold = atof(argv[++iArg]) / 100.0;
+        }
+        else if (strcmp(argv[iArg], "-a") == 0 && iArg + 1 < argc)
+        {
+            alpha = atof(argv[++iArg]);
+        }
+        else if (strcmp(argv[iArg], "-r") == 0 && iArg + 1 < argc)
+        {
+            resamples = std::max(atoi(argv[++iArg]), 100);
+        }
+        else
+        {
+            printUsage();
+            return 2;
+        }
+    }
+    if (argc - iArg != 2 || alpha <= 0.0 || alpha >= 1.0)
+    {
+        printUsage();
+        return 2;
+    }
+
+    std::map<std::string, BenchmarkResult> baseline, candidate;
+    std::vector<std::string> baselineOrder, candidateOrder;
+    if (!readReport(argv[iArg], baseline, baselineOrder) || !readReport(argv[iArg + 1], candidate, candidateOrder))
+    {
+        return 2;
+    }
+
+    char interval[32];
+    snprintf(interval, sizeof(interval), "%g%% interval", (1.0 - alpha) * 100.0);
+    printf("%-32s %-6s %10s %10s %8s  %-18s %8s\n", "job", "metric", "baseline", "candidate", "change", interval, "p");
+
+    int regressions = 0;
+    int improvements = 0;
+    int missing = 0;
+    for (size_t iJob = 0; iJob < baselineOrder.size(); iJob++)
+    {
+        const std::string &key = baselineOrder[iJob];
+        const BenchmarkResult &before = baseline[key];
+        if (candidate.count(key) == 0)
+        {
+            // A job that stopped running must not pass as "not slower"
+            printf("%-32s not in the candidate\n", key.c_str());
+            missing++;
+            continue;
+        }
+        const BenchmarkResult &after = candidate[key];
+        if (!before.ok || !after.ok)
+        {
+            bool broke = before.ok && !after.ok;
+            regressions += broke ? 1 : 0;
+            printf("%-32s %s%s\n", key.c_str(), before.ok ? "" : "baseline failed ", after.ok ? "" : ("candidate failed: " + after.error).c_str());
+            continue;
+        }
+        if (before.frameTimes.size() < 2 || after.frameTimes.size() < 2)
+        {
+            printf("%-32s no frame times; rerun benchrunner to record them\n", key.c_str());
+            continue;
+        }
+
+        double p = mannWhitneyP(before.frameTimes, after.frameTimes);
+        static const int percents[] = { 50, 95 };
+        static const char *metricNames[] = { "median", "p95" };
+        for (int iMetric = 0; iMetric < 2; iMetric++)
+        {
+            MetricComparison comparison = compareMetric(before.frameTimes, after.frameTimes, percents[iMetric], alpha, resamples);
+            const char *result = verdict(comparison, threshold);
+            regressions += strcmp(result, "SLOWER") == 0 ? 1 : 0;
+            improvements += strcmp(result, "faster") == 0 ? 1 : 0;
+
+            char bounds[32];
+            snprintf(bounds, sizeof(bounds), "[%+.1f%%, %+.1f%%]", comparison.lowerChange * 100.0, comparison.upperChange * 100.0);
+            printf("%-32s %-6s %7.3f ms %7.3f ms %+7.1f%%  %-18s %8.4f  %s\n",
+                   iMetric == 0 ? key.c_str() : "", metricNames[iMetric],
+                   comparison.baseline * 1000.0, comparison.candidate * 1000.0, comparison.change * 100.0,
+                   bounds, p, result);
+        }
+    }
+    for (size_t iJob = 0; iJob < candidateOrder.size(); iJob++)
+    {
+        if (baseline.count(candidateOrder[iJob]) == 0)
+        {
+            printf("%-32s not in the baseline\n", candidateOrder[iJob].c_str());
+        }
+    }
+
+    printf("\n%d slower, %d faster, %d missing (threshold %g%%)\n", regressions, improvements, missing, threshold * 100.0);
+    return regressions == 0 && missing == 0 ? 0 : 1;
+}
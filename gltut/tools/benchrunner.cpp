@@ -0,0 +1,491 @@
+//
+//  benchrunner.cpp
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+// Runs a benchmark sweep over several worker processes of the "gltut all"
+// binary and merges their results into one JSON report.
+//
+//  benchrunner [-j workers] [-b binary] [-o report.json] [-s] [-t seconds] sweep.txt
+//
+// Every line of the sweep file expands to one job per size and key set:
+//
+//  # scene   sizes                   frames  key sets
+//  03a       1280x720,1920x1080      300
+//  06d       1920x1080               300     -,V
+//  *         640x400                 100
+//
+// Scenes are named with or without the "gltut " prefix; * is every scene
+// the binary lists. A key set of - presses nothing. Each worker gets its
+// own GL context and an equal share of the cores, and takes the next job
+// as soon as it answers the last one, so long jobs do not hold up the
+// rest. -s asks Mesa for its software rasterizer, which is what lets a
+// machine run more workers than it has GPUs. A worker that dies, or takes
+// longer than the -t timeout (default 600 seconds) on one job, fails its
+// job and is restarted.
+//
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+
+struct Worker
+{
+    pid_t pid;
+    int jobInput;
+    int resultOutput;
+    int firstCore;
+    int coreCount;
+    int currentJob;
+    double jobStartTime;
+    std::string pending;
+};
+
+static double currentTime()
+{
+    timeval now;
+    gettimeofday(&now, NULL);
+    return now.tv_sec + now.tv_usec * 1e-6;
+}
+
+static std::string directoryOf(const std::string &path)
+{
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? "." : path.substr(0, slash);
+}
+
+static std::vector<std::string> split(const std::string &text, char separator)
+{
+    std::vector<std::string> parts;
+    std::istringstream stream(text);
+    std::string part;
+    while (std::getline(stream, part, separator))
+    {
+        parts.push_back(part);
+    }
+    return parts;
+}
+
+static std::vector<std::string> listScenes(const std::string &binary)
+{
+    std::vector<std::string> scenes;
+    std::string command = "\"" + binary + "\" --list";
+    FILE *list = popen(command.c_str(), "r");
+    if (list == NULL)
+    {
+        return scenes;
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), list) != NULL)
+    {
+        std::string scene(line);
+        scene.erase(scene.find_last_not_of("\r\n") + 1);
+        if (!scene.empty())
+        {
+            scenes.push_back(scene);
+        }
+    }
+    pclose(list);
+    return scenes;
+}
+
+static bool readSweep(const std::string &filename, const std::vector<std::string> &scenes, std::vector<BenchmarkJob> &jobs)
+{
+    std::ifstream sweep(filename.c_str());
+    if (!sweep.is_open())
+    {
+        fprintf(stderr, "Could not read %s\n", filename.c_str());
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(sweep, line))
+    {
+        lineNumber++;
+        std::istringstream fields(line);
+        std::string scene, sizes, keySets;
+        int frames = 0;
+        if (!(fields >> scene) || scene[0] == '#')
+            continue;
+        fields >> sizes >> frames >> keySets;
+        if (sizes.empty() || frames <= 0)
+        {
+            fprintf(stderr, "%s:%d: expected <scene> <sizes> <frames> [key sets]\n", filename.c_str(), lineNumber);
+            return false;
+        }
+
+        std::vector<std::string> lineScenes;
+        if (scene == "*")
+        {
+            lineScenes = scenes;
+        }
+        else
+        {
+            std::string name = scene.compare(0, 6, "gltut ") == 0 ? scene : "gltut " + scene;
+            if (std::find(scenes.begin(), scenes.end(), name) == scenes.end())
+            {
+                fprintf(stderr, "%s:%d: no scene named %s\n", filename.c_str(), lineNumber, name.c_str());
+                return false;
+            }
+            lineScenes.push_back(name);
+        }
+
+        std::vector<std::string> keys = split(keySets.empty() ? "-" : keySets, ',');
+        std::vector<std::string> sizeList = split(sizes, ',');
+        for (size_t iScene = 0; iScene < lineScenes.size(); iScene++)
+        {
+            for (size_t iSize = 0; iSize < sizeList.size(); iSize++)
+            {
+                for (size_t iKeys = 0; iKeys < keys.size(); iKeys++)
+                {
+                    BenchmarkJob job;
+                    job.id = (int)jobs.size();
+                    job.scene = lineScenes[iScene];
+                    if (sscanf(sizeList[iSize].c_str(), "%dx%d", &job.width, &job.height) != 2)
+                    {
+                        fprintf(stderr, "%s:%d: bad size %s\n", filename.c_str(), lineNumber, sizeList[iSize].c_str());
+                        return false;
+                    }
+                    job.frames = frames;
+                    job.keys = keys[iKeys] == "-" ? "" : keys[iKeys];
+                    jobs.push_back(job);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+static bool startWorker(Worker &worker, const std::string &binary, bool software)
+{
+    int jobPipe[2], resultPipe[2];
+    if (pipe(jobPipe) != 0 || pipe(resultPipe) != 0)
+    {
+        perror("pipe");
+        return false;
+    }
+
+    // Later workers must not inherit this worker's ends, or it never sees end of input
+    fcntl(jobPipe[1], F_SETFD, FD_CLOEXEC);
+    fcntl(resultPipe[0], F_SETFD, FD_CLOEXEC);
+
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        perror("fork");
+        return false;
+    }
+
+    if (pid == 0)
+    {
+        dup2(jobPipe[0], STDIN_FILENO);
+        dup2(resultPipe[1], STDOUT_FILENO);
+        close(jobPipe[0]);
+        close(jobPipe[1]);
+        close(resultPipe[0]);
+        close(resultPipe[1]);
+
+        // Affinity set before exec covers every thread the worker starts
+        PinToCores(worker.firstCore, worker.coreCount);
+        if (software)
+        {
+            setenv("LIBGL_ALWAYS_SOFTWARE", "1", 1);
+        }
+
+        // The worker finds its shaders relative to its own directory
+        if (chdir(directoryOf(binary).c_str()) != 0)
+        {
+            _exit(127);
+        }
+
+        char firstCore[16], coreCount[16];
+        snprintf(firstCore, sizeof(firstCore), "%d", worker.firstCore);
+        snprintf(coreCount, sizeof(coreCount), "%d", worker.coreCount);
+        execl(binary.c_str(), binary.c_str(), "--worker", "--cores", firstCore, coreCount, (char *)NULL);
+        _exit(127);
+    }
+
+    close(jobPipe[0]);
+    close(resultPipe[1]);
+    worker.pid = pid;
+    worker.jobInput = jobPipe[1];
+    worker.resultOutput = resultPipe[0];
+    worker.currentJob = -1;
+    worker.pending.clear();
+    return true;
+}
+
+static void stopWorker(Worker &worker)
+{
+    close(worker.jobInput);
+    close(worker.resultOutput);
+    waitpid(worker.pid, NULL, 0);
+    worker.pid = -1;
+}
+
+static bool sendJob(Worker &worker, const BenchmarkJob &job)
+{
+    std::string line = job.formatLine();
+    worker.currentJob = job.id;
+    worker.jobStartTime = currentTime();
+    return write(worker.jobInput, line.data(), line.size()) == (ssize_t)line.size();
+}
+
+// A result line for the progress log, without its frame times
+static std::string summary(const std::string &result)
+{
+    std::string::size_type frameTimes = result.find(",\"frameTimesMs\":[");
+    if (frameTimes == std::string::npos)
+    {
+        return result;
+    }
+    return result.substr(0, frameTimes) + result.substr(result.find(']', frameTimes) + 1);
+}
+
+static void printUsage()
+{
+    fprintf(stderr, "usage: benchrunner [-j workers] [-b binary] [-o report.json] [-s] [-t seconds] sweep.txt\n");
+}
+
+int main(int argc, const char * argv[])
+{
+    int coreCount = std::max((int)sysconf(_SC_NPROCESSORS_ONLN), 1);
+    int workerCount = coreCount;
+    std::string binary = directoryOf(argv[0]) + "/gltut all";
+    std::string reportFilename = "benchmark.json";
+    bool software = false;
+    double jobTimeout = 600.0;
+
+    int iArg = 1;
+    for (; iArg < argc && argv[iArg][0] == '-'; iArg++)
+    {
+        if (strcmp(argv[iArg], "-j") == 0 && iArg + 1 < argc)
+        {
+            workerCount = std::max(atoi(argv[++iArg]), 1);
+        }
+        else if (strcmp(argv[iArg], "-b") == 0 && iArg + 1 < argc)
+        {
+            binary = argv[++iArg];
+        }
+        else if (strcmp(argv[iArg], "-o") == 0 && iArg + 1 < argc)
+        {
+            reportFilename = argv[++iArg];
+        }
+        else if (strcmp(argv[iArg], "-s") == 0)
+        {
+            software = true;
+        }
+        else if (strcmp(argv[iArg], "-t") == 0 && iArg + 1 < argc && atof(argv[iArg + 1]) > 0.0)
+        {
+            jobTimeout = atof(argv[++iArg]);
+        }
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+    if (argc - iArg != 1)
+    {
+        printUsage();
+        return 1;
+    }
+
+    std::vector<std::string> scenes = listScenes(binary);
+    if (scenes.empty())
+    {
+        fprintf(stderr, "%s lists no scenes\n", binary.c_str());
+        return 1;
+    }
+
+    std::vector<BenchmarkJob> jobs;
+    if (!readSweep(argv[iArg], scenes, jobs))
+    {
+        return 1;
+    }
+    if (jobs.empty())
+    {
+        fprintf(stderr, "The sweep has no jobs\n");
+        return 1;
+    }
+
+    // A worker that exits mid-write must not take the runner with it
+    signal(SIGPIPE, SIG_IGN);
+
+    workerCount = std::min(workerCount, (int)jobs.size());
+    int coresPerWorker = std::max(coreCount / workerCount, 1);
+    std::vector<Worker> workers(workerCount);
+    for (int iWorker = 0; iWorker < workerCount; iWorker++)
+    {
+        workers[iWorker].firstCore = (iWorker * coresPerWorker) % coreCount;
+        workers[iWorker].coreCount = coresPerWorker;
+        if (!startWorker(workers[iWorker], binary, software))
+        {
+            return 1;
+        }
+    }
+    fprintf(stderr, "%d jobs on %d workers, %d cores each\n", (int)jobs.size(), workerCount, coresPerWorker);
+
+    double startTime = currentTime();
+    std::vector<std::string> results(jobs.size());
+    size_t nextJob = 0;
+    size_t finishedJobs = 0;
+    int restarts = 0;
+
+    for (int iWorker = 0; iWorker < workerCount && nextJob < jobs.size(); iWorker++)
+    {
+        sendJob(workers[iWorker], jobs[nextJob++]);
+    }
+
+    // The worker's job fails with reason and a new worker takes its place
+    auto replaceWorker = [&](Worker &worker, const char *reason)
+    {
+        int failedJob = worker.currentJob;
+        stopWorker(worker);
+        if (failedJob >= 0)
+        {
+            results[failedJob] = BenchmarkResultJSON(jobs[failedJob], std::vector<double>(), reason);
+            finishedJobs++;
+            fprintf(stderr, "[%d/%d] %s\n", (int)finishedJobs, (int)jobs.size(), results[failedJob].c_str());
+        }
+        if (nextJob < jobs.size() && restarts < workerCount * 4 && startWorker(worker, binary, software))
+        {
+            restarts++;
+            sendJob(worker, jobs[nextJob++]);
+        }
+    };
+
+    while (finishedJobs < jobs.size())
+    {
+        // Wake up in time for the first job to run out of time
+        std::vector<pollfd> descriptors;
+        std::vector<int> descriptorWorkers;
+        double firstDeadline = currentTime() + jobTimeout;
+        for (int iWorker = 0; iWorker < workerCount; iWorker++)
+        {
+            if (workers[iWorker].pid > 0 && workers[iWorker].currentJob >= 0)
+            {
+                pollfd descriptor = { workers[iWorker].resultOutput, POLLIN, 0 };
+                descriptors.push_back(descriptor);
+                descriptorWorkers.push_back(iWorker);
+                firstDeadline = std::min(firstDeadline, workers[iWorker].jobStartTime + jobTimeout);
+            }
+        }
+        if (descriptors.empty())
+        {
+            fprintf(stderr, "No workers left\n");
+            break;
+        }
+        int pollTimeout = (int)std::max((firstDeadline - currentTime()) * 1000.0 + 1.0, 0.0);
+        if (poll(&descriptors[0], descriptors.size(), pollTimeout) < 0 && errno != EINTR)
+        {
+            perror("poll");
+            break;
+        }
+
+        // A hung worker would otherwise hold its job, and the whole sweep, forever
+        double now = currentTime();
+        for (size_t iDescriptor = 0; iDescriptor < descriptors.size(); iDescriptor++)
+        {
+            Worker &worker = workers[descriptorWorkers[iDescriptor]];
+            if (descriptors[iDescriptor].revents == 0 && now - worker.jobStartTime >= jobTimeout)
+            {
+                kill(worker.pid, SIGKILL);
+                replaceWorker(worker, "timed out");
+            }
+        }
+
+        for (size_t iDescriptor = 0; iDescriptor < descriptors.size(); iDescriptor++)
+        {
+            if (descriptors[iDescriptor].revents == 0)
+                continue;
+
+            Worker &worker = workers[descriptorWorkers[iDescriptor]];
+            char buffer[4096];
+            ssize_t bytesRead = read(worker.resultOutput, buffer, sizeof(buffer));
+            if (bytesRead > 0)
+            {
+                worker.pending.append(buffer, bytesRead);
+                size_t newline;
+                while ((newline = worker.pending.find('\n')) != std::string::npos)
+                {
+                    std::string result = worker.pending.substr(0, newline);
+                    worker.pending.erase(0, newline + 1);
+                    if (worker.currentJob < 0)
+                        continue;
+
+                    results[worker.currentJob] = result;
+                    finishedJobs++;
+                    worker.currentJob = -1;
+                    fprintf(stderr, "[%d/%d] %s\n", (int)finishedJobs, (int)jobs.size(), summary(result).c_str());
+                    if (nextJob < jobs.size())
+                    {
+                        sendJob(worker, jobs[nextJob++]);
+                    }
+                }
+                continue;
+            }
+
+            // The worker exited or crashed
+            replaceWorker(worker, "worker exited");
+        }
+    }
+
+    for (int iWorker = 0; iWorker < workerCount; iWorker++)
+    {
+        if (workers[iWorker].pid > 0)
+        {
+            stopWorker(workers[iWorker]);
+        }
+    }
+
+    std::ofstream report(reportFilename.c_str());
+    report << "{\n\"binary\":" << JSONString(binary)
+           << ",\n\"workers\":" << workerCount
+           << ",\n\"coresPerWorker\":" << coresPerWorker
+           << ",\n\"softwareRenderer\":" << (software ? "true" : "false")
+           << ",\n\"elapsedSeconds\":" << currentTime() - startTime
+           << ",\n\"results\":[\n";
+    int failures = 0;
+    for (size_t iJob = 0; iJob < jobs.size(); iJob++)
+    {
+        std::string result = results[iJob];
+        if (result.empty())
+        {
+            result = BenchmarkResultJSON(jobs[iJob], std::vector<double>(), "not run");
+        }
+        if (result.find("\"ok\":true") == std::string::npos)
+        {
+            failures++;
+        }
+        report << result << (iJob + 1 < jobs.size() ? ",\n" : "\n");
+    }
+    report << "]\n}\n";
+    if (!report.good())
+    {
+        fprintf(stderr, "Could not write %s\n", reportFilename.c_str());
+        return 1;
+    }
+
+    fprintf(stderr, "Wrote %s: %d jobs, %d failed, %.1f s\n", reportFilename.c_str(), (int)jobs.size(), failures, currentTime() - startTime);
+    return failures == 0 ? 0 : 2;
+}
@@ -0,0 +1,121 @@
+//
+//  transformfeedback.h
+//  gltut-glfw
+//
+//  Copyright (c) 2013 Ricardo Sánchez-Sáez.
+//
+// This file is licensed under the MIT License.
+//
+
+#ifndef gltut_glfw_transformfeedback_h
+#define gltut_glfw_transformfeedback_h
+
+#include <vector>
+
+#include "gpuresource.h"
+
+// Ping-pong vertex state that lives on the GPU between frames.
+//
+// Two buffers hold the same interleaved per-vertex layout. Every update()
+// draws the current buffer as points through a feedback program (see
+// createFeedbackProgramWithFilename() in glhelpers.h) with rasterization
+// off, captures its outputs into the other buffer and swaps them. Drawing
+// then reads from currentVertexArray(), so no vertex ever visits the CPU
+// after init().
+//
+// The feedback program must declare its inputs at the attribute locations
+// given to init() and list its outputs in the same interleaved order.
+
+struct FeedbackAttribute
+{
+    GLuint location;
+    GLint components;   // floats
+    size_t offset;      // bytes from the start of the vertex
+};
+
+class TransformFeedbackBuffers
+{
+  public:
+    TransformFeedbackBuffers()
+    : _vertexCount(0)
+    , _current(0)
+    {
+    }
+
+    void init(const void *initialData, GLsizei vertexCount, GLsizei stride,
+              const std::vector<FeedbackAttribute> &attributes)
+    {
+        destroy();
+        _vertexCount = vertexCount;
+        _current = 0;
+
+        for (int iBuffer = 0; iBuffer < 2; iBuffer++)
+        {
+            _buffers[iBuffer].create();
+            _buffers[iBuffer].bufferData(GL_ARRAY_BUFFER, (GLsizeiptr)vertexCount * stride,
+                                         iBuffer == 0 ? initialData : NULL, GL_DYNAMIC_COPY);
+
+            _vertexArrays[iBuffer].create();
+            glBindVertexArray(_vertexArrays[iBuffer]);
+            for (size_t iAttrib = 0; iAttrib < attributes.size(); iAttrib++)
+            {
+                const FeedbackAttribute &attribute = attributes[iAttrib];
+                glEnableVertexAttribArray(attribute.location);
+                glVertexAttribPointer(attribute.location, attribute.components, GL_FLOAT, GL_FALSE,
+                                      stride, (void*)attribute.offset);
+            }
+        }
+
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        printOpenGLError();
+    }
+
+    // Runs feedbackProgram (already set up with its uniforms) over every vertex once.
+    void update(GLuint feedbackProgram)
+    {
+        int next = 1 - _current;
+
+        glUseProgram(feedbackProgram);
+        glEnable(GL_RASTERIZER_DISCARD);
+
+        glBindVertexArray(_vertexArrays[_current]);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, _buffers[next]);
+
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, 0, _vertexCount);
+        glEndTransformFeedback();
+
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+        glBindVertexArray(0);
+        glDisable(GL_RASTERIZER_DISCARD);
+        printOpenGLError();
+
+        _current = next;
+    }
+
+    // Vertex array sourcing the state written by the last update().
+    GLuint currentVertexArray() const { return _vertexArrays[_current]; }
+    GLsizei vertexCount() const { return _vertexCount; }
+
+    // Deletes both buffers; init() makes new ones
+    void destroy()
+    {
+        for (int iBuffer = 0; iBuffer < 2; iBuffer++)
+        {
+            _vertexArrays[iBuffer].reset();
+            _buffers[iBuffer].reset();
+        }
+    }
+
+  private:
+    TransformFeedbackBuffers(const TransformFeedbackBuffers &);
+    TransformFeedbackBuffers &operator=(const TransformFeedbackBuffers &);
+
+    GLBuffer _buffers[2];
+    GLVertexArray _vertexArrays[2];
+    GLsizei _vertexCount;
+    int _current;
+};
+
+#endif